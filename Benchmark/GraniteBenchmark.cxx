@@ -0,0 +1,298 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteBenchmark.cxx
+ Author: Toni Westbrook
+
+ Headless benchmark for the Granite plugin hot paths.  Generates a
+ synthetic XFDL/BIN dataset, then times the Granite read path
+ (GraniteInterop::copyFloatData), the AMR block path
+ (vtkGraniteReaderAMR::GetAMRGridData) and the writer
+ (vtkGraniteWriter::writeBinary / writeMRData), against either the real
+ Granite.jar or the GraniteStandIn.jar built alongside this tool.
+
+ =========================================================================*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "vtkCellData.h"
+#include "vtkImageData.h"
+#include "vtkPointData.h"
+#include "vtkUniformGrid.h"
+
+#include "GraniteShared.h"
+#include "GraniteSynthetic.h"
+#include "vtkGraniteReaderAMR.h"
+#include "vtkGraniteSettings.h"
+#include "vtkGraniteWriter.h"
+
+class GraniteBenchmark {
+	public:
+		GraniteBenchmark();
+
+		bool parseArguments(int passCount, char * * passArguments);
+		int run();
+
+	private:
+		// Per stage measurements
+		struct StageResult {
+			std::string name;
+			unsigned long long bytes;
+			unsigned long long jniCalls;
+			int blocks;
+			double seconds;
+		};
+
+		void runRead(std::string passFileName);
+		void runAMR(std::string passFileName);
+		void runWrite();
+		void report(StageResult passResult);
+		void printUsage(const char * passProgram);
+		double elapsed(std::chrono::steady_clock::time_point passStart);
+
+		GraniteSynthetic _synthetic;
+		std::string _jarName;
+		std::string _javaArguments;
+		std::string _outputDirectory;
+		int _repeat;
+};
+
+GraniteBenchmark::GraniteBenchmark() {
+	_outputDirectory = ".";
+	_repeat = 1;
+}
+
+bool GraniteBenchmark::parseArguments(int passCount, char * * passArguments) {
+	std::string currentArg;
+
+	for (int argIdx = 1 ; argIdx < passCount ; argIdx++) {
+		currentArg = passArguments[argIdx];
+
+		// Flags followed by a single value
+		if (argIdx + 1 >= passCount) {
+			printUsage(passArguments[0]);
+			return false;
+		}
+
+		if (currentArg == "--jar") _jarName = passArguments[++argIdx];
+		else if (currentArg == "--java-args") _javaArguments = passArguments[++argIdx];
+		else if (currentArg == "--output") _outputDirectory = passArguments[++argIdx];
+		else if (currentArg == "--attributes") _synthetic.attributeCount = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--components") _synthetic.componentCount = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--levels") _synthetic.levelCount = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--steps") _synthetic.levelSteps = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--repeat") _repeat = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--size") {
+			_synthetic.dimensions[0] = _synthetic.dimensions[1] = _synthetic.dimensions[2] = atoi(passArguments[++argIdx]);
+		}
+		else if (currentArg == "--dims" && argIdx + 3 < passCount) {
+			_synthetic.dimensions[0] = atoi(passArguments[++argIdx]);
+			_synthetic.dimensions[1] = atoi(passArguments[++argIdx]);
+			_synthetic.dimensions[2] = atoi(passArguments[++argIdx]);
+		}
+		else {
+			printUsage(passArguments[0]);
+			return false;
+		}
+	}
+
+	// Validate
+	if (_jarName.empty() || _synthetic.attributeCount < 1 || _synthetic.componentCount < 1 || _synthetic.levelCount < 1 || _synthetic.levelSteps < 2 || _repeat < 1) {
+		printUsage(passArguments[0]);
+		return false;
+	}
+
+	return true;
+}
+
+int GraniteBenchmark::run() {
+	std::string xfdlName;
+	std::chrono::steady_clock::time_point startTime;
+	StageResult generateResult;
+
+	// Granite settings must be in place before the JVM is created by the first data source
+	vtkGraniteSettings::GetInstance()->setGraniteFileName(_jarName.c_str());
+	vtkGraniteSettings::GetInstance()->setJavaArguments(_javaArguments.c_str());
+
+	printf("%-12s %14s %10s %10s %12s %8s %10s\n", "stage", "bytes", "seconds", "MB/s", "jni_calls", "blocks", "ms/block");
+
+	// Synthetic dataset
+	startTime = std::chrono::steady_clock::now();
+	xfdlName = _synthetic.writeDataSet(_outputDirectory, "synthetic");
+	generateResult.name = "generate";
+	generateResult.bytes = 0;
+	for (int levelIdx = 0 ; levelIdx < _synthetic.levelCount ; levelIdx++) generateResult.bytes += _synthetic.getByteCount(levelIdx);
+	generateResult.jniCalls = 0;
+	generateResult.blocks = _synthetic.levelCount;
+	generateResult.seconds = elapsed(startTime);
+	report(generateResult);
+
+	// Hot paths
+	for (int repeatIdx = 0 ; repeatIdx < _repeat ; repeatIdx++) {
+		runRead(xfdlName);
+		if (_synthetic.levelCount > 1) runAMR(xfdlName);
+		runWrite();
+	}
+
+	// Per method and per phase breakdown
+	printf("\n%s", GraniteCounters::getProcessTotals()->getReport("  ").c_str());
+
+	return 0;
+}
+
+void GraniteBenchmark::runRead(std::string passFileName) {
+	GraniteShared graniteInfo;
+	vtkPointData * pointData;
+	std::chrono::steady_clock::time_point startTime;
+	StageResult result;
+	unsigned long long startCalls;
+	int dataExtent[6];
+
+	result.name = "open";
+	startCalls = GraniteInterop::getJNICallCount();
+	startTime = std::chrono::steady_clock::now();
+
+	// Open data source and read ParaView metadata, as FillOutputPortInformation does
+	graniteInfo._fileName = passFileName;
+	if (graniteInfo.initialize() == false) {
+		fprintf(stderr, "ERROR: Unable to open %s through Granite\n", passFileName.c_str());
+		exit(1);
+	}
+
+	result.seconds = elapsed(startTime);
+	result.jniCalls = GraniteInterop::getJNICallCount() - startCalls;
+	result.bytes = 0;
+	result.blocks = 1;
+	report(result);
+
+	// Full extent of finest level through copyFloatData
+	result.name = "read";
+	pointData = vtkPointData::New();
+	graniteInfo._interop.setLevel(graniteInfo._interop.getLevelCount() - 1);
+	memcpy(dataExtent, graniteInfo._interop.getBounds(), sizeof(dataExtent));
+	graniteInfo.readFieldData(pointData);
+
+	startCalls = GraniteInterop::getJNICallCount();
+	startTime = std::chrono::steady_clock::now();
+	graniteInfo._interop.copyFloatData(dataExtent, pointData);
+	result.seconds = elapsed(startTime);
+	result.jniCalls = GraniteInterop::getJNICallCount() - startCalls;
+	result.bytes = _synthetic.getByteCount(0);
+	result.blocks = dataExtent[5] - dataExtent[4] + 1;
+	report(result);
+
+	pointData->Delete();
+}
+
+void GraniteBenchmark::runAMR(std::string passFileName) {
+	vtkGraniteReaderAMR * reader;
+	vtkUniformGrid * currentGrid;
+	std::chrono::steady_clock::time_point startTime;
+	StageResult result;
+	unsigned long long startCalls;
+
+	// AMR reader currently only supports a single attribute
+	if (_synthetic.attributeCount > 1) return;
+
+	result.name = "amr_blocks";
+	result.bytes = 0;
+	reader = vtkGraniteReaderAMR::New();
+	reader->setFileName(passFileName.c_str());
+	reader->UpdateInformation();
+
+	startCalls = GraniteInterop::getJNICallCount();
+	startTime = std::chrono::steady_clock::now();
+
+	// Fetch every block of every level, as a fully streamed session would
+	result.blocks = reader->GetNumberOfBlocks();
+	for (int blockIdx = 0 ; blockIdx < result.blocks ; blockIdx++) {
+		currentGrid = reader->GetAMRGrid(blockIdx);
+		reader->GetAMRGridData(blockIdx, currentGrid, "Granite Values");
+		// Arrays are sized by their own type (AMR blocks hold doubles)
+		result.bytes += currentGrid->GetCellData()->GetArray(0)->GetNumberOfTuples() * currentGrid->GetCellData()->GetArray(0)->GetNumberOfComponents() * currentGrid->GetCellData()->GetArray(0)->GetDataTypeSize();
+		currentGrid->Delete();
+	}
+
+	result.seconds = elapsed(startTime);
+	result.jniCalls = GraniteInterop::getJNICallCount() - startCalls;
+	report(result);
+
+	reader->Delete();
+}
+
+void GraniteBenchmark::runWrite() {
+	vtkGraniteWriter * writer;
+	vtkImageData * inputData;
+	std::chrono::steady_clock::time_point startTime;
+	StageResult result;
+
+	inputData = _synthetic.createImageData();
+	writer = vtkGraniteWriter::New();
+	writer->setFileBase((_outputDirectory + "/written.xfdl").c_str());
+	writer->setMultiresolution(_synthetic.levelCount, _synthetic.levelSteps);
+
+	// Single resolution binary
+	result.name = "write_bin";
+	result.jniCalls = 0;
+	result.blocks = 1;
+	startTime = std::chrono::steady_clock::now();
+	writer->writeBinary(inputData, _outputDirectory + "/written.bin");
+	result.seconds = elapsed(startTime);
+	result.bytes = _synthetic.getByteCount(0);
+	report(result);
+
+	// Multiresolution pyramid (resample, headers and binaries per level)
+	if (_synthetic.levelCount > 1) {
+		result.name = "write_mr";
+		result.blocks = _synthetic.levelCount;
+		result.bytes = 0;
+		for (int levelIdx = 0 ; levelIdx < _synthetic.levelCount ; levelIdx++) result.bytes += _synthetic.getByteCount(levelIdx);
+
+		startTime = std::chrono::steady_clock::now();
+		writer->writeMRData(inputData);
+		result.seconds = elapsed(startTime);
+		report(result);
+	}
+
+	writer->Delete();
+	inputData->Delete();
+}
+
+void GraniteBenchmark::report(StageResult passResult) {
+	double throughput, blockTime;
+
+	throughput = (passResult.seconds > 0 ? passResult.bytes / (1024.0 * 1024.0) / passResult.seconds : 0);
+	blockTime = (passResult.blocks > 0 ? 1000.0 * passResult.seconds / passResult.blocks : 0);
+
+	printf("%-12s %14llu %10.4f %10.2f %12llu %8d %10.4f\n", passResult.name.c_str(), passResult.bytes, passResult.seconds, throughput, passResult.jniCalls, passResult.blocks, blockTime);
+	fflush(stdout);
+}
+
+void GraniteBenchmark::printUsage(const char * passProgram) {
+	fprintf(stderr, "Usage: %s --jar <Granite.jar|GraniteStandIn.jar> [options]\n", passProgram);
+	fprintf(stderr, "  --java-args <string>   Additional JVM arguments (e.g. \"-Xmx4g\")\n");
+	fprintf(stderr, "  --output <dir>         Directory for generated and written datasets (default .)\n");
+	fprintf(stderr, "  --size <n>             Points per axis (default 128)\n");
+	fprintf(stderr, "  --dims <x> <y> <z>     Points per axis, individually\n");
+	fprintf(stderr, "  --attributes <n>       Granite attributes per point (default 1)\n");
+	fprintf(stderr, "  --components <n>       Components per VTK array (default 1)\n");
+	fprintf(stderr, "  --levels <n>           Multiresolution levels (default 1)\n");
+	fprintf(stderr, "  --steps <n>            Downsampling factor between levels (default 2)\n");
+	fprintf(stderr, "  --repeat <n>           Repetitions of each hot path stage (default 1)\n");
+}
+
+double GraniteBenchmark::elapsed(std::chrono::steady_clock::time_point passStart) {
+	return std::chrono::duration< double >(std::chrono::steady_clock::now() - passStart).count();
+}
+
+int main(int argc, char * argv[]) {
+	GraniteBenchmark benchmark;
+
+	if (benchmark.parseArguments(argc, argv) == false) return 1;
+
+	return benchmark.run();
+}
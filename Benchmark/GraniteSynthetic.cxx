@@ -0,0 +1,191 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteSynthetic.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#include <direct.h>
+#endif
+
+#include "vtkFloatArray.h"
+#include "vtkImageData.h"
+#include "vtkPointData.h"
+
+#include "GraniteFormat.h"
+#include "GraniteSynthetic.h"
+
+GraniteSynthetic::GraniteSynthetic() {
+	dimensions[0] = 128;
+	dimensions[1] = 128;
+	dimensions[2] = 128;
+	attributeCount = 1;
+	componentCount = 1;
+	levelCount = 1;
+	levelSteps = 2;
+}
+
+std::string GraniteSynthetic::writeDataSet(std::string passDirectory, std::string passBase) {
+	std::string currentDirectory, mrPostfix;
+
+	if (!passDirectory.empty() && passDirectory.back() != '/') passDirectory += "/";
+
+	// Single resolution - header and binary side by side
+	if (levelCount == 1) {
+		writeLevel(0, passDirectory + passBase + ".xfdl", passDirectory + passBase + ".bin", passBase + ".bin");
+		return passDirectory + passBase + ".xfdl";
+	}
+
+	// Multiresolution - same nested layout as vtkGraniteWriter::writeMRData
+	writeLevel(0, passDirectory + passBase + ".xfdl", "", "@" + passBase + "/" + passBase + ".bin");
+	currentDirectory = passDirectory + passBase + "/";
+
+	for (int levelIdx = 0 ; levelIdx < levelCount ; levelIdx++) {
+		#ifdef _WIN32
+			mkdir(currentDirectory.c_str());
+		#else
+			mkdir(currentDirectory.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+		#endif
+
+		if (levelIdx == 0) {
+			writeLevel(0, currentDirectory + passBase + ".xfdl", currentDirectory + passBase + ".bin", passBase + ".bin");
+		}
+		else {
+			mrPostfix = ".d" + std::to_string(levelIdx);
+			writeLevel(levelIdx, currentDirectory + passBase + ".bin" + mrPostfix + ".fdl", "", passBase + ".bin" + mrPostfix);
+			writeLevel(levelIdx, currentDirectory + "data.fdl", currentDirectory + passBase + ".bin" + mrPostfix, passBase + ".bin" + mrPostfix);
+		}
+
+		currentDirectory += "level" + std::to_string(levelIdx + 1) + "/";
+	}
+
+	return passDirectory + passBase + ".xfdl";
+}
+
+vtkImageData * GraniteSynthetic::createImageData() {
+	vtkImageData * retData;
+	vtkFloatArray * currentArray;
+	int arrayCount, currentComponents;
+
+	retData = vtkImageData::New();
+	retData->SetExtent(0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1);
+
+	// Group attributes into arrays of componentCount components
+	arrayCount = (attributeCount + componentCount - 1) / componentCount;
+	for (int arrayIdx = 0 ; arrayIdx < arrayCount ; arrayIdx++) {
+		currentComponents = std::min(componentCount, attributeCount - arrayIdx * componentCount);
+
+		currentArray = vtkFloatArray::New();
+		currentArray->SetName(("Array" + std::to_string(arrayIdx)).c_str());
+		currentArray->SetNumberOfComponents(currentComponents);
+		currentArray->SetNumberOfTuples(retData->GetNumberOfPoints());
+
+		for (int compIdx = 0 ; compIdx < currentComponents ; compIdx++) {
+			currentArray->SetComponentName(compIdx, ("c" + std::to_string(compIdx)).c_str());
+		}
+
+		// Fill in point order (x fastest)
+		for (int zIdx = 0 ; zIdx < dimensions[2] ; zIdx++) {
+			for (int yIdx = 0 ; yIdx < dimensions[1] ; yIdx++) {
+				for (int xIdx = 0 ; xIdx < dimensions[0] ; xIdx++) {
+					for (int compIdx = 0 ; compIdx < currentComponents ; compIdx++) {
+						currentArray->SetComponent((zIdx * dimensions[1] + yIdx) * dimensions[0] + xIdx, compIdx, getValue(xIdx, yIdx, zIdx, arrayIdx * componentCount + compIdx));
+					}
+				}
+			}
+		}
+
+		retData->GetPointData()->AddArray(currentArray);
+		if (arrayIdx == 0) retData->GetPointData()->SetActiveScalars(currentArray->GetName());
+		currentArray->Delete();
+	}
+
+	return retData;
+}
+
+unsigned long long GraniteSynthetic::getByteCount(int passLevel) {
+	int levelDimensions[3];
+
+	getLevelDimensions(passLevel, levelDimensions);
+
+	return (unsigned long long) levelDimensions[0] * levelDimensions[1] * levelDimensions[2] * attributeCount * sizeof(float);
+}
+
+void GraniteSynthetic::writeLevel(int passLevel, std::string passXFDLName, std::string passBinaryName, std::string passHeaderBinary) {
+	GraniteFormat::Header xfdlHeader;
+	std::ofstream fileStream;
+	std::vector< float > rowValues;
+	std::vector< char > rowBuffer;
+	int levelDimensions[3], levelScale;
+	float * currentValue;
+
+	getLevelDimensions(passLevel, levelDimensions);
+	levelScale = (int) pow(levelSteps, passLevel);
+
+	// Header, built by the format core vtkGraniteWriter::writeXFDL uses
+	xfdlHeader.binaryName = passHeaderBinary;
+	for (int attrIdx = 0 ; attrIdx < attributeCount ; attrIdx++) {
+		xfdlHeader.fieldNames.push_back(getFieldName(attrIdx));
+	}
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		xfdlHeader.extent[2 * dimIdx + 1] = levelDimensions[dimIdx] - 1;
+		xfdlHeader.spacing[dimIdx] = levelScale;
+	}
+
+	GraniteFormat::writeXFDL(xfdlHeader, passXFDLName);
+
+	if (passBinaryName.empty()) return;
+
+	// Big-endian, record-interleaved binary written one row at a time
+	fileStream.open(passBinaryName.c_str(), std::ios::out | std::ios::binary);
+	rowValues.resize((size_t) levelDimensions[0] * attributeCount);
+	rowBuffer.resize(rowValues.size() * sizeof(float));
+
+	for (int zIdx = 0 ; zIdx < levelDimensions[2] ; zIdx++) {
+		for (int yIdx = 0 ; yIdx < levelDimensions[1] ; yIdx++) {
+			currentValue = &rowValues[0];
+
+			for (int xIdx = 0 ; xIdx < levelDimensions[0] ; xIdx++) {
+				for (int attrIdx = 0 ; attrIdx < attributeCount ; attrIdx++) {
+					*currentValue++ = getValue(xIdx * levelScale, yIdx * levelScale, zIdx * levelScale, attrIdx);
+				}
+			}
+
+			GraniteFormat::encodeFloats(&rowValues[0], rowValues.size(), true, &rowBuffer[0]);
+			fileStream.write(&rowBuffer[0], rowBuffer.size());
+		}
+	}
+
+	fileStream.close();
+}
+
+void GraniteSynthetic::getLevelDimensions(int passLevel, int * retDimensions) {
+	int levelScale;
+
+	// Matches extent produced by vtkImageResample at magnification 1 / steps^level
+	levelScale = (int) pow(levelSteps, passLevel);
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		retDimensions[dimIdx] = (dimensions[dimIdx] - 1) / levelScale + 1;
+	}
+}
+
+std::string GraniteSynthetic::getFieldName(int passAttribute) {
+	return "Array" + std::to_string(passAttribute / componentCount) + ".c" + std::to_string(passAttribute % componentCount);
+}
+
+float GraniteSynthetic::getValue(int passX, int passY, int passZ, int passAttribute) {
+	// Smooth field with per-attribute phase, so ranges and histograms are non-trivial
+	return (float) (sin(0.05 * passX + passAttribute) * cos(0.07 * passY) + 0.01 * passZ);
+}
@@ -0,0 +1,41 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteSynthetic.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteSynthetic_h
+#define __GraniteSynthetic_h
+
+#include <string>
+
+class vtkImageData;
+
+class GraniteSynthetic {
+	public:
+		GraniteSynthetic();
+
+		// Dataset shape
+		int dimensions[3]; // Points per axis at the finest level
+		int attributeCount; // Total number of Granite attributes (fields)
+		int componentCount; // Components per VTK array ("Array.Component" grouping)
+		int levelCount; // Multiresolution levels (1 for single resolution)
+		int levelSteps; // Downsampling factor between levels
+
+		std::string writeDataSet(std::string passDirectory, std::string passBase); // Write XFDL/BIN files, return top level XFDL name
+		vtkImageData * createImageData(); // Create equivalent in-memory dataset (caller owns reference)
+		unsigned long long getByteCount(int passLevel); // Binary size of a level
+
+	private:
+		void writeLevel(int passLevel, std::string passXFDLName, std::string passBinaryName, std::string passHeaderBinary); // Write one level's header and binary
+		void getLevelDimensions(int passLevel, int * retDimensions); // Points per axis for a level
+		std::string getFieldName(int passAttribute); // Field name for an attribute index
+		float getValue(int passX, int passY, int passZ, int passAttribute); // Synthetic value at a finest level point
+};
+
+#endif // __GraniteSynthetic_h
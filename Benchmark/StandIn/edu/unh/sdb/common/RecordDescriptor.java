@@ -0,0 +1,30 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: Benchmark/StandIn/edu/unh/sdb/common/RecordDescriptor.java
+ Author: Toni Westbrook
+
+ Local stand-in for the Granite class of the same name, implementing only
+ the methods used through JNI by GraniteWrapper.
+
+ =========================================================================*/
+
+package edu.unh.sdb.common;
+
+import java.util.List;
+
+public class RecordDescriptor {
+	private final String[] _names;
+
+	public RecordDescriptor(List<String> passNames) {
+		_names = passNames.toArray(new String[passNames.size()]);
+	}
+
+	public int size() {
+		return _names.length;
+	}
+
+	public String name(int passIdx) {
+		return _names[passIdx];
+	}
+}
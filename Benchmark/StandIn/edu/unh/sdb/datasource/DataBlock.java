@@ -0,0 +1,38 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: Benchmark/StandIn/edu/unh/sdb/datasource/DataBlock.java
+ Author: Toni Westbrook
+
+ Local stand-in for the Granite class of the same name, implementing only
+ the methods used through JNI by GraniteWrapper.
+
+ =========================================================================*/
+
+package edu.unh.sdb.datasource;
+
+import edu.unh.sdb.common.RecordDescriptor;
+
+public class DataBlock extends DataCollection {
+	private final ISBounds _bounds;
+	private final RecordDescriptor _descriptor;
+	private final float[] _values;
+
+	public DataBlock(ISBounds passBounds, RecordDescriptor passDescriptor, float[] passValues) {
+		_bounds = passBounds;
+		_descriptor = passDescriptor;
+		_values = passValues;
+	}
+
+	public ISBounds getBounds() {
+		return _bounds;
+	}
+
+	public float[] getFloats() {
+		return _values;
+	}
+
+	public RecordDescriptor getRecordDescriptor() {
+		return _descriptor;
+	}
+}
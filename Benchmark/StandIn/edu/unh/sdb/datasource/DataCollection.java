@@ -0,0 +1,24 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: Benchmark/StandIn/edu/unh/sdb/datasource/DataCollection.java
+ Author: Toni Westbrook
+
+ Local stand-in for the Granite class of the same name, implementing only
+ the methods used through JNI by GraniteWrapper.
+
+ =========================================================================*/
+
+package edu.unh.sdb.datasource;
+
+import edu.unh.sdb.common.RecordDescriptor;
+
+public abstract class DataCollection {
+	public abstract ISBounds getBounds();
+	public abstract float[] getFloats();
+	public abstract RecordDescriptor getRecordDescriptor();
+
+	public int getNumAttributes() {
+		return getRecordDescriptor().size();
+	}
+}
@@ -0,0 +1,158 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: Benchmark/StandIn/edu/unh/sdb/datasource/DataSource.java
+ Author: Toni Westbrook
+
+ Local stand-in for the Granite class of the same name, implementing only
+ the methods used through JNI by GraniteWrapper.  Reads big-endian,
+ record-interleaved binaries described by the XFDL files vtkGraniteWriter
+ and the benchmark generator produce.
+
+ =========================================================================*/
+
+package edu.unh.sdb.datasource;
+
+import java.io.File;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.channels.FileChannel;
+import java.util.ArrayList;
+import java.util.List;
+
+import javax.xml.parsers.DocumentBuilder;
+import javax.xml.parsers.DocumentBuilderFactory;
+
+import org.w3c.dom.Document;
+import org.w3c.dom.Element;
+import org.w3c.dom.NodeList;
+
+import edu.unh.sdb.common.RecordDescriptor;
+
+public class DataSource extends DataCollection {
+	protected String _name;
+	protected File _descriptorFile;
+	protected File _binaryFile;
+	protected ISBounds _bounds;
+	protected RecordDescriptor _descriptor;
+	private FileChannel _channel;
+
+	protected DataSource(String passName, File passDescriptorFile) {
+		_name = passName;
+		_descriptorFile = passDescriptorFile;
+	}
+
+	public static DataSource create(String passName, String passFileName) throws Exception {
+		File descriptorFile;
+		String binaryName;
+
+		// Multiresolution sources reference their root level with a leading '@'
+		descriptorFile = new File(passFileName).getAbsoluteFile();
+		binaryName = parseDescriptor(descriptorFile).getAttribute("fileName");
+		if (binaryName.startsWith("@")) {
+			return new MRDataSource(passName, descriptorFile, binaryName.substring(1));
+		}
+
+		return new DataSource(passName, descriptorFile);
+	}
+
+	public void activate() throws Exception {
+		Element root;
+		NodeList fields, bounds;
+		List<String> names;
+		int[] lower, upper;
+
+		// Fields
+		root = parseDescriptor(_descriptorFile);
+		fields = root.getElementsByTagName("Field");
+		names = new ArrayList<String>();
+		for (int fieldIdx = 0 ; fieldIdx < fields.getLength() ; fieldIdx++) {
+			names.add(((Element) fields.item(fieldIdx)).getAttribute("fieldName"));
+		}
+		_descriptor = new RecordDescriptor(names);
+
+		// Bounds (outermost axis first)
+		bounds = root.getElementsByTagName("Bounds");
+		lower = new int[bounds.getLength()];
+		upper = new int[bounds.getLength()];
+		for (int dimIdx = 0 ; dimIdx < bounds.getLength() ; dimIdx++) {
+			lower[dimIdx] = Integer.parseInt(((Element) bounds.item(dimIdx)).getAttribute("lower"));
+			upper[dimIdx] = Integer.parseInt(((Element) bounds.item(dimIdx)).getAttribute("upper"));
+		}
+		_bounds = new ISBounds(lower, upper);
+
+		// Binary
+		_binaryFile = new File(_descriptorFile.getParentFile(), root.getAttribute("fileName"));
+		_channel = new RandomAccessFile(_binaryFile, "r").getChannel();
+	}
+
+	public int dim() {
+		return _bounds.dim();
+	}
+
+	public DataBlock subblock(ISBounds passBounds) throws IOException {
+		ByteBuffer rowBuffer;
+		float[] values;
+		int recordSize, rowLength, valueOffset;
+		long rowOffset;
+
+		recordSize = _descriptor.size();
+		rowLength = passBounds.length(2) * recordSize;
+		rowBuffer = ByteBuffer.allocate(rowLength * 4).order(ByteOrder.BIG_ENDIAN);
+		values = new float[passBounds.size() * recordSize];
+		valueOffset = 0;
+
+		// Read one contiguous row of the innermost axis at a time
+		for (int zIdx = passBounds.getLower(0) ; zIdx <= passBounds.getUpper(0) ; zIdx++) {
+			for (int yIdx = passBounds.getLower(1) ; yIdx <= passBounds.getUpper(1) ; yIdx++) {
+				rowOffset = ((long) (zIdx - _bounds.getLower(0)) * _bounds.length(1) + (yIdx - _bounds.getLower(1))) * _bounds.length(2);
+				rowOffset = (rowOffset + passBounds.getLower(2) - _bounds.getLower(2)) * recordSize * 4;
+
+				rowBuffer.clear();
+				while (rowBuffer.hasRemaining()) {
+					if (_channel.read(rowBuffer, rowOffset + rowBuffer.position()) < 0) throw new IOException("Unexpected end of " + _binaryFile);
+				}
+
+				rowBuffer.flip();
+				rowBuffer.asFloatBuffer().get(values, valueOffset, rowLength);
+				valueOffset += rowLength;
+			}
+		}
+
+		return new DataBlock(passBounds, _descriptor, values);
+	}
+
+	public ISBounds getBounds() {
+		return _bounds;
+	}
+
+	public float[] getFloats() {
+		try {
+			return subblock(_bounds).getFloats();
+		}
+		catch (IOException e) {
+			throw new RuntimeException(e);
+		}
+	}
+
+	public RecordDescriptor getRecordDescriptor() {
+		return _descriptor;
+	}
+
+	protected static Element parseDescriptor(File passFile) throws Exception {
+		DocumentBuilderFactory factory;
+		DocumentBuilder builder;
+		Document document;
+
+		// Don't attempt to resolve fdl.dtd
+		factory = DocumentBuilderFactory.newInstance();
+		factory.setValidating(false);
+		factory.setFeature("http://apache.org/xml/features/nonvalidating/load-external-dtd", false);
+		builder = factory.newDocumentBuilder();
+		document = builder.parse(passFile);
+
+		return document.getDocumentElement();
+	}
+}
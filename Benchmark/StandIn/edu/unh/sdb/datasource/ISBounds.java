@@ -0,0 +1,48 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: Benchmark/StandIn/edu/unh/sdb/datasource/ISBounds.java
+ Author: Toni Westbrook
+
+ Local stand-in for the Granite class of the same name, implementing only
+ the methods used through JNI by GraniteWrapper.
+
+ =========================================================================*/
+
+package edu.unh.sdb.datasource;
+
+public class ISBounds {
+	private final int[] _lower;
+	private final int[] _upper;
+
+	public ISBounds(int[] passLower, int[] passUpper) {
+		_lower = passLower.clone();
+		_upper = passUpper.clone();
+	}
+
+	public int dim() {
+		return _lower.length;
+	}
+
+	public int getLower(int passDim) {
+		return _lower[passDim];
+	}
+
+	public int getUpper(int passDim) {
+		return _upper[passDim];
+	}
+
+	public int length(int passDim) {
+		return _upper[passDim] - _lower[passDim] + 1;
+	}
+
+	public int size() {
+		int total = 1;
+
+		for (int dimIdx = 0 ; dimIdx < _lower.length ; dimIdx++) {
+			total *= length(dimIdx);
+		}
+
+		return total;
+	}
+}
@@ -0,0 +1,90 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: Benchmark/StandIn/edu/unh/sdb/datasource/MRDataSource.java
+ Author: Toni Westbrook
+
+ Local stand-in for the Granite class of the same name, implementing only
+ the methods used through JNI by GraniteWrapper.  Levels are discovered in
+ the nested levelN directory layout written by vtkGraniteWriter, with
+ level 0 being the finest resolution.
+
+ =========================================================================*/
+
+package edu.unh.sdb.datasource;
+
+import java.io.File;
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.List;
+
+import edu.unh.sdb.common.RecordDescriptor;
+
+public class MRDataSource extends DataSource {
+	private final List<DataSource> _levels;
+	private int _current;
+
+	protected MRDataSource(String passName, File passDescriptorFile, String passRootBinary) {
+		super(passName, passDescriptorFile);
+
+		File rootBinary, levelDirectory, levelFile;
+		String binaryName;
+
+		_levels = new ArrayList<DataSource>();
+		_current = 0;
+
+		// Root level header shares the base name of its binary
+		rootBinary = new File(passDescriptorFile.getParentFile(), passRootBinary);
+		levelDirectory = rootBinary.getParentFile();
+		binaryName = rootBinary.getName();
+		levelFile = new File(levelDirectory, binaryName.substring(0, binaryName.length() - 4) + ".xfdl");
+
+		// Walk nested level directories until no further header exists
+		for (int levelIdx = 1 ; levelFile.exists() ; levelIdx++) {
+			_levels.add(new DataSource(passName + levelIdx, levelFile));
+			levelDirectory = new File(levelDirectory, "level" + levelIdx);
+			levelFile = new File(levelDirectory, binaryName + ".d" + levelIdx + ".fdl");
+		}
+	}
+
+	public void activate() throws Exception {
+		for (DataSource currentLevel : _levels) {
+			currentLevel.activate();
+		}
+	}
+
+	public boolean changeResolution(int passLevel) {
+		if (passLevel < 0 || passLevel >= _levels.size()) return false;
+		_current = passLevel;
+
+		return true;
+	}
+
+	public boolean coarser() {
+		return changeResolution(_current + 1);
+	}
+
+	public int getNumResolutionLevels() {
+		return _levels.size();
+	}
+
+	public int dim() {
+		return _levels.get(_current).dim();
+	}
+
+	public DataBlock subblock(ISBounds passBounds) throws IOException {
+		return _levels.get(_current).subblock(passBounds);
+	}
+
+	public ISBounds getBounds() {
+		return _levels.get(_current).getBounds();
+	}
+
+	public float[] getFloats() {
+		return _levels.get(_current).getFloats();
+	}
+
+	public RecordDescriptor getRecordDescriptor() {
+		return _levels.get(_current).getRecordDescriptor();
+	}
+}
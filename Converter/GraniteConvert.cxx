@@ -0,0 +1,488 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteConvert.cxx
+ Author: Toni Westbrook
+
+ Headless batch conversion of VTK, MetaImage, raw and DICOM volumes to
+ Granite XFDL/BIN datasets through vtkGraniteWriter.  Inputs are
+ converted concurrently, one reader and writer per worker, and the
+ throughput of each conversion and of the whole batch is reported.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#include <direct.h>
+#endif
+
+#include "vtkAlgorithm.h"
+#include "vtkDataSet.h"
+#include "vtkDataSetReader.h"
+#include "vtkDICOMImageReader.h"
+#include "vtkErrorCode.h"
+#include "vtkImageReader.h"
+#include "vtkMetaImageReader.h"
+#include "vtkPointData.h"
+#include "vtkSmartPointer.h"
+#include "vtkXMLImageDataReader.h"
+#include "vtkXMLRectilinearGridReader.h"
+
+#include "vtkGraniteWriter.h"
+
+class GraniteConvert {
+	public:
+		GraniteConvert();
+
+		bool parseArguments(int passCount, char * * passArguments);
+		int run();
+
+	private:
+		// Supported input formats
+		enum FormatDef { Auto, // By extension (directories are DICOM series)
+						 Legacy, // .vtk
+						 ImageXML, // .vti
+						 RectilinearXML, // .vtr
+						 MetaImage, // .mhd, .mha
+						 Raw, // Headerless volume (see --raw-* options)
+						 DICOM, // Directory series or single file
+						 FormatCount };
+
+		// Per conversion measurements
+		struct ConvertResult {
+			std::string name;
+			unsigned long long bytes;
+			double seconds;
+			bool success;
+		};
+
+		void convertFile(int passFileIdx, ConvertResult * retResult);
+		vtkAlgorithm * createReader(std::string passFileName); // Reader for input's format (NULL if unsupported)
+		FormatDef getFormat(std::string passFileName);
+		std::string getOutputName(std::string passFileName);
+		unsigned long long getStoredBytes(vtkDataSet * passData); // Granite bytes of full resolution (float per component)
+		void report(ConvertResult passResult);
+		void printUsage(const char * passProgram);
+		double elapsed(std::chrono::steady_clock::time_point passStart);
+
+		std::vector< std::string > _inputNames;
+		std::string _outputDirectory;
+		FormatDef _format;
+		int _jobs;
+		int _threads; // Writer threads per job (0 shares the cores between jobs)
+		int _levelCount, _levelSteps;
+		bool _resample;
+		bool _nativeStorage;
+		bool _container; // Multiresolution levels in one binary
+		int _encoding; // Stored encoding of native storage (see GraniteStorage::EncodingDef)
+		int _memoryBudget;
+		int _rawDimensions[3];
+		int _rawType;
+		int _rawComponents;
+		double _rawSpacing[3];
+		bool _rawLittleEndian;
+		std::mutex _reportLock; // Serializes report lines from workers
+};
+
+GraniteConvert::GraniteConvert() {
+	_outputDirectory = ".";
+	_format = FormatDef::Auto;
+	_jobs = std::max< int >(1, std::thread::hardware_concurrency());
+	_threads = 0;
+	_levelCount = 1;
+	_levelSteps = 2;
+	_resample = true;
+	_nativeStorage = false;
+	_container = false;
+	_encoding = GraniteStorage::Float32;
+	_memoryBudget = 1024;
+	_rawType = VTK_FLOAT;
+	_rawComponents = 1;
+	_rawLittleEndian = true;
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		_rawDimensions[dimIdx] = 0;
+		_rawSpacing[dimIdx] = 1;
+	}
+}
+
+bool GraniteConvert::parseArguments(int passCount, char * * passArguments) {
+	std::string currentArg, currentValue;
+	bool validValues;
+
+	validValues = true;
+	for (int argIdx = 1 ; argIdx < passCount ; argIdx++) {
+		currentArg = passArguments[argIdx];
+
+		// Anything not a flag is an input
+		if (currentArg.compare(0, 2, "--") != 0) {
+			_inputNames.push_back(currentArg);
+			continue;
+		}
+
+		// Flags without a value
+		if (currentArg == "--container") {
+			_container = true;
+			continue;
+		}
+		else if (currentArg == "--no-resample") {
+			_resample = false;
+			continue;
+		}
+
+		// Flags followed by a single value
+		if (argIdx + 1 >= passCount) {
+			printUsage(passArguments[0]);
+			return false;
+		}
+
+		if (currentArg == "--output") _outputDirectory = passArguments[++argIdx];
+		else if (currentArg == "--jobs") _jobs = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--threads") _threads = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--levels") _levelCount = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--steps") _levelSteps = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--memory-budget") _memoryBudget = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--raw-components") _rawComponents = atoi(passArguments[++argIdx]);
+		else if (currentArg == "--layout") {
+			currentValue = passArguments[++argIdx];
+			if (currentValue == "granite") _nativeStorage = false;
+			else if (currentValue == "native") _nativeStorage = true;
+			else validValues = false;
+		}
+		else if (currentArg == "--encoding") {
+			currentValue = passArguments[++argIdx];
+			_encoding = GraniteStorage::parseEncoding(currentValue);
+			if (currentValue != GraniteStorage::getEncodingName((GraniteStorage::EncodingDef) _encoding)) validValues = false;
+		}
+		else if (currentArg == "--format") {
+			currentValue = passArguments[++argIdx];
+			if (currentValue == "auto") _format = FormatDef::Auto;
+			else if (currentValue == "vtk") _format = FormatDef::Legacy;
+			else if (currentValue == "vti") _format = FormatDef::ImageXML;
+			else if (currentValue == "vtr") _format = FormatDef::RectilinearXML;
+			else if (currentValue == "mhd") _format = FormatDef::MetaImage;
+			else if (currentValue == "raw") _format = FormatDef::Raw;
+			else if (currentValue == "dicom") _format = FormatDef::DICOM;
+			else validValues = false;
+		}
+		else if (currentArg == "--raw-type") {
+			currentValue = passArguments[++argIdx];
+			if (currentValue == "int8") _rawType = VTK_SIGNED_CHAR;
+			else if (currentValue == "uint8") _rawType = VTK_UNSIGNED_CHAR;
+			else if (currentValue == "int16") _rawType = VTK_SHORT;
+			else if (currentValue == "uint16") _rawType = VTK_UNSIGNED_SHORT;
+			else if (currentValue == "int32") _rawType = VTK_INT;
+			else if (currentValue == "uint32") _rawType = VTK_UNSIGNED_INT;
+			else if (currentValue == "float32") _rawType = VTK_FLOAT;
+			else if (currentValue == "float64") _rawType = VTK_DOUBLE;
+			else validValues = false;
+		}
+		else if (currentArg == "--raw-endian") {
+			currentValue = passArguments[++argIdx];
+			if (currentValue == "little") _rawLittleEndian = true;
+			else if (currentValue == "big") _rawLittleEndian = false;
+			else validValues = false;
+		}
+		else if (currentArg == "--raw-dims" && argIdx + 3 < passCount) {
+			_rawDimensions[0] = atoi(passArguments[++argIdx]);
+			_rawDimensions[1] = atoi(passArguments[++argIdx]);
+			_rawDimensions[2] = atoi(passArguments[++argIdx]);
+		}
+		else if (currentArg == "--raw-spacing" && argIdx + 3 < passCount) {
+			_rawSpacing[0] = atof(passArguments[++argIdx]);
+			_rawSpacing[1] = atof(passArguments[++argIdx]);
+			_rawSpacing[2] = atof(passArguments[++argIdx]);
+		}
+		else {
+			printUsage(passArguments[0]);
+			return false;
+		}
+	}
+
+	// Validate
+	if (!validValues || _inputNames.empty() || _jobs < 1 || _threads < 0 || _levelCount < 1 || _levelSteps < 2 || _memoryBudget < 0 || _rawComponents < 1) {
+		printUsage(passArguments[0]);
+		return false;
+	}
+
+	for (int inputIdx = 0 ; inputIdx < _inputNames.size() ; inputIdx++) {
+		if (getFormat(_inputNames[inputIdx]) == FormatDef::Raw && (_rawDimensions[0] < 1 || _rawDimensions[1] < 1 || _rawDimensions[2] < 1)) {
+			fprintf(stderr, "ERROR: Raw input %s requires --raw-dims\n", _inputNames[inputIdx].c_str());
+			return false;
+		}
+	}
+
+	if (!_outputDirectory.empty() && _outputDirectory.back() != '/') _outputDirectory += "/";
+
+	return true;
+}
+
+int GraniteConvert::run() {
+	std::vector< std::thread > convertWorkers;
+	std::vector< ConvertResult > results;
+	std::atomic< int > nextFile;
+	std::chrono::steady_clock::time_point startTime;
+	ConvertResult totalResult;
+	int workerCount, failedCount;
+
+	#ifdef _WIN32
+		mkdir(_outputDirectory.c_str());
+	#else
+		mkdir(_outputDirectory.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+	#endif
+
+	printf("%-40s %14s %10s %10s\n", "file", "bytes", "seconds", "MB/s");
+
+	// Each worker takes the next unconverted input until none remain
+	startTime = std::chrono::steady_clock::now();
+	results.resize(_inputNames.size());
+	nextFile = 0;
+	workerCount = std::min< int >(_jobs, _inputNames.size());
+
+	// Concurrent jobs split the cores, rather than each writer taking one thread per core
+	if (_threads == 0) _threads = std::max< int >(1, std::thread::hardware_concurrency() / workerCount);
+
+	for (int workerIdx = 0 ; workerIdx < workerCount ; workerIdx++) {
+		convertWorkers.push_back(std::thread([this, &nextFile, &results] {
+			for (int fileIdx = nextFile++ ; fileIdx < _inputNames.size() ; fileIdx = nextFile++) {
+				convertFile(fileIdx, &results[fileIdx]);
+			}
+		}));
+	}
+
+	for (int workerIdx = 0 ; workerIdx < convertWorkers.size() ; workerIdx++) {
+		convertWorkers[workerIdx].join();
+	}
+
+	// Batch throughput is against wall time, so it reflects concurrency
+	totalResult.name = "total (" + std::to_string(workerCount) + " jobs)";
+	totalResult.bytes = 0;
+	totalResult.seconds = elapsed(startTime);
+	totalResult.success = true;
+	failedCount = 0;
+
+	for (int fileIdx = 0 ; fileIdx < results.size() ; fileIdx++) {
+		if (results[fileIdx].success) totalResult.bytes += results[fileIdx].bytes;
+		else failedCount++;
+	}
+
+	printf("\n");
+	report(totalResult);
+
+	if (failedCount > 0) {
+		fprintf(stderr, "ERROR: %d of %d conversions failed\n", failedCount, (int) results.size());
+		return 1;
+	}
+
+	return 0;
+}
+
+void GraniteConvert::convertFile(int passFileIdx, ConvertResult * retResult) {
+	vtkSmartPointer< vtkAlgorithm > reader;
+	vtkSmartPointer< vtkGraniteWriter > writer;
+	vtkDataSet * inputData;
+	std::chrono::steady_clock::time_point startTime;
+	std::string outputName;
+
+	retResult->name = _inputNames[passFileIdx];
+	retResult->bytes = 0;
+	retResult->success = false;
+	startTime = std::chrono::steady_clock::now();
+
+	// Read
+	reader.TakeReference(createReader(_inputNames[passFileIdx]));
+	if (reader.GetPointer() == NULL) {
+		fprintf(stderr, "ERROR: Unsupported input %s\n", _inputNames[passFileIdx].c_str());
+		return;
+	}
+
+	reader->Update();
+	inputData = vtkDataSet::SafeDownCast(reader->GetOutputDataObject(0));
+	if (inputData == NULL || inputData->GetNumberOfPoints() == 0) {
+		fprintf(stderr, "ERROR: Unable to read %s\n", _inputNames[passFileIdx].c_str());
+		return;
+	}
+
+	// Write (the writer reports unsupported dataset types itself)
+	outputName = getOutputName(_inputNames[passFileIdx]);
+
+	writer = vtkSmartPointer< vtkGraniteWriter >::New();
+	writer->setFileBase(outputName.c_str());
+	writer->setResample(_resample);
+	writer->setMultiresolution(_levelCount, _levelSteps);
+	writer->setNativeStorage(_nativeStorage);
+	writer->setContainer(_container);
+	writer->setEncoding(_encoding);
+	writer->setMemoryBudget(_memoryBudget);
+	writer->setThreadCount(_threads);
+	writer->SetInputData(inputData);
+	writer->Write();
+
+	// Writer reports unsupported inputs and failed files through its error code
+	retResult->success = (writer->GetErrorCode() == vtkErrorCode::NoError);
+	retResult->bytes = getStoredBytes(inputData);
+	retResult->seconds = elapsed(startTime);
+
+	if (!retResult->success) fprintf(stderr, "ERROR: Unable to write %s\n", outputName.c_str());
+	else report(*retResult);
+}
+
+vtkAlgorithm * GraniteConvert::createReader(std::string passFileName) {
+	vtkDataSetReader * legacyReader;
+	vtkXMLImageDataReader * imageReader;
+	vtkXMLRectilinearGridReader * rectilinearReader;
+	vtkMetaImageReader * metaReader;
+	vtkImageReader * rawReader;
+	vtkDICOMImageReader * dicomReader;
+	struct stat fileStat;
+
+	switch (getFormat(passFileName)) {
+		case FormatDef::Legacy:
+			legacyReader = vtkDataSetReader::New();
+			legacyReader->SetFileName(passFileName.c_str());
+			legacyReader->ReadAllScalarsOn();
+			legacyReader->ReadAllVectorsOn();
+			legacyReader->ReadAllTensorsOn();
+			legacyReader->ReadAllFieldsOn();
+			return legacyReader;
+
+		case FormatDef::ImageXML:
+			imageReader = vtkXMLImageDataReader::New();
+			imageReader->SetFileName(passFileName.c_str());
+			return imageReader;
+
+		case FormatDef::RectilinearXML:
+			rectilinearReader = vtkXMLRectilinearGridReader::New();
+			rectilinearReader->SetFileName(passFileName.c_str());
+			return rectilinearReader;
+
+		case FormatDef::MetaImage:
+			metaReader = vtkMetaImageReader::New();
+			metaReader->SetFileName(passFileName.c_str());
+			return metaReader;
+
+		case FormatDef::Raw:
+			rawReader = vtkImageReader::New();
+			rawReader->SetFileName(passFileName.c_str());
+			rawReader->SetFileDimensionality(3);
+			rawReader->SetDataExtent(0, _rawDimensions[0] - 1, 0, _rawDimensions[1] - 1, 0, _rawDimensions[2] - 1);
+			rawReader->SetDataSpacing(_rawSpacing);
+			rawReader->SetDataScalarType(_rawType);
+			rawReader->SetNumberOfScalarComponents(_rawComponents);
+			if (_rawLittleEndian) rawReader->SetDataByteOrderToLittleEndian();
+			else rawReader->SetDataByteOrderToBigEndian();
+			rawReader->SetScalarArrayName("Scalars");
+			return rawReader;
+
+		case FormatDef::DICOM:
+			dicomReader = vtkDICOMImageReader::New();
+			if (stat(passFileName.c_str(), &fileStat) == 0 && (fileStat.st_mode & S_IFDIR)) dicomReader->SetDirectoryName(passFileName.c_str());
+			else dicomReader->SetFileName(passFileName.c_str());
+			return dicomReader;
+
+		default:
+			return NULL;
+	}
+}
+
+GraniteConvert::FormatDef GraniteConvert::getFormat(std::string passFileName) {
+	std::string extension;
+	struct stat fileStat;
+	size_t extensionPos;
+
+	if (_format != FormatDef::Auto) return _format;
+
+	// Directories hold DICOM series
+	if (stat(passFileName.c_str(), &fileStat) == 0 && (fileStat.st_mode & S_IFDIR)) return FormatDef::DICOM;
+
+	extensionPos = passFileName.find_last_of('.');
+	if (extensionPos == std::string::npos) return FormatDef::FormatCount;
+
+	extension = passFileName.substr(extensionPos + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	if (extension == "vtk") return FormatDef::Legacy;
+	if (extension == "vti") return FormatDef::ImageXML;
+	if (extension == "vtr") return FormatDef::RectilinearXML;
+	if (extension == "mhd" || extension == "mha") return FormatDef::MetaImage;
+	if (extension == "raw" || extension == "dat") return FormatDef::Raw;
+	if (extension == "dcm") return FormatDef::DICOM;
+
+	return FormatDef::FormatCount;
+}
+
+std::string GraniteConvert::getOutputName(std::string passFileName) {
+	std::string outputBase;
+	size_t extensionPos;
+
+	// Input's name without directory or extension
+	while (passFileName.length() > 1 && (passFileName.back() == '/' || passFileName.back() == '\\')) passFileName.pop_back();
+	outputBase = passFileName.substr(passFileName.find_last_of("/\\") + 1);
+	extensionPos = outputBase.find_last_of('.');
+	if (extensionPos != std::string::npos && extensionPos > 0) outputBase = outputBase.substr(0, extensionPos);
+
+	return _outputDirectory + outputBase + ".xfdl";
+}
+
+unsigned long long GraniteConvert::getStoredBytes(vtkDataSet * passData) {
+	unsigned long long componentCount;
+
+	componentCount = 0;
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+		if (passData->GetPointData()->GetArray(arrayIdx)) componentCount += passData->GetPointData()->GetArray(arrayIdx)->GetNumberOfComponents();
+	}
+
+	return (unsigned long long) passData->GetNumberOfPoints() * componentCount * sizeof(float);
+}
+
+void GraniteConvert::report(ConvertResult passResult) {
+	double throughput;
+
+	throughput = (passResult.seconds > 0 ? passResult.bytes / (1024.0 * 1024.0) / passResult.seconds : 0);
+
+	std::lock_guard< std::mutex > guard(_reportLock);
+	printf("%-40s %14llu %10.4f %10.2f\n", passResult.name.c_str(), passResult.bytes, passResult.seconds, throughput);
+	fflush(stdout);
+}
+
+void GraniteConvert::printUsage(const char * passProgram) {
+	fprintf(stderr, "Usage: %s [options] <input> [input ...]\n", passProgram);
+	fprintf(stderr, "  --output <dir>              Directory for converted datasets (default .)\n");
+	fprintf(stderr, "  --jobs <n>                  Inputs converted concurrently (default one per core)\n");
+	fprintf(stderr, "  --threads <n>               Writer threads per job (default cores divided between jobs)\n");
+	fprintf(stderr, "  --format <type>             auto, vtk, vti, vtr, mhd, raw or dicom (default auto, by extension)\n");
+	fprintf(stderr, "  --levels <n>                Multiresolution levels (default 1)\n");
+	fprintf(stderr, "  --steps <n>                 Downsampling factor between levels (default 2)\n");
+	fprintf(stderr, "  --container                 Write multiresolution levels into one binary with an offset table\n");
+	fprintf(stderr, "  --no-resample               Keep image spacing instead of resampling to unit spacing\n");
+	fprintf(stderr, "  --layout <type>             granite or native (host order planar, single resolution or container only) (default granite)\n");
+	fprintf(stderr, "  --encoding <type>           float32, uint8, uint16 (quantized) or float16 for native layout (default float32)\n");
+	fprintf(stderr, "  --memory-budget <MB>        Resampled levels held at once per job (default 1024, 0 is unlimited)\n");
+	fprintf(stderr, "  --raw-dims <x> <y> <z>      Points per axis of raw inputs\n");
+	fprintf(stderr, "  --raw-type <type>           int8, uint8, int16, uint16, int32, uint32, float32 or float64 (default float32)\n");
+	fprintf(stderr, "  --raw-components <n>        Components per point of raw inputs (default 1)\n");
+	fprintf(stderr, "  --raw-spacing <x> <y> <z>   Spacing of raw inputs (default 1 1 1)\n");
+	fprintf(stderr, "  --raw-endian <order>        little or big (default little)\n");
+}
+
+double GraniteConvert::elapsed(std::chrono::steady_clock::time_point passStart) {
+	return std::chrono::duration< double >(std::chrono::steady_clock::now() - passStart).count();
+}
+
+int main(int argc, char * argv[]) {
+	GraniteConvert converter;
+
+	if (converter.parseArguments(argc, argv) == false) return 1;
+
+	return converter.run();
+}
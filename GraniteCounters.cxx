@@ -0,0 +1,237 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteCounters.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <cstdio>
+
+#include "GraniteCounters.h"
+
+GraniteCounters::ScopedTimer::ScopedTimer(GraniteCounters * passCounters, TimerDef passTimer) {
+	_counters = passCounters;
+	_timer = passTimer;
+	_start = std::chrono::steady_clock::now();
+}
+
+GraniteCounters::ScopedTimer::~ScopedTimer() {
+	_counters->addTime(_timer, std::chrono::steady_clock::now() - _start);
+}
+
+GraniteCounters::ScopedMemory::ScopedMemory(GraniteCounters * passCounters, MemoryDef passMemory, long long passBytes) {
+	_counters = passCounters;
+	_memory = passMemory;
+	_bytes = passBytes;
+	_counters->allocate(_memory, _bytes);
+}
+
+GraniteCounters::ScopedMemory::~ScopedMemory() {
+	_counters->release(_memory, _bytes);
+}
+
+GraniteCounters::GraniteCounters() {
+	for (int memoryIdx = 0 ; memoryIdx < MemoryDef::MemoryCount ; memoryIdx++) {
+		_memory[memoryIdx] = 0;
+	}
+	_memoryTotal = 0;
+
+	reset();
+}
+
+void GraniteCounters::increment(CounterDef passCounter, unsigned long long passAmount) {
+	_counters[passCounter] += passAmount;
+	if (this != getProcessTotals()) getProcessTotals()->_counters[passCounter] += passAmount;
+}
+
+void GraniteCounters::addTime(TimerDef passTimer, std::chrono::steady_clock::duration passElapsed) {
+	unsigned long long elapsedNS;
+
+	elapsedNS = std::chrono::duration_cast< std::chrono::nanoseconds >(passElapsed).count();
+	_timers[passTimer] += elapsedNS;
+	if (this != getProcessTotals()) getProcessTotals()->_timers[passTimer] += elapsedNS;
+}
+
+unsigned long long GraniteCounters::getCounter(CounterDef passCounter) {
+	return _counters[passCounter];
+}
+
+double GraniteCounters::getTime(TimerDef passTimer) {
+	return _timers[passTimer] / 1.0e9;
+}
+
+unsigned long long GraniteCounters::getJNICallCount() {
+	unsigned long long total;
+
+	total = 0;
+	for (int counterIdx = CounterDef::JNICreate ; counterIdx <= CounterDef::JNIChangeResolution ; counterIdx++) {
+		total += _counters[counterIdx];
+	}
+
+	return total;
+}
+
+void GraniteCounters::beginOperation() {
+	// Arrays of earlier operations belong to their outputs now, while sampled gauges describe the process and carry over
+	for (int memoryIdx = 0 ; memoryIdx < MemoryDef::MemoryCount ; memoryIdx++) {
+		if (memoryIdx != MemoryDef::MemoryJVMHeap) _memory[memoryIdx] = 0;
+		_memoryPeaks[memoryIdx] = _memory[memoryIdx].load();
+	}
+
+	_memoryTotal = _memory[MemoryDef::MemoryJVMHeap].load();
+	_memoryPeak = _memoryTotal.load();
+}
+
+void GraniteCounters::allocate(MemoryDef passMemory, long long passBytes) {
+	adjustMemory(passMemory, passBytes);
+}
+
+void GraniteCounters::release(MemoryDef passMemory, long long passBytes) {
+	adjustMemory(passMemory, -passBytes);
+}
+
+void GraniteCounters::sampleMemory(MemoryDef passMemory, long long passBytes) {
+	long long previousBytes;
+
+	previousBytes = _memory[passMemory].exchange(passBytes);
+	raisePeak(&_memoryPeaks[passMemory], passBytes);
+	raisePeak(&_memoryPeak, _memoryTotal += passBytes - previousBytes);
+}
+
+long long GraniteCounters::getMemory(MemoryDef passMemory) {
+	return _memory[passMemory];
+}
+
+long long GraniteCounters::getPeakMemory(MemoryDef passMemory) {
+	return _memoryPeaks[passMemory];
+}
+
+long long GraniteCounters::getPeakMemory() {
+	return _memoryPeak;
+}
+
+void GraniteCounters::reset() {
+	for (int counterIdx = 0 ; counterIdx < CounterDef::CounterCount ; counterIdx++) {
+		_counters[counterIdx] = 0;
+	}
+
+	for (int timerIdx = 0 ; timerIdx < TimerDef::TimerCount ; timerIdx++) {
+		_timers[timerIdx] = 0;
+	}
+
+	// Bytes still held stay accounted (they are released later), only peaks restart
+	for (int memoryIdx = 0 ; memoryIdx < MemoryDef::MemoryCount ; memoryIdx++) {
+		_memoryPeaks[memoryIdx] = _memory[memoryIdx].load();
+	}
+	_memoryPeak = _memoryTotal.load();
+}
+
+std::string GraniteCounters::getReport(const char * passIndent) {
+	std::string retReport;
+	char lineBuffer[128];
+
+	// Counters, then timers in seconds
+	for (int counterIdx = 0 ; counterIdx < CounterDef::CounterCount ; counterIdx++) {
+		snprintf(lineBuffer, sizeof(lineBuffer), "%s%s: %llu\n", passIndent, getCounterName((CounterDef) counterIdx), getCounter((CounterDef) counterIdx));
+		retReport += lineBuffer;
+	}
+
+	for (int timerIdx = 0 ; timerIdx < TimerDef::TimerCount ; timerIdx++) {
+		snprintf(lineBuffer, sizeof(lineBuffer), "%s%s: %.6f\n", passIndent, getTimerName((TimerDef) timerIdx), getTime((TimerDef) timerIdx));
+		retReport += lineBuffer;
+	}
+
+	// Memory peaks in bytes, each gauge then all together
+	for (int memoryIdx = 0 ; memoryIdx < MemoryDef::MemoryCount ; memoryIdx++) {
+		snprintf(lineBuffer, sizeof(lineBuffer), "%s%s: %lld\n", passIndent, getMemoryName((MemoryDef) memoryIdx), getPeakMemory((MemoryDef) memoryIdx));
+		retReport += lineBuffer;
+	}
+
+	snprintf(lineBuffer, sizeof(lineBuffer), "%sPeak Memory: %lld\n", passIndent, getPeakMemory());
+	retReport += lineBuffer;
+
+	return retReport;
+}
+
+GraniteCounters * GraniteCounters::getProcessTotals() {
+	static GraniteCounters processTotals;
+
+	return &processTotals;
+}
+
+const char * GraniteCounters::getCounterName(CounterDef passCounter) {
+	static const char * counterNames[CounterDef::CounterCount] = { "JNI DataSource.create Calls",
+																   "JNI DataSource.activate Calls",
+																   "JNI Metadata Calls",
+																   "JNI ISBounds Creations",
+																   "JNI DataSource.subblock Calls",
+																   "JNI DataCollection.getFloats Calls",
+																   "JNI MRDataSource.changeResolution Calls",
+																   "Bytes Transferred",
+																   "Slices Fetched",
+																   "Reads Cancelled",
+																   "Blocks Fetched",
+																   "Blocks Culled",
+																   "Blocks Coalesced",
+																   "Level Fetches",
+																   "Level Switches",
+																   "Level Cache Hits",
+																   "Bytes Written",
+																   "Bytes Mapped",
+																   "Extent Cache Hits",
+																   "Extent Cache Partial Hits",
+																   "Resample Slabs",
+																   "Resamples Skipped",
+																   "Worker Process Requests",
+																   "Node Cache Hits",
+																   "Node Cache Fills",
+																   "Slices Prefetched",
+																   "Slice Prefetch Hits" };
+
+	return counterNames[passCounter];
+}
+
+const char * GraniteCounters::getTimerName(TimerDef passTimer) {
+	static const char * timerNames[TimerDef::TimerCount] = { "Open Time",
+															 "Metadata Time",
+															 "XML Parse Time",
+															 "Subblock Time",
+															 "GetFloats Time",
+															 "Array Copy Time",
+															 "Level Switch Time",
+															 "Block Read Time",
+															 "Resample Time",
+															 "Write XFDL Time",
+															 "Write Binary Time",
+															 "Native Read Time" };
+
+	return timerNames[passTimer];
+}
+
+const char * GraniteCounters::getMemoryName(MemoryDef passMemory) {
+	static const char * memoryNames[MemoryDef::MemoryCount] = { "Peak Array Memory",
+																"Peak Scratch Memory",
+																"Peak Resample Memory",
+																"Peak JNI Buffer Memory",
+																"Peak I/O Buffer Memory",
+																"Peak JVM Heap" };
+
+	return memoryNames[passMemory];
+}
+
+void GraniteCounters::adjustMemory(MemoryDef passMemory, long long passBytes) {
+	raisePeak(&_memoryPeaks[passMemory], _memory[passMemory] += passBytes);
+	raisePeak(&_memoryPeak, _memoryTotal += passBytes);
+}
+
+void GraniteCounters::raisePeak(std::atomic< long long > * retPeak, long long passValue) {
+	long long currentPeak;
+
+	// Gauges are adjusted from several threads (e.g. writer levels), so peaks only ever move up
+	currentPeak = retPeak->load();
+	while (passValue > currentPeak && !retPeak->compare_exchange_weak(currentPeak, passValue));
+}
@@ -0,0 +1,134 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteCounters.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteCounters_h
+#define __GraniteCounters_h
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+class GraniteCounters {
+	public:
+		// Supported counters
+		enum CounterDef { JNICreate,
+						  JNIActivate,
+						  JNIMetadata,
+						  JNIBoundsCreate,
+						  JNISubblock,
+						  JNIGetFloats,
+						  JNIChangeResolution,
+						  BytesTransferred,
+						  SlicesFetched,
+						  ReadsCancelled,
+						  BlocksFetched,
+						  BlocksCulled,
+						  BlocksCoalesced,
+						  LevelFetches,
+						  LevelSwitches,
+						  LevelCacheHits,
+						  BytesWritten,
+						  BytesMapped,
+						  ExtentCacheHits,
+						  ExtentCachePartialHits,
+						  ResampleSlabs,
+						  ResamplesSkipped,
+						  WorkerRequests,
+						  NodeCacheHits,
+						  NodeCacheFills,
+						  SlicesPrefetched,
+						  SlicePrefetchHits,
+						  CounterCount };
+
+		// Supported phase timers
+		enum TimerDef { TimeOpen,
+						TimeMetadata,
+						TimeXMLParse,
+						TimeSubblock,
+						TimeGetFloats,
+						TimeArrayCopy,
+						TimeLevelSwitch,
+						TimeBlockRead,
+						TimeResample,
+						TimeWriteXFDL,
+						TimeWriteBinary,
+						TimeNativeRead,
+						TimerCount };
+
+		// Supported memory gauges (bytes held by one read or write, and the most held at once)
+		enum MemoryDef { MemoryArrays, // Output arrays
+						 MemoryScratch, // Temporary arrays (extent cache slabs, AMR level fetches)
+						 MemoryResample, // Resampled copies (writer)
+						 MemoryJNI, // Floats copied out of the JVM
+						 MemoryBuffers, // Native storage read and write buffers
+						 MemoryJVMHeap, // JVM heap committed (Runtime.totalMemory, sampled rather than allocated)
+						 MemoryCount };
+
+		// Adds elapsed time to a phase timer for the lifetime of the object
+		class ScopedTimer {
+			public:
+				ScopedTimer(GraniteCounters * passCounters, TimerDef passTimer);
+				~ScopedTimer();
+
+			private:
+				GraniteCounters * _counters;
+				TimerDef _timer;
+				std::chrono::steady_clock::time_point _start;
+		};
+
+		// Holds bytes against a memory gauge for the lifetime of the object
+		class ScopedMemory {
+			public:
+				ScopedMemory(GraniteCounters * passCounters, MemoryDef passMemory, long long passBytes);
+				~ScopedMemory();
+
+			private:
+				GraniteCounters * _counters;
+				MemoryDef _memory;
+				long long _bytes;
+		};
+
+		GraniteCounters();
+
+		void increment(CounterDef passCounter, unsigned long long passAmount = 1); // Add to counter (and process totals)
+		void addTime(TimerDef passTimer, std::chrono::steady_clock::duration passElapsed); // Add to phase timer (and process totals)
+		unsigned long long getCounter(CounterDef passCounter);
+		double getTime(TimerDef passTimer); // Seconds spent in phase
+		unsigned long long getJNICallCount(); // Sum of all JNI method counters
+		void beginOperation(); // Start of a read or write - gauges (other than sampled ones) and their peaks restart from zero
+		void allocate(MemoryDef passMemory, long long passBytes); // Bytes now held against a gauge
+		void release(MemoryDef passMemory, long long passBytes);
+		void sampleMemory(MemoryDef passMemory, long long passBytes); // Set a sampled gauge outright
+		long long getMemory(MemoryDef passMemory); // Bytes held now
+		long long getPeakMemory(MemoryDef passMemory); // Most bytes held at once in the current operation
+		long long getPeakMemory(); // Most bytes held at once across all gauges
+		void reset();
+		std::string getReport(const char * passIndent = ""); // One "name: value" line per counter, timer and memory peak
+
+		static GraniteCounters * getProcessTotals(); // Totals across all readers and writers
+		static const char * getCounterName(CounterDef passCounter);
+		static const char * getTimerName(TimerDef passTimer);
+		static const char * getMemoryName(MemoryDef passMemory);
+
+	private:
+		GraniteCounters(const GraniteCounters&);  // Not implemented
+		void operator=(const GraniteCounters&);  // Not implemented
+
+		void adjustMemory(MemoryDef passMemory, long long passBytes); // Add to gauge and total, raising peaks
+		static void raisePeak(std::atomic< long long > * retPeak, long long passValue);
+
+		std::atomic< unsigned long long > _counters[CounterDef::CounterCount];
+		std::atomic< unsigned long long > _timers[TimerDef::TimerCount]; // Nanoseconds
+		std::atomic< long long > _memory[MemoryDef::MemoryCount], _memoryPeaks[MemoryDef::MemoryCount]; // Bytes (per operation, not summed into process totals)
+		std::atomic< long long > _memoryTotal, _memoryPeak;
+};
+
+#endif // __GraniteCounters_h
@@ -0,0 +1,260 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteExtentCache.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cstring>
+
+#include "vtkSMPTools.h"
+#include "GraniteExtentCache.h"
+#include "GraniteTrace.h"
+#include "vtkGraniteSettings.h"
+
+GraniteExtentCache * GraniteExtentCache::getInstance() {
+	static GraniteExtentCache instance;
+
+	return &instance;
+}
+
+bool GraniteExtentCache::read(std::string passKey, int * passBounds, vtkPointData * retData, FetchDef passFetch, GraniteCounters * passCounters) {
+	vtkSmartPointer< vtkPointData > scratchData;
+	Entry cachedEntry;
+	int fetchBounds[6], slabBounds[6], region[6];
+
+	GraniteTrace::Span cacheSpan("readExtent", "read", passKey.c_str());
+
+	// Caching disabled
+	if (vtkGraniteSettings::GetInstance()->getExtentCacheSize() <= 0) {
+		memcpy(fetchBounds, passBounds, sizeof(fetchBounds));
+		passCounters->allocate(GraniteCounters::MemoryArrays, sizeArrays(fetchBounds, retData));
+
+		return passFetch(fetchBounds, retData);
+	}
+
+	// Request lies within an extent already read - crop it (or share it outright when identical)
+	if (findEntry(passKey, passBounds, true, &cachedEntry)) {
+		GraniteCounters::ScopedTimer cropTimer(passCounters, GraniteCounters::TimeArrayCopy);
+		passCounters->increment(GraniteCounters::ExtentCacheHits);
+		cacheSpan.addArg("hit", 1);
+
+		if (memcmp(cachedEntry.bounds, passBounds, sizeof(cachedEntry.bounds)) == 0) {
+			for (int arrayIdx = 0 ; arrayIdx < cachedEntry.arrays.size() ; arrayIdx++) {
+				retData->AddArray(cachedEntry.arrays[arrayIdx]);
+			}
+		}
+		else {
+			passCounters->allocate(GraniteCounters::MemoryArrays, sizeArrays(passBounds, retData));
+			for (int arrayIdx = 0 ; arrayIdx < cachedEntry.arrays.size() ; arrayIdx++) {
+				copyRegion(cachedEntry.arrays[arrayIdx], cachedEntry.bounds, retData->GetArray(arrayIdx), passBounds, passBounds);
+			}
+		}
+
+		return true;
+	}
+
+	passCounters->allocate(GraniteCounters::MemoryArrays, sizeArrays(passBounds, retData));
+
+	if (findEntry(passKey, passBounds, false, &cachedEntry)) {
+		// Crop slices already read, then fetch only the missing slabs below and above them
+		passCounters->increment(GraniteCounters::ExtentCachePartialHits);
+		cacheSpan.addArg("hit", 0);
+
+		memcpy(region, passBounds, sizeof(region));
+		region[4] = std::max(passBounds[4], cachedEntry.bounds[4]);
+		region[5] = std::min(passBounds[5], cachedEntry.bounds[5]);
+
+		{
+			GraniteCounters::ScopedTimer cropTimer(passCounters, GraniteCounters::TimeArrayCopy);
+			for (int arrayIdx = 0 ; arrayIdx < cachedEntry.arrays.size() ; arrayIdx++) {
+				copyRegion(cachedEntry.arrays[arrayIdx], cachedEntry.bounds, retData->GetArray(arrayIdx), passBounds, region);
+			}
+		}
+
+		for (int slabIdx = 0 ; slabIdx < 2 ; slabIdx++) {
+			memcpy(slabBounds, passBounds, sizeof(slabBounds));
+			if (slabIdx == 0) slabBounds[5] = region[4] - 1;
+			else slabBounds[4] = region[5] + 1;
+			if (slabBounds[4] > slabBounds[5]) continue;
+
+			scratchData = vtkSmartPointer< vtkPointData >::New();
+			createScratch(retData, scratchData);
+			GraniteCounters::ScopedMemory scratchMemory(passCounters, GraniteCounters::MemoryScratch, sizeArrays(slabBounds, scratchData));
+
+			// Fetch may consume its bounds, so it gets a copy
+			memcpy(fetchBounds, slabBounds, sizeof(fetchBounds));
+			if (!passFetch(fetchBounds, scratchData)) return false;
+
+			for (int arrayIdx = 0 ; arrayIdx < scratchData->GetNumberOfArrays() ; arrayIdx++) {
+				copyRegion(scratchData->GetArray(arrayIdx), slabBounds, retData->GetArray(arrayIdx), passBounds, slabBounds);
+			}
+		}
+	}
+	else {
+		memcpy(fetchBounds, passBounds, sizeof(fetchBounds));
+		if (!passFetch(fetchBounds, retData)) return false;
+	}
+
+	addEntry(passKey, passBounds, retData);
+
+	return true;
+}
+
+void GraniteExtentCache::clear() {
+	std::lock_guard< std::mutex > guard(_lock);
+
+	_entries.clear();
+	_bytes = 0;
+}
+
+GraniteExtentCache::GraniteExtentCache() {
+	_bytes = 0;
+}
+
+bool GraniteExtentCache::findEntry(std::string passKey, int * passBounds, bool passContained, Entry * retEntry) {
+	std::list< Entry >::iterator entryIt;
+	bool found;
+
+	std::lock_guard< std::mutex > guard(_lock);
+
+	for (entryIt = _entries.begin() ; entryIt != _entries.end() ; entryIt++) {
+		if (entryIt->key != passKey) continue;
+
+		// x and y must always be covered, z either covered or overlapping
+		found = true;
+		for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+			if (dimIdx < 2 || passContained) {
+				if (passBounds[2 * dimIdx] < entryIt->bounds[2 * dimIdx] || passBounds[2 * dimIdx + 1] > entryIt->bounds[2 * dimIdx + 1]) found = false;
+			}
+			else {
+				if (passBounds[2 * dimIdx] > entryIt->bounds[2 * dimIdx + 1] || passBounds[2 * dimIdx + 1] < entryIt->bounds[2 * dimIdx]) found = false;
+			}
+		}
+
+		if (found) {
+			// Most recently used moves to front (copy holds array references should it be evicted)
+			_entries.splice(_entries.begin(), _entries, entryIt);
+			*retEntry = _entries.front();
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void GraniteExtentCache::addEntry(std::string passKey, int * passBounds, vtkPointData * passData) {
+	std::list< Entry >::iterator entryIt;
+	Entry newEntry;
+	long long limit;
+	bool contained;
+
+	newEntry.key = passKey;
+	memcpy(newEntry.bounds, passBounds, sizeof(newEntry.bounds));
+	newEntry.bytes = 0;
+
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetNumberOfArrays() ; arrayIdx++) {
+		newEntry.arrays.push_back(passData->GetArray(arrayIdx));
+		newEntry.bytes += getPointCount(passBounds) * passData->GetArray(arrayIdx)->GetNumberOfComponents() * passData->GetArray(arrayIdx)->GetDataTypeSize();
+	}
+
+	limit = (long long) vtkGraniteSettings::GetInstance()->getExtentCacheSize() * 1024 * 1024;
+	if (newEntry.bytes > limit) return;
+
+	std::lock_guard< std::mutex > guard(_lock);
+
+	// Extents of the same key inside the new one are redundant
+	for (entryIt = _entries.begin() ; entryIt != _entries.end() ; ) {
+		contained = (entryIt->key == passKey);
+		for (int dimIdx = 0 ; contained && dimIdx < 3 ; dimIdx++) {
+			if (entryIt->bounds[2 * dimIdx] < passBounds[2 * dimIdx] || entryIt->bounds[2 * dimIdx + 1] > passBounds[2 * dimIdx + 1]) contained = false;
+		}
+
+		if (contained) {
+			_bytes -= entryIt->bytes;
+			entryIt = _entries.erase(entryIt);
+		}
+		else {
+			entryIt++;
+		}
+	}
+
+	_entries.push_front(newEntry);
+	_bytes += newEntry.bytes;
+
+	// Evict least recently used
+	while (_bytes > limit && !_entries.empty()) {
+		_bytes -= _entries.back().bytes;
+		_entries.pop_back();
+	}
+}
+
+long long GraniteExtentCache::sizeArrays(int * passBounds, vtkPointData * retData) {
+	long long retBytes;
+
+	retBytes = 0;
+	for (int arrayIdx = 0 ; arrayIdx < retData->GetNumberOfArrays() ; arrayIdx++) {
+		retData->GetArray(arrayIdx)->SetNumberOfTuples(getPointCount(passBounds));
+		retBytes += getPointCount(passBounds) * retData->GetArray(arrayIdx)->GetNumberOfComponents() * retData->GetArray(arrayIdx)->GetDataTypeSize();
+	}
+
+	return retBytes;
+}
+
+void GraniteExtentCache::createScratch(vtkPointData * passData, vtkPointData * retData) {
+	vtkDataArray * tempArray;
+
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetNumberOfArrays() ; arrayIdx++) {
+		tempArray = passData->GetArray(arrayIdx)->NewInstance();
+		tempArray->SetName(passData->GetArray(arrayIdx)->GetName());
+		tempArray->SetNumberOfComponents(passData->GetArray(arrayIdx)->GetNumberOfComponents());
+		retData->AddArray(tempArray);
+		tempArray->Delete();
+	}
+}
+
+void GraniteExtentCache::copyRegion(vtkDataArray * passSource, int * passSourceBounds, vtkDataArray * retTarget, int * passTargetBounds, int * passRegion) {
+	char * sourceData, * targetData;
+	long long tupleBytes, rowBytes, rowCount;
+	int regionRows;
+
+	sourceData = (char *) passSource->GetVoidPointer(0);
+	targetData = (char *) retTarget->GetVoidPointer(0);
+	tupleBytes = passSource->GetNumberOfComponents() * passSource->GetDataTypeSize();
+	rowBytes = (passRegion[1] - passRegion[0] + 1) * tupleBytes;
+	regionRows = passRegion[3] - passRegion[2] + 1;
+	rowCount = (long long) regionRows * (passRegion[5] - passRegion[4] + 1);
+
+	// Rows (x fastest) are contiguous in both source and target
+	vtkSMPTools::For(0, rowCount, [&](vtkIdType passBegin, vtkIdType passEnd) {
+		long long sourceIdx, targetIdx;
+		int yIdx, zIdx;
+
+		for (vtkIdType rowIdx = passBegin ; rowIdx < passEnd ; rowIdx++) {
+			yIdx = passRegion[2] + rowIdx % regionRows;
+			zIdx = passRegion[4] + rowIdx / regionRows;
+
+			sourceIdx = ((long long) (zIdx - passSourceBounds[4]) * (passSourceBounds[3] - passSourceBounds[2] + 1) + (yIdx - passSourceBounds[2])) * (passSourceBounds[1] - passSourceBounds[0] + 1) + (passRegion[0] - passSourceBounds[0]);
+			targetIdx = ((long long) (zIdx - passTargetBounds[4]) * (passTargetBounds[3] - passTargetBounds[2] + 1) + (yIdx - passTargetBounds[2])) * (passTargetBounds[1] - passTargetBounds[0] + 1) + (passRegion[0] - passTargetBounds[0]);
+
+			memcpy(targetData + targetIdx * tupleBytes, sourceData + sourceIdx * tupleBytes, rowBytes);
+		}
+	});
+}
+
+long long GraniteExtentCache::getPointCount(int * passBounds) {
+	long long pointCount;
+
+	pointCount = 1;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		pointCount *= passBounds[2 * dimIdx + 1] - passBounds[2 * dimIdx] + 1;
+	}
+
+	return pointCount;
+}
@@ -0,0 +1,60 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteExtentCache.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteExtentCache_h
+#define __GraniteExtentCache_h
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vtkDataArray.h"
+#include "vtkPointData.h"
+#include "vtkSmartPointer.h"
+#include "GraniteCounters.h"
+
+class GraniteExtentCache {
+	public:
+		// Reads bounds (in {xLow, xHigh, ...}) from the data source into attributes sized for them, false if cancelled part way
+		typedef std::function< bool(int *, vtkDataSetAttributes *) > FetchDef;
+
+		static GraniteExtentCache * getInstance();
+
+		// Fill arrays (created but unsized) for bounds, from cached extents of the same key where possible (false if a fetch was cancelled, leaving arrays incomplete and uncached)
+		bool read(std::string passKey, int * passBounds, vtkPointData * retData, FetchDef passFetch, GraniteCounters * passCounters);
+		void clear();
+
+	private:
+		// Recently read extent of one file, level and array set
+		struct Entry {
+			std::string key;
+			int bounds[6];
+			std::vector< vtkSmartPointer< vtkDataArray > > arrays; // Shared with outputs, never modified once cached
+			long long bytes;
+		};
+
+		GraniteExtentCache();
+
+		bool findEntry(std::string passKey, int * passBounds, bool passContained, Entry * retEntry); // Most recent entry containing (or sharing x/y and overlapping in z) bounds
+		void addEntry(std::string passKey, int * passBounds, vtkPointData * passData); // Cache arrays read for bounds, evicting least recent past the size limit
+		long long sizeArrays(int * passBounds, vtkPointData * retData); // Returns bytes allocated
+		void createScratch(vtkPointData * passData, vtkPointData * retData); // Arrays of the same names and components, unsized
+		static void copyRegion(vtkDataArray * passSource, int * passSourceBounds, vtkDataArray * retTarget, int * passTargetBounds, int * passRegion); // Parallel crop of region rows
+		static long long getPointCount(int * passBounds);
+
+		std::mutex _lock; // Readers may run on several threads
+		std::list< Entry > _entries; // Most recent first
+		long long _bytes; // Total size of cached arrays
+};
+
+#endif // __GraniteExtentCache_h
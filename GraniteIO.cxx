@@ -0,0 +1,149 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteIO.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <fcntl.h>
+
+// Windows makes use of io.h for POSIX API
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "GraniteIO.h"
+#include "GraniteTrace.h"
+
+GraniteIO * GraniteIO::getInstance() {
+	static GraniteIO instance;
+
+	return &instance;
+}
+
+int GraniteIO::openFile(std::string passFileName) {
+	#ifdef _WIN32
+		return _open(passFileName.c_str(), _O_RDONLY | _O_BINARY);
+	#else
+		return open(passFileName.c_str(), O_RDONLY);
+	#endif
+}
+
+void GraniteIO::closeFile(int passHandle) {
+	if (passHandle < 0) return;
+
+	#ifdef _WIN32
+		_close(passHandle);
+	#else
+		close(passHandle);
+	#endif
+}
+
+void GraniteIO::submit(Request * passRequest, int passHandle, long long passOffset, size_t passLength, void * retBuffer) {
+	passRequest->handle = passHandle;
+	passRequest->offset = passOffset;
+	passRequest->length = passLength;
+	passRequest->buffer = (char *) retBuffer;
+	passRequest->complete = false;
+	passRequest->success = false;
+
+	// Always keep at least one worker
+	if (_workers.empty()) setWorkerCount(1);
+
+	std::lock_guard< std::mutex > guard(_queueLock);
+	_queue.push_back(passRequest);
+	_queueCondition.notify_one();
+}
+
+bool GraniteIO::wait(Request * passRequest) {
+	std::unique_lock< std::mutex > guard(_queueLock);
+
+	_completeCondition.wait(guard, [passRequest] { return passRequest->complete; });
+
+	return passRequest->success;
+}
+
+void GraniteIO::setWorkerCount(int passCount) {
+	std::lock_guard< std::mutex > guard(_queueLock);
+
+	// Workers are never retired while the plugin is loaded
+	while ((long long) _workers.size() < passCount) {
+		_workers.push_back(std::thread(&GraniteIO::runWorker, this));
+	}
+}
+
+GraniteIO::GraniteIO() {
+	_shutdown = false;
+}
+
+GraniteIO::~GraniteIO() {
+	{
+		std::lock_guard< std::mutex > guard(_queueLock);
+		_shutdown = true;
+		_queueCondition.notify_all();
+	}
+
+	for (size_t workerIdx = 0 ; workerIdx < _workers.size() ; workerIdx++) {
+		_workers[workerIdx].join();
+	}
+}
+
+void GraniteIO::runWorker() {
+	Request * currentRequest;
+	bool success;
+
+	while (true) {
+		// Next request (or shutdown)
+		{
+			std::unique_lock< std::mutex > guard(_queueLock);
+			_queueCondition.wait(guard, [this] { return _shutdown || !_queue.empty(); });
+			if (_shutdown) return;
+
+			currentRequest = _queue.front();
+			_queue.pop_front();
+		}
+
+		success = readRange(currentRequest);
+
+		// Publish completion
+		std::lock_guard< std::mutex > guard(_queueLock);
+		currentRequest->success = success;
+		currentRequest->complete = true;
+		_completeCondition.notify_all();
+	}
+}
+
+bool GraniteIO::readRange(Request * passRequest) {
+	long long readCount;
+	size_t totalCount;
+
+	GraniteTrace::Span readSpan("pread", "io");
+	readSpan.addArg("offset", passRequest->offset);
+	readSpan.addArg("bytes", passRequest->length);
+
+	#ifdef _WIN32
+		std::lock_guard< std::mutex > guard(_readLock);
+		if (_lseeki64(passRequest->handle, passRequest->offset, SEEK_SET) < 0) return false;
+	#endif
+
+	// Positioned reads may return short, so continue until range is filled
+	totalCount = 0;
+	while (totalCount < passRequest->length) {
+		#ifdef _WIN32
+			readCount = _read(passRequest->handle, passRequest->buffer + totalCount, passRequest->length - totalCount);
+		#else
+			readCount = pread(passRequest->handle, passRequest->buffer + totalCount, passRequest->length - totalCount, passRequest->offset + totalCount);
+		#endif
+
+		if (readCount <= 0) return false;
+		totalCount += readCount;
+	}
+
+	return true;
+}
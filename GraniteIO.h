@@ -0,0 +1,61 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteIO.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteIO_h
+#define __GraniteIO_h
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class GraniteIO {
+	public:
+		// Positioned read of a byte range, serviced by the worker pool
+		struct Request {
+			int handle;
+			long long offset;
+			size_t length;
+			char * buffer;
+			bool complete;
+			bool success;
+		};
+
+		static GraniteIO * getInstance();
+
+		int openFile(std::string passFileName); // Read only handle, -1 on failure
+		void closeFile(int passHandle);
+		void submit(Request * passRequest, int passHandle, long long passOffset, size_t passLength, void * retBuffer); // Queue read without waiting
+		bool wait(Request * passRequest); // Block until read completes, return success
+		void setWorkerCount(int passCount); // Grow pool to at least this many workers
+
+	private:
+		GraniteIO();
+		~GraniteIO();
+
+		void runWorker(); // Service queued requests until shutdown
+		bool readRange(Request * passRequest); // Blocking positioned read
+
+		std::mutex _queueLock; // Guards queue, completion flags and shutdown
+		std::condition_variable _queueCondition; // Signals queued requests
+		std::condition_variable _completeCondition; // Signals completed requests
+		std::deque< Request * > _queue; // Requests waiting for a worker
+		std::vector< std::thread > _workers; // Worker pool
+		bool _shutdown;
+
+		#ifdef _WIN32
+			std::mutex _readLock; // No pread on Windows, so seek and read are serialized
+		#endif
+};
+
+#endif // __GraniteIO_h
@@ -9,8 +9,12 @@
  
  =========================================================================*/
 
+#include <algorithm>
+
 #include "vtkDataArray.h"
 #include "GraniteInterop.h"
+#include "GraniteTrace.h"
+#include "GraniteWorkerPool.h"
 
 // Windows makes use of io.h for POSIX API
 #ifdef _WIN32
@@ -20,112 +24,220 @@
 #endif
 
 GraniteInterop::GraniteInterop() {
-	// Per JNI restrictions, the JVM must only be initialized once
-	if (_wrapper == NULL) {
-		_wrapper = new GraniteWrapper;
-	}
-
 	_jDataSource = NULL;
+	_pooled = false;
 
 	clearValues();
 }
 
 GraniteInterop::~GraniteInterop() {
-	// Free data source from JNI
-	if (_jDataSource) {
-		_wrapper->javaEnv->DeleteGlobalRef(_jDataSource);
+	// Free data source from JNI (pooled sources never create a JVM)
+	if (_jDataSource && _wrapper) {
+		_wrapper->env()->DeleteGlobalRef(_jDataSource);
 	}
 }
 
 bool GraniteInterop::openDataSource(const char * passFileName, bool passActivate) {
+	GraniteWorkerPool::Metadata poolMetadata;
 	jstring jDSName, jFileName;
 	jclass currentClass;
 	jmethodID currentMethod;
 
+	GraniteCounters::ScopedTimer openTimer(&_counters, GraniteCounters::TimeOpen);
+	GraniteTrace::Span openSpan("openDataSource", "read", passFileName);
+
+	// Data sources opened while worker processes are configured are served by them, with no JVM in this process
+	_pooled = GraniteWorkerPool::getInstance()->isEnabled();
+	_fileName = passFileName;
+	_poolError.clear();
+
+	if (_pooled) {
+		// A source reopened through workers drops the one it held in this process's JVM
+		if (_jDataSource && _wrapper) _wrapper->env()->DeleteGlobalRef(_jDataSource);
+		_jDataSource = NULL;
+
+		clearValues();
+		if (GraniteWorkerPool::getInstance()->openDataSource(_fileName, &poolMetadata, &_poolError) == false) return false;
+		_counters.increment(GraniteCounters::WorkerRequests);
+
+		_multiresolution = poolMetadata.multiresolution;
+		_dimensionsCache = poolMetadata.dimensions;
+		_boundsCache = poolMetadata.bounds;
+		_attributeNames = poolMetadata.attributeNames;
+		if (_boundsCache.empty()) return false;
+
+		// Granite is left on the last level visited
+		_currentLevel = _boundsCache.size() - 1;
+
+		return true;
+	}
+
+	// Per JNI restrictions, the JVM must only be initialized once
+	{
+		std::lock_guard< std::mutex > guard(_wrapperLock);
+		if (_wrapper == NULL) _wrapper = new GraniteWrapper;
+	}
+
 	// Ensure JVM is initialized
 	if (_wrapper->javaEnv == NULL) return false;
 
 	// Clear existing exceptions
-	_wrapper->javaEnv->ExceptionClear();
+	_wrapper->env()->ExceptionClear();
 	
 	// Convert filename
-	jDSName = _wrapper->javaEnv->NewStringUTF("ParaViewSource");
-	jFileName = _wrapper->javaEnv->NewStringUTF(passFileName);
+	jDSName = _wrapper->env()->NewStringUTF("ParaViewSource");
+	jFileName = _wrapper->env()->NewStringUTF(passFileName);
 
 	// Connect to datasource	
 	currentClass = _wrapper->graniteClasses[GraniteWrapper::ClassDef::DataSource];
 	currentMethod = _wrapper->graniteMethods[GraniteWrapper::MethodDef::StaticDataSourceCreate];
-	_jDataSource = _wrapper->javaEnv->NewGlobalRef(_wrapper->javaEnv->CallStaticObjectMethod(currentClass, currentMethod, jDSName, jFileName));
-	if (_wrapper->javaEnv->ExceptionCheck()) return false;
+	_jDataSource = _wrapper->env()->NewGlobalRef(_wrapper->env()->CallStaticObjectMethod(currentClass, currentMethod, jDSName, jFileName));
+	_counters.increment(GraniteCounters::JNICreate);
+	if (_wrapper->env()->ExceptionCheck()) return false;
 
 	// Activate
 	if (passActivate) {
 		currentMethod = _wrapper->graniteMethods[GraniteWrapper::MethodDef::DataSourceActivate];
-		_wrapper->javaEnv->CallVoidMethod(_jDataSource, currentMethod);
-		if (_wrapper->javaEnv->ExceptionCheck()) return false;
+		_wrapper->env()->CallVoidMethod(_jDataSource, currentMethod);
+		_counters.increment(GraniteCounters::JNIActivate);
+		if (_wrapper->env()->ExceptionCheck()) return false;
 
 		// Cache commonly used data source values
 		if (cacheValues() == false) return false;	
 	}
 
+	sampleJVMMemory();
+
 	return true;
 }
 
-void GraniteInterop::copyFloatData(int * passBounds, vtkDataSetAttributes * retData) {
+bool GraniteInterop::copyFloatData(int * passBounds, vtkDataSetAttributes * retData, std::function< bool(double) > passProgress) {
+	int sliceStart, sliceEnd, attributeCount, fieldCount;
+	int currentArray, currentComponent, currentData;
+	std::chrono::steady_clock::time_point phaseStart;
+
+	if (retData->GetNumberOfArrays() == 0) return true;
+
+	// Worker processes write straight into shared memory the arrays then adopt
+	if (_pooled) return GraniteWorkerPool::getInstance()->copyFloatData(_fileName, getLevel(), passBounds, getAttributeCount(), _fields, retData, &_counters, passProgress, &_poolError);
+
+	// Initialize values
+	sliceStart = passBounds[4];
+	sliceEnd = passBounds[5];
+	currentArray = 0;
+	currentComponent = 0;
+	currentData = 0;
+
+	// Granite returns every attribute of each point, of which only the selected are copied
+	attributeCount = std::max(1, (int) _attributeNames.size());
+	fieldCount = (_fields.empty() ? attributeCount : _fields.size());
+
+	return readFloatData(passBounds, [&](int passSlice, const float * passValues, int passCount) {
+		phaseStart = std::chrono::steady_clock::now();
+
+		// Copy floats to native array with array/component accounting
+		for (int recordIdx = 0 ; recordIdx + attributeCount <= passCount ; recordIdx += attributeCount) {
+			for (int fieldIdx = 0 ; fieldIdx < fieldCount ; fieldIdx++) {
+				retData->GetArray(currentArray)->SetComponent(currentData, currentComponent++, passValues[recordIdx + (_fields.empty() ? fieldIdx : _fields[fieldIdx])]);
+
+				// Reset component/array counting
+				if (currentComponent >= retData->GetArray(currentArray)->GetNumberOfComponents()) {
+					currentComponent = 0;
+					currentArray++;
+				}
+				if (currentArray >= retData->GetNumberOfArrays()) {
+					currentArray = 0;
+					currentData++;
+				}
+			}
+		}
+
+		_counters.addTime(GraniteCounters::TimeArrayCopy, std::chrono::steady_clock::now() - phaseStart);
+
+		// Cancelled reads stop at the slice boundary, releasing this slice's references before they do
+		if (passProgress && !passProgress((passSlice - sliceStart + 1.0) / (sliceEnd - sliceStart + 1))) {
+			_counters.increment(GraniteCounters::ReadsCancelled);
+			return false;
+		}
+
+		return true;
+	});
+}
+
+bool GraniteInterop::readFloatData(int * passBounds, std::function< bool(int, const float *, int) > passConsumer) {
 	jobject jDataBounds, jBlock;
 	jintArray jBoundsLow, jBoundsHigh;
 	jfloatArray jGraniteData;
 	jfloat * jGraniteDataPtr;
 	int sliceStart, sliceEnd, dataSize;
-	int currentArray, currentComponent, currentData;
+	bool success;
+	std::chrono::steady_clock::time_point phaseStart;
+
+	// Only sources open in this process's JVM are read here (pooled ones through their workers)
+	if (_pooled || _wrapper == NULL || _jDataSource == NULL) return false;
 
 	// Initialize values
-	jBoundsLow = _wrapper->javaEnv->NewIntArray(3);
-	jBoundsHigh = _wrapper->javaEnv->NewIntArray(3);
+	jBoundsLow = _wrapper->env()->NewIntArray(3);
+	jBoundsHigh = _wrapper->env()->NewIntArray(3);
 	sliceStart = passBounds[4];
 	sliceEnd = passBounds[5];
-	currentData = 0;
+	success = true;
 
 	// Iterate through each slice (allows for reading of large data set)
 	for (int sliceIdx = sliceStart ; sliceIdx <= sliceEnd ; sliceIdx++) {
+		GraniteTrace::Span sliceSpan("copyFloatData", "read");
+		sliceSpan.addArg("slice", sliceIdx);
+
 		// Create ISBounds for current slice of requested bounds
 		passBounds[4] = sliceIdx;
 		passBounds[5] = sliceIdx;
 		convertBoundArrays(passBounds, &jBoundsLow, &jBoundsHigh);
-		jDataBounds = _wrapper->javaEnv->NewObject(_wrapper->graniteClasses[GraniteWrapper::ClassDef::ISBounds], _wrapper->graniteMethods[GraniteWrapper::MethodDef::ISBoundsISBounds], jBoundsLow, jBoundsHigh);
+		jDataBounds = _wrapper->env()->NewObject(_wrapper->graniteClasses[GraniteWrapper::ClassDef::ISBounds], _wrapper->graniteMethods[GraniteWrapper::MethodDef::ISBoundsISBounds], jBoundsLow, jBoundsHigh);
+		_counters.increment(GraniteCounters::JNIBoundsCreate);
 
 		// Obtain block for target ISBounds
-		jBlock = _wrapper->javaEnv->CallObjectMethod(_jDataSource, _wrapper->graniteMethods[GraniteWrapper::MethodDef::DataSourceSubblock], jDataBounds);
+		phaseStart = std::chrono::steady_clock::now();
+		jBlock = _wrapper->env()->CallObjectMethod(_jDataSource, _wrapper->graniteMethods[GraniteWrapper::MethodDef::DataSourceSubblock], jDataBounds);
+		_counters.addTime(GraniteCounters::TimeSubblock, std::chrono::steady_clock::now() - phaseStart);
+		_counters.increment(GraniteCounters::JNISubblock);
 
 		// Obtain float array from block
-		jGraniteData = (jfloatArray) _wrapper->javaEnv->CallObjectMethod(jBlock, _wrapper->graniteMethods[GraniteWrapper::MethodDef::DataCollectionGetFloats]);
-		jGraniteDataPtr = _wrapper->javaEnv->GetFloatArrayElements(jGraniteData, NULL);
-		if (_wrapper->javaEnv->ExceptionCheck()) return;
-		dataSize = _wrapper->javaEnv->GetArrayLength(jGraniteData);
-		currentArray = 0;
-		currentComponent = 0;
-
-		// Copy floats to native array with array/component accounting
-		for (int dataIdx = 0 ; dataIdx < dataSize ; dataIdx++) {
-			retData->GetArray(currentArray)->SetComponent(currentData, currentComponent++, jGraniteDataPtr[dataIdx]);
-		
-			// Reset component/array counting
-			if (currentComponent >= retData->GetArray(currentArray)->GetNumberOfComponents()) {
-				currentComponent = 0;
-				currentArray++;
-			}
-			if (currentArray >= retData->GetNumberOfArrays()) {
-				currentArray = 0;
-				currentData++;
-			}
+		phaseStart = std::chrono::steady_clock::now();
+		jGraniteData = (jfloatArray) _wrapper->env()->CallObjectMethod(jBlock, _wrapper->graniteMethods[GraniteWrapper::MethodDef::DataCollectionGetFloats]);
+		jGraniteDataPtr = _wrapper->env()->GetFloatArrayElements(jGraniteData, NULL);
+		_counters.addTime(GraniteCounters::TimeGetFloats, std::chrono::steady_clock::now() - phaseStart);
+		_counters.increment(GraniteCounters::JNIGetFloats);
+		if (_wrapper->env()->ExceptionCheck()) {
+			if (jBlock) _wrapper->env()->DeleteLocalRef(jBlock);
+			_wrapper->env()->DeleteLocalRef(jDataBounds);
+			success = false;
+			break;
 		}
+		dataSize = _wrapper->env()->GetArrayLength(jGraniteData);
+		_counters.allocate(GraniteCounters::MemoryJNI, dataSize * sizeof(jfloat));
+
+		success = passConsumer(sliceIdx, jGraniteDataPtr, dataSize);
+
+		_counters.increment(GraniteCounters::BytesTransferred, dataSize * sizeof(jfloat));
+		_counters.increment(GraniteCounters::SlicesFetched);
 
 		// Release memory from current iteration
-		_wrapper->javaEnv->ReleaseFloatArrayElements(jGraniteData, jGraniteDataPtr, 0);
-		_wrapper->javaEnv->DeleteLocalRef(jGraniteData);
-		_wrapper->javaEnv->DeleteLocalRef(jBlock);
-		_wrapper->javaEnv->DeleteLocalRef(jDataBounds);
+		_wrapper->env()->ReleaseFloatArrayElements(jGraniteData, jGraniteDataPtr, 0);
+		_counters.release(GraniteCounters::MemoryJNI, dataSize * sizeof(jfloat));
+		_wrapper->env()->DeleteLocalRef(jGraniteData);
+		_wrapper->env()->DeleteLocalRef(jBlock);
+		_wrapper->env()->DeleteLocalRef(jDataBounds);
+
+		if (success == false) break;
 	}
+
+	_wrapper->env()->DeleteLocalRef(jBoundsLow);
+	_wrapper->env()->DeleteLocalRef(jBoundsHigh);
+
+	// Slices are garbage once copied, so the heap has grown as far as this read takes it
+	sampleJVMMemory();
+
+	return success;
 }
 
 int GraniteInterop::getAttributeCount() {
@@ -141,6 +253,11 @@ int * GraniteInterop::getBounds() {
 	return &_boundsCache[_currentLevel][0];
 }
 
+int * GraniteInterop::getBounds(int passLevel) {
+	// Granite ordering is inverse to VTKs
+	return &_boundsCache[_boundsCache.size() - 1 - passLevel][0];
+}
+
 int GraniteInterop::getDimensions() {
 	return _dimensionsCache;
 }
@@ -161,58 +278,142 @@ int GraniteInterop::getLevel() {
 void GraniteInterop::setLevel(int passLevel) {
 	jmethodID jMethodResolution;
 
-	jMethodResolution = _wrapper->graniteMethods[GraniteWrapper::MethodDef::MRDataSourceChangeResolution];
-
 	// Ensure valid level
 	if (passLevel >= _boundsCache.size()) return;
 
-	// Granite ordering is inverse to VTKs
+	// Granite ordering is inverse to VTKs - skip Granite entirely if already selected
+	if (_currentLevel == _boundsCache.size() -  1 - passLevel) {
+		_counters.increment(GraniteCounters::LevelCacheHits);
+		return;
+	}
+
 	_currentLevel = _boundsCache.size() -  1 - passLevel;
 
+	// Container levels are read by the plugin, Granite only knows the root level (and workers switch levels per read)
+	if (_containerLevels || _pooled) return;
+
 	// Set level in Granite
-	_wrapper->javaEnv->CallBooleanMethod(_jDataSource, jMethodResolution, 0);
-	_wrapper->javaEnv->CallBooleanMethod(_jDataSource, jMethodResolution, _currentLevel);
+	if (_wrapper == NULL || _jDataSource == NULL) return;
+	jMethodResolution = _wrapper->graniteMethods[GraniteWrapper::MethodDef::MRDataSourceChangeResolution];
+
+	GraniteCounters::ScopedTimer levelTimer(&_counters, GraniteCounters::TimeLevelSwitch);
+	GraniteTrace::Span levelSpan("changeResolution", "read");
+	levelSpan.addArg("level", passLevel);
+	_wrapper->env()->CallBooleanMethod(_jDataSource, jMethodResolution, 0);
+	_wrapper->env()->CallBooleanMethod(_jDataSource, jMethodResolution, _currentLevel);
+	_counters.increment(GraniteCounters::JNIChangeResolution, 2);
+	_counters.increment(GraniteCounters::LevelSwitches);
+}
+
+void GraniteInterop::setLevels(std::vector< std::vector< int > > passBounds) {
+	if (passBounds.empty()) return;
+
+	_boundsCache = passBounds;
+	_multiresolution = (_boundsCache.size() > 1);
+	_containerLevels = true;
+
+	// Start on the coarsest level, as Granite would be left after calculating bounds
+	_currentLevel = _boundsCache.size() - 1;
+}
+
+void GraniteInterop::setFields(std::vector< int > passFields) {
+	_fields = passFields;
 }
 
 const char * GraniteInterop::getExceptionMessage() {
 	jmethodID methodToString;
 	jstring jExceptionString;
 
+	if (_pooled) return _poolError.c_str();
+	if (_wrapper == NULL) return "";
+
 	// If Java exception exists, get associated message
-	if (_wrapper->javaEnv->ExceptionCheck()) {
-		methodToString = _wrapper->javaEnv->GetMethodID(_wrapper->javaEnv->FindClass("java/lang/Object"), "toString", "()Ljava/lang/String;");
-		jExceptionString = (jstring) _wrapper->javaEnv->CallObjectMethod(_wrapper->javaEnv->ExceptionOccurred(), methodToString);
+	if (_wrapper->env()->ExceptionCheck()) {
+		methodToString = _wrapper->env()->GetMethodID(_wrapper->env()->FindClass("java/lang/Object"), "toString", "()Ljava/lang/String;");
+		jExceptionString = (jstring) _wrapper->env()->CallObjectMethod(_wrapper->env()->ExceptionOccurred(), methodToString);
 
-		return _wrapper->javaEnv->GetStringUTFChars(jExceptionString, NULL);
+		return _wrapper->env()->GetStringUTFChars(jExceptionString, NULL);
 	}
 
 	return "";
 }
 
+bool GraniteInterop::getJVMMemory(long long * retTotal, long long * retFree, long long * retMax) {
+	jobject jRuntime;
+
+	// Pending exceptions (e.g. of a failed read) are left for the caller to report
+	// Worker processes keep their heaps to themselves
+	if (_pooled || _wrapper == NULL) return false;
+	if (_wrapper->javaEnv == NULL || _wrapper->env() == NULL || _wrapper->env()->ExceptionCheck()) return false;
+
+	jRuntime = _wrapper->env()->CallStaticObjectMethod(_wrapper->graniteClasses[GraniteWrapper::ClassDef::Runtime], _wrapper->graniteMethods[GraniteWrapper::MethodDef::StaticRuntimeGetRuntime]);
+	*retTotal = _wrapper->env()->CallLongMethod(jRuntime, _wrapper->graniteMethods[GraniteWrapper::MethodDef::RuntimeTotalMemory]);
+	*retFree = _wrapper->env()->CallLongMethod(jRuntime, _wrapper->graniteMethods[GraniteWrapper::MethodDef::RuntimeFreeMemory]);
+	*retMax = _wrapper->env()->CallLongMethod(jRuntime, _wrapper->graniteMethods[GraniteWrapper::MethodDef::RuntimeMaxMemory]);
+	_wrapper->env()->DeleteLocalRef(jRuntime);
+	_counters.increment(GraniteCounters::JNIMetadata, 4);
+
+	return true;
+}
+
+std::string GraniteInterop::getJVMReport(const char * passIndent) {
+	long long heapTotal, heapFree, heapMax;
+	std::string retReport;
+
+	if (getJVMMemory(&heapTotal, &heapFree, &heapMax) == false) return retReport;
+
+	retReport += std::string(passIndent) + "JVM Heap Total: " + std::to_string(heapTotal) + "\n";
+	retReport += std::string(passIndent) + "JVM Heap Free: " + std::to_string(heapFree) + "\n";
+	retReport += std::string(passIndent) + "JVM Heap Max: " + std::to_string(heapMax) + "\n";
+
+	return retReport;
+}
+
+unsigned long long GraniteInterop::getJNICallCount() {
+	return GraniteCounters::getProcessTotals()->getJNICallCount();
+}
+
+void GraniteInterop::detachThread() {
+	if (_wrapper) _wrapper->detachThread();
+}
+
+GraniteCounters * GraniteInterop::getCounters() {
+	return &_counters;
+}
+
 const char * GraniteInterop::getClassName(jobject passObject) {
 	jobject jClassObject;
 	jclass jObjectClass, jClassClass;
 	jmethodID jClassMethod, jNameMethod;
 	jstring jNameString;
 
+	if (_wrapper == NULL || passObject == NULL) return "";
+
 	// Obtain java class object for target object
-	jObjectClass = _wrapper->javaEnv->GetObjectClass(passObject);
-	jClassMethod = _wrapper->javaEnv->GetMethodID(jObjectClass, "getClass", "()Ljava/lang/Class;");
-	jClassObject = _wrapper->javaEnv->CallObjectMethod(passObject, jClassMethod);
+	jObjectClass = _wrapper->env()->GetObjectClass(passObject);
+	jClassMethod = _wrapper->env()->GetMethodID(jObjectClass, "getClass", "()Ljava/lang/Class;");
+	jClassObject = _wrapper->env()->CallObjectMethod(passObject, jClassMethod);
 
 	// Call getName on class
-	jClassClass = _wrapper->javaEnv->GetObjectClass(jClassObject);
-	jNameMethod = _wrapper->javaEnv->GetMethodID(jClassClass, "getName", "()Ljava/lang/String;");
-	jNameString = (jstring) _wrapper->javaEnv->CallObjectMethod(jClassObject, jNameMethod);
+	jClassClass = _wrapper->env()->GetObjectClass(jClassObject);
+	jNameMethod = _wrapper->env()->GetMethodID(jClassClass, "getName", "()Ljava/lang/String;");
+	jNameString = (jstring) _wrapper->env()->CallObjectMethod(jClassObject, jNameMethod);
 
 	// Return name
-	return _wrapper->javaEnv->GetStringUTFChars(jNameString, NULL);
+	return _wrapper->env()->GetStringUTFChars(jNameString, NULL);
 }
 
 
+void GraniteInterop::sampleJVMMemory() {
+	long long heapTotal, heapFree, heapMax;
+
+	if (getJVMMemory(&heapTotal, &heapFree, &heapMax)) _counters.sampleMemory(GraniteCounters::MemoryJVMHeap, heapTotal);
+}
+
 void GraniteInterop::clearValues() {
 	// Initial level info
 	_multiresolution = false;
+	_containerLevels = false;
 	_currentLevel = 0;
 
 	// Bounds info
@@ -224,6 +425,7 @@ void GraniteInterop::clearValues() {
 
 	// Attribute info
 	_attributeNames.clear();
+	_fields.clear();
 }
 
 bool GraniteInterop::cacheValues() {
@@ -238,28 +440,33 @@ bool GraniteInterop::cacheValues() {
 	jMethodDescriptor = _wrapper->graniteMethods[GraniteWrapper::MethodDef::DataCollectionGetRecordDescriptor];
 	jMethodName = _wrapper->graniteMethods[GraniteWrapper::MethodDef::RecordDescriptorName];
 
+	GraniteCounters::ScopedTimer metadataTimer(&_counters, GraniteCounters::TimeMetadata);
+
 	// Initialize values
 	clearValues();
-	if (_wrapper->javaEnv->ExceptionCheck()) return false;
+	if (_wrapper->env()->ExceptionCheck()) return false;
 	
 	// Cache if multiresolution
 	_multiresolution = (std::string(getClassName(_jDataSource)).compare("edu.unh.sdb.datasource.MRDataSource") == 0);
 
 	// Cache dimensionality and bounds
-	_dimensionsCache = _wrapper->javaEnv->CallIntMethod(_jDataSource, jMethodDim);
+	_dimensionsCache = _wrapper->env()->CallIntMethod(_jDataSource, jMethodDim);
+	_counters.increment(GraniteCounters::JNIMetadata);
 	if (calculateBounds() == false) return false;
 
 	// Cache attribute names
-	attributeCount = _wrapper->javaEnv->CallIntMethod(_jDataSource, jMethodAttributes);
-	jRecordDescriptor = _wrapper->javaEnv->CallObjectMethod(_jDataSource, jMethodDescriptor);
-	if (_wrapper->javaEnv->ExceptionCheck()) return false;
+	attributeCount = _wrapper->env()->CallIntMethod(_jDataSource, jMethodAttributes);
+	jRecordDescriptor = _wrapper->env()->CallObjectMethod(_jDataSource, jMethodDescriptor);
+	_counters.increment(GraniteCounters::JNIMetadata, 2);
+	if (_wrapper->env()->ExceptionCheck()) return false;
 	
 	for (int attrIdx = 0 ; attrIdx < attributeCount ; attrIdx++) {
-		jTempString = (jstring) _wrapper->javaEnv->CallObjectMethod(jRecordDescriptor, jMethodName, attrIdx);
-		_attributeNames.push_back(_wrapper->javaEnv->GetStringUTFChars(jTempString, NULL));
+		jTempString = (jstring) _wrapper->env()->CallObjectMethod(jRecordDescriptor, jMethodName, attrIdx);
+		_attributeNames.push_back(_wrapper->env()->GetStringUTFChars(jTempString, NULL));
+		_counters.increment(GraniteCounters::JNIMetadata);
 	}
 
-	if (_wrapper->javaEnv->ExceptionCheck()) return false;
+	if (_wrapper->env()->ExceptionCheck()) return false;
 
 	return true;
 }
@@ -273,18 +480,21 @@ bool GraniteInterop::calculateBounds() {
 	jMethodGetBounds = _wrapper->graniteMethods[GraniteWrapper::MethodDef::DataCollectionGetBounds];
 	jMethodCoarser = _wrapper->graniteMethods[GraniteWrapper::MethodDef::MRDataSourceCoarser];
 
+	GraniteTrace::Span boundsSpan("calculateBounds", "read");
+
 	// Iterate through all resolution levels
 	do {
 		// Get bounds for current level
-		jDataBounds = _wrapper->javaEnv->CallObjectMethod(_jDataSource, jMethodGetBounds);
+		jDataBounds = _wrapper->env()->CallObjectMethod(_jDataSource, jMethodGetBounds);
 
 		// Cache bounds for this level
 		for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
-			_boundsCache.back().at(2 * dimIdx) = _wrapper->javaEnv->CallIntMethod(jDataBounds, jMethodLower, 2 - dimIdx);
-			_boundsCache.back().at(2 * dimIdx + 1) = _wrapper->javaEnv->CallIntMethod(jDataBounds, jMethodUpper, 2 - dimIdx);
+			_boundsCache.back().at(2 * dimIdx) = _wrapper->env()->CallIntMethod(jDataBounds, jMethodLower, 2 - dimIdx);
+			_boundsCache.back().at(2 * dimIdx + 1) = _wrapper->env()->CallIntMethod(jDataBounds, jMethodUpper, 2 - dimIdx);
 		}
+		_counters.increment(GraniteCounters::JNIMetadata, 7);
 
-		if (_wrapper->javaEnv->ExceptionCheck()) return false;
+		if (_wrapper->env()->ExceptionCheck()) return false;
 
 		// Prepare next level
 		_boundsCache.push_back(std::vector< int >());
@@ -294,10 +504,13 @@ bool GraniteInterop::calculateBounds() {
 		if (_multiresolution == false) break;
 
 	// Move to next level
-	} while (_wrapper->javaEnv->CallBooleanMethod(_jDataSource, jMethodCoarser));
+	} while (_wrapper->env()->CallBooleanMethod(_jDataSource, jMethodCoarser));
 
 	_boundsCache.pop_back();
 
+	// Granite is left on the last level visited
+	_currentLevel = _boundsCache.size() - 1;
+
 	return true;
 }
 
@@ -311,8 +524,9 @@ void GraniteInterop::convertBoundArrays(int * passBounds, jintArray * retLow, ji
 	}
 
 	// Convert jint native arrays to jintArrays
-	_wrapper->javaEnv->SetIntArrayRegion(*retLow, 0, 3, jLow);
-	_wrapper->javaEnv->SetIntArrayRegion(*retHigh, 0, 3, jHigh);
+	_wrapper->env()->SetIntArrayRegion(*retLow, 0, 3, jLow);
+	_wrapper->env()->SetIntArrayRegion(*retHigh, 0, 3, jHigh);
 }
 
-GraniteWrapper * GraniteInterop::_wrapper; 
\ No newline at end of file
+GraniteWrapper * GraniteInterop::_wrapper;
+std::mutex GraniteInterop::_wrapperLock; 
\ No newline at end of file
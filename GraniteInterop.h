@@ -12,11 +12,14 @@
 #ifndef __GraniteInterop_h
 #define __GraniteInterop_h
 
+#include <functional>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <jni.h>
 
 #include "vtkDataSetAttributes.h"
+#include "GraniteCounters.h"
 #include "GraniteWrapper.h"
 
 class GraniteInterop {
@@ -27,19 +30,30 @@ class GraniteInterop {
 		bool openDataSource(const char * passFileName, bool passActivate); // Open data source, return success
 
 		// Methods acting on current data source
-		void copyFloatData(int * passBounds, vtkDataSetAttributes * retData); // Copy float array from Granite to VTK for bounds specified
+		bool copyFloatData(int * passBounds, vtkDataSetAttributes * retData, std::function< bool(double) > passProgress = nullptr); // Copy float array from Granite to VTK for bounds specified (progress called per slice with fraction done, false cancels)
+		bool readFloatData(int * passBounds, std::function< bool(int, const float *, int) > passConsumer); // Hand each slice of bounds (every attribute per point) to consumer with slice, values and value count, false from it stops (in-process JVM only)
 		int getAttributeCount(); // Number of attributes
 		const char * getAttributeName(int passIdx); // Name of attribute
 		int * getBounds(); // Bounding array across 3 dimensions (xLow, xHigh, yLow...)
+		int * getBounds(int passLevel); // Bounding array of a level (VTK ordering), without switching to it
 		int getDimensions(); // Dimensionality of bounds
 		
 		bool isMultiresolution(); // Is data source multiresolution
 		int getLevelCount(); // Number of multiresolution levels
 		int getLevel(); // Get current level
 		void setLevel(int passLevel); // Set current level
+		void setLevels(std::vector< std::vector< int > > passBounds); // Levels of a multiresolution container (full resolution first), switched without Granite
+		void setFields(std::vector< int > passFields); // Attributes copied, in array component order (all if empty)
 
 		// JVM related
 		const char * getExceptionMessage();
+		bool getJVMMemory(long long * retTotal, long long * retFree, long long * retMax); // Heap committed, free within it, and its limit (false without a JVM)
+		std::string getJVMReport(const char * passIndent = ""); // One "name: value" line per heap figure
+		static unsigned long long getJNICallCount(); // Number of Java method invocations made by all data sources
+		static void detachThread(); // Call before a worker thread that used any data source exits
+
+		// Performance counters for this data source
+		GraniteCounters * getCounters();
 		const char * getClassName(jobject passObject); // Get the class name of a Java object
 
 	private:
@@ -47,6 +61,7 @@ class GraniteInterop {
 		bool cacheValues(); // Cache Granite Java values into native objects
 		bool calculateBounds(); // Calculate all resolution levels of bounds for cacheValues
 		void convertBoundArrays(int * passBounds, jintArray * retLow, jintArray * retHigh); // Convert {xLow, xHigh, ...} to existing jintArrays
+		void sampleJVMMemory(); // Record committed JVM heap against the counters
 		
 
 		// Granite data source Java handle
@@ -54,12 +69,19 @@ class GraniteInterop {
 
 		// Native data
 		static GraniteWrapper * _wrapper; // JNI doesn't allow JVM unloading, only initialize GraniteReaderWrapper once
+		static std::mutex _wrapperLock; // Data sources may be opened from several threads
+		bool _pooled; // Data source served by worker processes rather than the JVM
+		std::string _fileName; // XFDL filename of data source
+		std::string _poolError; // Last worker process error
 
 		bool _multiresolution; // Is data multiresolution
+		bool _containerLevels; // Levels come from a multiresolution container rather than Granite
 		int _currentLevel; // Current number of resolution levels
 		std::vector< std::vector< int > > _boundsCache; // Data bounds per level
 		int _dimensionsCache; // Dimensionality of data
 		std::vector< std::string > _attributeNames; // Component attribute names
+		std::vector< int > _fields; // Attributes copied, in array component order (empty for all)
+		GraniteCounters _counters; // Hot path counters and phase timers
 };
 
 #endif // __GraniteInterop_h
\ No newline at end of file
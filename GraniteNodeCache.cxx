@@ -0,0 +1,466 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteNodeCache.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "vtkDataArray.h"
+#include "vtkSMPTools.h"
+#include "vtkGraniteSettings.h"
+#include "GraniteNodeCache.h"
+#include "GraniteTrace.h"
+
+// The node cache uses POSIX shared memory and file locks (unavailable on Windows)
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <signal.h>
+	#include <unistd.h>
+	#include <sys/file.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+GraniteNodeCache * GraniteNodeCache::getInstance() {
+	static GraniteNodeCache instance;
+
+	return &instance;
+}
+
+bool GraniteNodeCache::read(std::string passKey, int * passBounds, vtkDataSetAttributes * retData, GraniteExtentCache::FetchDef passFetch, GraniteCounters * passCounters) {
+	int fetchBounds[6];
+
+	// Fetch may consume its bounds, so it gets a copy
+	memcpy(fetchBounds, passBounds, sizeof(fetchBounds));
+
+#ifdef _WIN32
+	return passFetch(fetchBounds, retData);
+#else
+	std::list< Entry > evictedEntries;
+	std::string fullKey, segmentName, entryName;
+	Index * sharedIndex;
+	Record * currentRecord;
+	Entry newEntry;
+	long long limit, entryBytes;
+	int indexHandle, foundIdx, freeIdx, entryBounds[6];
+	bool waiting, contained, success, stored;
+
+	limit = (long long) vtkGraniteSettings::GetInstance()->getNodeCacheSize() * 1024 * 1024;
+	entryBytes = getBytes(passBounds, retData);
+
+	// Caching disabled, or extent too large to share
+	if (limit <= 0 || entryBytes <= 0 || entryBytes > limit) return passFetch(fetchBounds, retData);
+
+	// Raw array bytes are shared, so the arrays' layout is part of the key
+	fullKey = passKey + "|" + getArraySignature(retData);
+
+	GraniteTrace::Span cacheSpan("nodeCache", "read", passKey.c_str());
+
+	{
+		std::lock_guard< std::mutex > guard(_lock);
+		segmentName = "/granite-node-" + std::to_string(getpid()) + "-" + std::to_string(_segmentCount++);
+	}
+
+	while (true) {
+		if ((indexHandle = openIndex(fullKey, true, &sharedIndex)) < 0) return passFetch(fetchBounds, retData);
+
+		foundIdx = -1;
+		freeIdx = -1;
+		waiting = false;
+
+		for (int recordIdx = 0 ; recordIdx < RecordCount ; recordIdx++) {
+			currentRecord = &sharedIndex->records[recordIdx];
+
+			// Extents left by processes that exited without evicting them are reclaimed
+			if (currentRecord->state != StateFree && !isOwnerAlive(currentRecord->owner)) {
+				shm_unlink(currentRecord->segmentName);
+				currentRecord->state = StateFree;
+			}
+
+			if (currentRecord->state == StateFree) {
+				if (freeIdx < 0) freeIdx = recordIdx;
+				continue;
+			}
+
+			contained = true;
+			for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+				if (passBounds[2 * dimIdx] < currentRecord->bounds[2 * dimIdx] || passBounds[2 * dimIdx + 1] > currentRecord->bounds[2 * dimIdx + 1]) contained = false;
+			}
+			if (!contained) continue;
+
+			if (currentRecord->state == StateReady) {
+				foundIdx = recordIdx;
+				break;
+			}
+
+			waiting = true;
+		}
+
+		// Crop a ready extent (one evicted since the index was read is freed, and the search repeated)
+		if (foundIdx >= 0) {
+			entryName = sharedIndex->records[foundIdx].segmentName;
+			memcpy(entryBounds, sharedIndex->records[foundIdx].bounds, sizeof(entryBounds));
+			closeIndex(indexHandle, sharedIndex);
+
+			if (copyEntry(entryName, entryBounds, passBounds, retData)) {
+				passCounters->increment(GraniteCounters::NodeCacheHits);
+				cacheSpan.addArg("hit", 1);
+
+				return true;
+			}
+
+			setState(fullKey, entryName, StateFree);
+			continue;
+		}
+
+		// Another process is reading an extent containing this one
+		if (waiting) {
+			closeIndex(indexHandle, sharedIndex);
+			usleep(10000);
+			continue;
+		}
+
+		// Claim a free record while filling it, so others wait rather than read the same extent (a full index reads without sharing)
+		if (freeIdx >= 0) {
+			currentRecord = &sharedIndex->records[freeIdx];
+			currentRecord->state = StateFilling;
+			currentRecord->owner = getpid();
+			memcpy(currentRecord->bounds, passBounds, sizeof(currentRecord->bounds));
+			currentRecord->bytes = entryBytes;
+			snprintf(currentRecord->segmentName, sizeof(currentRecord->segmentName), "%s", segmentName.c_str());
+		}
+
+		closeIndex(indexHandle, sharedIndex);
+		break;
+	}
+
+	cacheSpan.addArg("hit", 0);
+	if (freeIdx < 0) return passFetch(fetchBounds, retData);
+
+	// Cancelled or failed reads release the record for others to fill
+	success = passFetch(fetchBounds, retData);
+	stored = (success && addEntry(segmentName, passBounds, retData));
+
+	if (!setState(fullKey, segmentName, stored ? StateReady : StateFree) || !stored) {
+		shm_unlink(segmentName.c_str());
+
+		return success;
+	}
+
+	passCounters->increment(GraniteCounters::NodeCacheFills);
+
+	newEntry.key = fullKey;
+	newEntry.segmentName = segmentName;
+	newEntry.bytes = entryBytes;
+
+	{
+		std::lock_guard< std::mutex > guard(_lock);
+
+		_entries.push_back(newEntry);
+		_bytes += entryBytes;
+
+		// Evict this process's oldest extents past the size limit
+		while (_bytes > limit && !_entries.empty()) {
+			_bytes -= _entries.front().bytes;
+			evictedEntries.push_back(_entries.front());
+			_entries.pop_front();
+		}
+	}
+
+	for (std::list< Entry >::iterator entryIter = evictedEntries.begin() ; entryIter != evictedEntries.end() ; entryIter++) {
+		evict(*entryIter);
+	}
+
+	return true;
+#endif
+}
+
+void GraniteNodeCache::clear() {
+	std::list< Entry > evictedEntries;
+
+	{
+		std::lock_guard< std::mutex > guard(_lock);
+
+		evictedEntries.swap(_entries);
+		_bytes = 0;
+	}
+
+	for (std::list< Entry >::iterator entryIter = evictedEntries.begin() ; entryIter != evictedEntries.end() ; entryIter++) {
+		evict(*entryIter);
+	}
+}
+
+GraniteNodeCache::GraniteNodeCache() {
+	_bytes = 0;
+	_segmentCount = 0;
+}
+
+GraniteNodeCache::~GraniteNodeCache() {
+	clear();
+}
+
+int GraniteNodeCache::openIndex(std::string passKey, bool passCreate, Index * * retIndex) {
+#ifdef _WIN32
+	return -1;
+#else
+	struct stat indexStat, linkedStat;
+	int retHandle, linkedHandle;
+	bool linked;
+
+	if (passKey.size() > KeyCapacity) return -1;
+
+	while (true) {
+		if ((retHandle = shm_open(getIndexName(passKey).c_str(), O_RDWR | (passCreate ? O_CREAT : 0), 0600)) < 0) return -1;
+
+		// Records are only read or changed under the lock
+		if (flock(retHandle, LOCK_EX) != 0 || fstat(retHandle, &indexStat) != 0) {
+			close(retHandle);
+			return -1;
+		}
+
+		// An index emptied and unlinked while this process waited for its lock is stale, so the linked one is opened instead
+		linked = false;
+		if ((linkedHandle = shm_open(getIndexName(passKey).c_str(), O_RDWR, 0600)) >= 0) {
+			linked = (fstat(linkedHandle, &linkedStat) == 0 && linkedStat.st_dev == indexStat.st_dev && linkedStat.st_ino == indexStat.st_ino);
+			close(linkedHandle);
+		}
+
+		if (linked) break;
+
+		flock(retHandle, LOCK_UN);
+		close(retHandle);
+		if (!passCreate) return -1;
+	}
+
+	// A new index is sized zeroed, every record free
+	if (indexStat.st_size < (off_t) sizeof(Index) && ftruncate(retHandle, sizeof(Index)) != 0) {
+		flock(retHandle, LOCK_UN);
+		close(retHandle);
+		return -1;
+	}
+
+	*retIndex = (Index *) mmap(NULL, sizeof(Index), PROT_READ | PROT_WRITE, MAP_SHARED, retHandle, 0);
+	if (*retIndex == MAP_FAILED) {
+		close(retHandle);
+		return -1;
+	}
+
+	// Claim a new index for the key, and leave one held by a colliding key alone
+	if ((*retIndex)->keyLength == 0) {
+		memcpy((*retIndex)->key, passKey.data(), passKey.size());
+		(*retIndex)->keyLength = passKey.size();
+	}
+	else if ((*retIndex)->keyLength != passKey.size() || memcmp((*retIndex)->key, passKey.data(), passKey.size()) != 0) {
+		closeIndex(retHandle, *retIndex);
+		return -1;
+	}
+
+	return retHandle;
+#endif
+}
+
+void GraniteNodeCache::closeIndex(int passHandle, Index * passIndex) {
+#ifndef _WIN32
+	munmap(passIndex, sizeof(Index));
+	flock(passHandle, LOCK_UN);
+	close(passHandle);
+#endif
+}
+
+bool GraniteNodeCache::copyEntry(std::string passSegmentName, int * passEntryBounds, int * passBounds, vtkDataSetAttributes * retData) {
+#ifdef _WIN32
+	return false;
+#else
+	struct stat segmentStat;
+	char * segmentBytes;
+	long long segmentLength, arrayOffset, tupleBytes, entryPoints;
+	int segmentHandle;
+
+	if ((segmentHandle = shm_open(passSegmentName.c_str(), O_RDONLY, 0600)) < 0) return false;
+
+	segmentLength = getBytes(passEntryBounds, retData);
+	if (fstat(segmentHandle, &segmentStat) != 0 || segmentStat.st_size < segmentLength) {
+		close(segmentHandle);
+		return false;
+	}
+
+	segmentBytes = (char *) mmap(NULL, segmentLength, PROT_READ, MAP_SHARED, segmentHandle, 0);
+	close(segmentHandle);
+	if (segmentBytes == MAP_FAILED) return false;
+
+	entryPoints = (long long) (passEntryBounds[1] - passEntryBounds[0] + 1) * (passEntryBounds[3] - passEntryBounds[2] + 1) * (passEntryBounds[5] - passEntryBounds[4] + 1);
+	arrayOffset = 0;
+
+	// Arrays follow one another in the segment, each laid out as VTK stores it
+	for (int arrayIdx = 0 ; arrayIdx < retData->GetNumberOfArrays() ; arrayIdx++) {
+		tupleBytes = retData->GetArray(arrayIdx)->GetNumberOfComponents() * retData->GetArray(arrayIdx)->GetDataTypeSize();
+		copyRegion(segmentBytes + arrayOffset, passEntryBounds, (char *) retData->GetArray(arrayIdx)->GetVoidPointer(0), passBounds, tupleBytes);
+		arrayOffset += entryPoints * tupleBytes;
+	}
+
+	munmap(segmentBytes, segmentLength);
+
+	return true;
+#endif
+}
+
+bool GraniteNodeCache::addEntry(std::string passSegmentName, int * passBounds, vtkDataSetAttributes * passData) {
+#ifdef _WIN32
+	return false;
+#else
+	char * segmentBytes;
+	long long segmentLength, arrayOffset, arrayBytes, entryPoints;
+	int segmentHandle;
+
+	segmentLength = getBytes(passBounds, passData);
+	entryPoints = (long long) (passBounds[1] - passBounds[0] + 1) * (passBounds[3] - passBounds[2] + 1) * (passBounds[5] - passBounds[4] + 1);
+	if ((segmentHandle = shm_open(passSegmentName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)) < 0) return false;
+
+	// Space is reserved up front, as writing past what a full /dev/shm can hold raises SIGBUS
+	if (ftruncate(segmentHandle, segmentLength) != 0
+#ifdef __linux__
+		|| posix_fallocate(segmentHandle, 0, segmentLength) != 0
+#endif
+		) {
+		close(segmentHandle);
+		shm_unlink(passSegmentName.c_str());
+		return false;
+	}
+
+	segmentBytes = (char *) mmap(NULL, segmentLength, PROT_READ | PROT_WRITE, MAP_SHARED, segmentHandle, 0);
+	close(segmentHandle);
+	if (segmentBytes == MAP_FAILED) {
+		shm_unlink(passSegmentName.c_str());
+		return false;
+	}
+
+	arrayOffset = 0;
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetNumberOfArrays() ; arrayIdx++) {
+		arrayBytes = entryPoints * passData->GetArray(arrayIdx)->GetNumberOfComponents() * passData->GetArray(arrayIdx)->GetDataTypeSize();
+		memcpy(segmentBytes + arrayOffset, passData->GetArray(arrayIdx)->GetVoidPointer(0), arrayBytes);
+		arrayOffset += arrayBytes;
+	}
+
+	munmap(segmentBytes, segmentLength);
+
+	return true;
+#endif
+}
+
+bool GraniteNodeCache::setState(std::string passKey, std::string passSegmentName, int passState) {
+#ifdef _WIN32
+	return false;
+#else
+	Index * sharedIndex;
+	int indexHandle;
+	bool retFound, indexUsed;
+
+	if ((indexHandle = openIndex(passKey, false, &sharedIndex)) < 0) return false;
+
+	retFound = false;
+	indexUsed = false;
+	for (int recordIdx = 0 ; recordIdx < RecordCount ; recordIdx++) {
+		if (sharedIndex->records[recordIdx].state != StateFree && passSegmentName == sharedIndex->records[recordIdx].segmentName) {
+			sharedIndex->records[recordIdx].state = passState;
+			retFound = true;
+		}
+
+		if (sharedIndex->records[recordIdx].state != StateFree) indexUsed = true;
+	}
+
+	// Indexes are removed once none of their extents remain (under the lock, so processes waiting on it find the index stale and open a new one)
+	if (!indexUsed) shm_unlink(getIndexName(passKey).c_str());
+
+	closeIndex(indexHandle, sharedIndex);
+
+	return retFound;
+#endif
+}
+
+void GraniteNodeCache::evict(Entry passEntry) {
+#ifndef _WIN32
+	// Processes already copying from the segment keep their mapping
+	setState(passEntry.key, passEntry.segmentName, StateFree);
+	shm_unlink(passEntry.segmentName.c_str());
+#endif
+}
+
+std::string GraniteNodeCache::getIndexName(std::string passKey) {
+	unsigned long long keyHash;
+	char retName[64];
+
+	// FNV-1a
+	keyHash = 14695981039346656037ULL;
+	for (int charIdx = 0 ; charIdx < passKey.size() ; charIdx++) {
+		keyHash ^= (unsigned char) passKey[charIdx];
+		keyHash *= 1099511628211ULL;
+	}
+
+	snprintf(retName, sizeof(retName), "/granite-node-%016llx", keyHash);
+
+	return retName;
+}
+
+std::string GraniteNodeCache::getArraySignature(vtkDataSetAttributes * passData) {
+	std::string retSignature;
+
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetNumberOfArrays() ; arrayIdx++) {
+		if (arrayIdx > 0) retSignature += ",";
+		retSignature += std::string(passData->GetArray(arrayIdx)->GetName() ? passData->GetArray(arrayIdx)->GetName() : "") + ":" + std::to_string(passData->GetArray(arrayIdx)->GetDataType()) + ":" + std::to_string(passData->GetArray(arrayIdx)->GetNumberOfComponents());
+	}
+
+	return retSignature;
+}
+
+long long GraniteNodeCache::getBytes(int * passBounds, vtkDataSetAttributes * passData) {
+	long long retBytes, pointCount;
+
+	pointCount = (long long) (passBounds[1] - passBounds[0] + 1) * (passBounds[3] - passBounds[2] + 1) * (passBounds[5] - passBounds[4] + 1);
+
+	retBytes = 0;
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetNumberOfArrays() ; arrayIdx++) {
+		retBytes += pointCount * passData->GetArray(arrayIdx)->GetNumberOfComponents() * passData->GetArray(arrayIdx)->GetDataTypeSize();
+	}
+
+	return retBytes;
+}
+
+void GraniteNodeCache::copyRegion(const char * passSource, int * passSourceBounds, char * retTarget, int * passTargetBounds, long long passTupleBytes) {
+	long long rowBytes, rowCount;
+	int targetRows;
+
+	rowBytes = (passTargetBounds[1] - passTargetBounds[0] + 1) * passTupleBytes;
+	targetRows = passTargetBounds[3] - passTargetBounds[2] + 1;
+	rowCount = (long long) targetRows * (passTargetBounds[5] - passTargetBounds[4] + 1);
+
+	// Rows (x fastest) are contiguous in both source and target
+	vtkSMPTools::For(0, rowCount, [&](vtkIdType passBegin, vtkIdType passEnd) {
+		long long sourceIdx;
+		int yIdx, zIdx;
+
+		for (vtkIdType rowIdx = passBegin ; rowIdx < passEnd ; rowIdx++) {
+			yIdx = passTargetBounds[2] + rowIdx % targetRows;
+			zIdx = passTargetBounds[4] + rowIdx / targetRows;
+
+			sourceIdx = ((long long) (zIdx - passSourceBounds[4]) * (passSourceBounds[3] - passSourceBounds[2] + 1) + (yIdx - passSourceBounds[2])) * (passSourceBounds[1] - passSourceBounds[0] + 1) + (passTargetBounds[0] - passSourceBounds[0]);
+
+			memcpy(retTarget + rowIdx * rowBytes, passSource + sourceIdx * passTupleBytes, rowBytes);
+		}
+	});
+}
+
+bool GraniteNodeCache::isOwnerAlive(int passOwner) {
+#ifdef _WIN32
+	return false;
+#else
+	return (kill(passOwner, 0) == 0 || errno == EPERM);
+#endif
+}
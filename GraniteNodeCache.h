@@ -0,0 +1,84 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteNodeCache.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteNodeCache_h
+#define __GraniteNodeCache_h
+
+#include <list>
+#include <mutex>
+#include <string>
+
+#include "vtkDataSetAttributes.h"
+#include "GraniteCounters.h"
+#include "GraniteExtentCache.h"
+
+// Extents read by any process on the node, held in POSIX shared memory so co-located processes (e.g. pvserver ranks) read each one once
+class GraniteNodeCache {
+	public:
+		// Shared index of one key's extents (one per file, level, value type and arrays, named by a hash of the key)
+		static const int KeyCapacity = 4096;
+		static const int RecordCount = 64;
+
+		enum StateDef { StateFree,
+						StateFilling, // Owner is reading the extent, others wait for it
+						StateReady,
+						StateCount };
+
+		struct Record {
+			int state;
+			int owner; // Process that filled (and will evict) the extent
+			int bounds[6];
+			long long bytes;
+			char segmentName[48];
+		};
+
+		struct Index {
+			int keyLength;
+			char key[KeyCapacity]; // Full key, guarding against hash collisions
+			Record records[RecordCount];
+		};
+
+		static GraniteNodeCache * getInstance();
+
+		// Fill arrays (sized for bounds) from an extent of the same key cached on the node, or fetch and share it (false if the fetch was cancelled or failed)
+		bool read(std::string passKey, int * passBounds, vtkDataSetAttributes * retData, GraniteExtentCache::FetchDef passFetch, GraniteCounters * passCounters);
+		void clear(); // Evict every extent this process filled
+
+	private:
+		// Extent this process filled
+		struct Entry {
+			std::string key; // Full key (of the index holding its record)
+			std::string segmentName;
+			long long bytes;
+		};
+
+		GraniteNodeCache();
+		~GraniteNodeCache(); // Evicts extents this process filled
+
+		int openIndex(std::string passKey, bool passCreate, Index * * retIndex); // Open (creating if asked) and lock the key's linked index, -1 on failure
+		void closeIndex(int passHandle, Index * passIndex); // Unlock and unmap
+		bool copyEntry(std::string passSegmentName, int * passEntryBounds, int * passBounds, vtkDataSetAttributes * retData); // Crop a cached extent into arrays, false if it has since been evicted
+		bool addEntry(std::string passSegmentName, int * passBounds, vtkDataSetAttributes * passData); // Write arrays to a new segment
+		bool setState(std::string passKey, std::string passSegmentName, int passState); // Update the record of a segment (names are unique to their filling process), false if it is gone
+		void evict(Entry passEntry); // Free the record and remove the segment
+		static std::string getIndexName(std::string passKey); // Shared memory name from a hash of the key
+		static std::string getArraySignature(vtkDataSetAttributes * passData); // Names, types and components of arrays
+		static long long getBytes(int * passBounds, vtkDataSetAttributes * passData);
+		static void copyRegion(const char * passSource, int * passSourceBounds, char * retTarget, int * passTargetBounds, long long passTupleBytes); // Parallel crop of target rows
+		static bool isOwnerAlive(int passOwner);
+
+		std::mutex _lock; // Guards entries (readers may run on several threads)
+		std::list< Entry > _entries; // Oldest first
+		long long _bytes; // Total size of extents this process filled
+		unsigned long long _segmentCount; // Unique segment names
+};
+
+#endif // __GraniteNodeCache_h
@@ -9,11 +9,25 @@
  
  =========================================================================*/
 
-#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 
-#include "qxml.h"
+#include <map>
+#include <sys/stat.h>
+
+#include "qfile.h"
+#include "qstringlist.h"
 #include "qxmlstream.h"
+#include "vtkByteSwap.h"
+#include "vtkDataObject.h"
+#include "vtkInformationVector.h"
+#include "GraniteExtentCache.h"
+#include "GraniteNodeCache.h"
 #include "GraniteShared.h"
+#include "GraniteTrace.h"
 #include "vtkGraniteSettings.h"
 
 GraniteShared::GraniteShared() {
@@ -27,15 +41,18 @@ GraniteShared::GraniteShared() {
 
 	_dataType = "vtkImageData";
 	_voiOverride = false;
-	_grid[0] = vtkFloatArray::New();
-	_grid[1] = vtkFloatArray::New();
-	_grid[2] = vtkFloatArray::New();
+	_keepQuantized = false;
+	_grid[0] = vtkDoubleArray::New();
+	_grid[1] = vtkDoubleArray::New();
+	_grid[2] = vtkDoubleArray::New();
+	_arraySelection = vtkDataArraySelection::New();
 }
 
 GraniteShared::~GraniteShared() {
 	_grid[0]->Delete();
 	_grid[1]->Delete();
 	_grid[2]->Delete();
+	_arraySelection->Delete();
 }
 
 bool GraniteShared::initialize(std::string passFileName) {
@@ -45,21 +62,27 @@ bool GraniteShared::initialize(std::string passFileName) {
 	if (passFileName.empty()) fileName = _fileName;
 	else fileName = passFileName;
 
+	// Unchanged data source already open (e.g. VOI changes re-request output information)
+	if (fileName == _openedFileName && getSourceVersion(fileName) == _openedVersion) return true;
+	_openedFileName.clear();
+	_binaryFileName.clear();
+
 	// Attempt to open the data source
 	if (_interop.openDataSource(fileName.c_str(), true) == false) return false;
 
-	// Ready spacing for multiresolution data sets
-	for (int levelIdx = 1 ; levelIdx < _interop.getLevelCount() ; levelIdx++) {
-		_spacing.push_back(std::vector< double >());
-		_spacing.back().resize(3, 1);
-	}
+	// Ready spacing for multiresolution data sets (initialize may be called again for the same reader)
+	_spacing.assign(_interop.getLevelCount(), std::vector< double >(3, 1));
 
 	// Read Paraview specific metadata from XFDL extended by GraniteWriter
 	readCustomData(fileName);
+	updateArraySelection();
 
 	// Calculate spacing relative to root level
 	calculateSpacing();
 
+	_openedFileName = fileName;
+	_openedVersion = getSourceVersion(fileName);
+
 	return true;
 }
 
@@ -100,7 +123,6 @@ int GraniteShared::getAMRDivisions() {
 
 void GraniteShared::getAMRBlock(int passBlockID, int * retLevel, int * retBounds) {
 	int location[3]; 
-	int length[3];
 	int tempStart;
 
 	// Calculate block location
@@ -112,47 +134,55 @@ void GraniteShared::getAMRBlock(int passBlockID, int * retLevel, int * retBounds
 		tempStart -= location[dimIdx] * pow(getAMRDivisions(), dimIdx);
 	}
 
-	// Calculate block length for each dimension
+	// Set return bounds (split as write-time block statistics are)
 	_interop.setLevel(*retLevel);
 	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
-		length[dimIdx] = (_interop.getBounds()[2 * dimIdx + 1] - _interop.getBounds()[2 * dimIdx] + 1) / getAMRDivisions();
-	}
-
-	// Set return bounds
-	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
-		retBounds[2 * dimIdx] = _interop.getBounds()[2 * dimIdx] + location[dimIdx] * length[dimIdx];
-		retBounds[2 * dimIdx + 1] = _interop.getBounds()[2 * dimIdx] + (location[dimIdx] + 1) * length[dimIdx];
-
-		//Check for uneven divisions
-		if (_interop.getBounds()[2 * dimIdx + 1] - retBounds[2 * dimIdx + 1] < length[dimIdx]) {
-			retBounds[2 * dimIdx + 1] = _interop.getBounds()[2 * dimIdx + 1];
-		}
+		GraniteStatistics::getBlockExtent(_interop.getBounds()[2 * dimIdx + 1] - _interop.getBounds()[2 * dimIdx] + 1, getAMRDivisions(), location[dimIdx], &retBounds[2 * dimIdx], &retBounds[2 * dimIdx + 1]);
+		retBounds[2 * dimIdx] += _interop.getBounds()[2 * dimIdx];
+		retBounds[2 * dimIdx + 1] += _interop.getBounds()[2 * dimIdx];
 	}
 }
 
 void GraniteShared::readCustomData(std::string passFileName) {
 	QXmlStreamReader::TokenType xmlToken;
-	std::auto_ptr<ifstream> fileStream;
-	std::string xmlContents;
-
-	// Read XFDL file
-	#ifdef _WIN32
-		fileStream.reset(new ifstream(passFileName, ios::out | ios::binary));
-	#else
-		fileStream.reset(new ifstream(passFileName, ios::out));
-	#endif
-
-	// Parse XML
-	xmlContents.assign((std::istreambuf_iterator<char>(*fileStream)), std::istreambuf_iterator<char>());
-	fileStream->close();
-
-	QXmlStreamReader xmlStream(xmlContents.c_str());
+	QFile xmlFile(QString::fromStdString(passFileName));
+	std::string gridFileName, binaryFileName;
+	std::map< std::string, GraniteStorage::Encoding > fieldEncodings;
+	std::map< std::string, long long > fieldOffsets;
+	std::vector< std::map< std::string, long long > > levelFieldOffsets;
+	std::vector< std::vector< int > > levelBounds;
+	QStringList levelExtent;
+	std::vector< GraniteStorage::Encoding > storageEncodings;
+	GraniteStorage::Encoding currentEncoding;
+	GraniteStorage::ByteOrderDef storageByteOrder;
+	GraniteStorage::LayoutDef storageLayout;
+	bool nativeStorage, inLevel;
+	int gridCounts[3];
+
+	GraniteCounters::ScopedTimer parseTimer(_interop.getCounters(), GraniteCounters::TimeXMLParse);
+	GraniteTrace::Span parseSpan("readCustomData", "read", passFileName.c_str());
+
+	_statistics.clear();
+	_storage.reset();
+	_levelOffsets.clear();
+	_levelFieldOffsets.clear();
+	nativeStorage = false;
+	inLevel = false;
+
+	// Stream XML from the XFDL file rather than loading it whole
+	if (xmlFile.open(QIODevice::ReadOnly) == false) return;
+	QXmlStreamReader xmlStream(&xmlFile);
 
 	while(!xmlStream.atEnd()) {
 		xmlToken = xmlStream.readNext();
 
 		// Check for supported custom element
 		if(xmlToken == QXmlStreamReader::StartElement) {
+			// Binary described by XFDL
+			if(xmlStream.name() == "FileDescriptor") {
+				binaryFileName = xmlStream.attributes().value("fileName").toString().toStdString();
+			}
+
 			// CustomParaViewType
 			if(xmlStream.name() == "CustomParaViewType") {
 				_dataType = xmlStream.readElementText().toStdString();
@@ -172,42 +202,267 @@ void GraniteShared::readCustomData(std::string passFileName) {
 				_spacing.back().at(2) = xmlStream.attributes().value("z").toString().toDouble();
 			}
 
-			// CustomParaViewGrid
+			// CustomParaViewGrid (coordinates as text, written by earlier plugin versions)
 			if(xmlStream.name() == "CustomParaViewGrid") {
-				convertQList(xmlStream.attributes().value("x").toString().split(" "), _grid[0]);
-				convertQList(xmlStream.attributes().value("y").toString().split(" "), _grid[1]);
-				convertQList(xmlStream.attributes().value("z").toString().split(" "), _grid[2]);
+				convertCoordinates(xmlStream.attributes().value("x").toString(), _grid[0]);
+				convertCoordinates(xmlStream.attributes().value("y").toString(), _grid[1]);
+				convertCoordinates(xmlStream.attributes().value("z").toString(), _grid[2]);
+			}
+
+			// CustomParaViewGridFile (coordinates in binary sidecar)
+			if(xmlStream.name() == "CustomParaViewGridFile") {
+				gridFileName = xmlStream.attributes().value("fileName").toString().toStdString();
+				gridCounts[0] = xmlStream.attributes().value("x").toString().toInt();
+				gridCounts[1] = xmlStream.attributes().value("y").toString().toInt();
+				gridCounts[2] = xmlStream.attributes().value("z").toString().toInt();
+			}
+
+			// CustomParaViewStorage (binary read directly by plugin)
+			if(xmlStream.name() == "CustomParaViewStorage") {
+				storageByteOrder = GraniteStorage::parseByteOrder(xmlStream.attributes().value("byteOrder").toString().toStdString());
+				storageLayout = GraniteStorage::parseLayout(xmlStream.attributes().value("layout").toString().toStdString());
+				nativeStorage = true;
+			}
+
+			// FieldEncoding (quantized or half precision field of native storage)
+			if(xmlStream.name() == "FieldEncoding") {
+				currentEncoding.type = GraniteStorage::parseEncoding(xmlStream.attributes().value("type").toString().toStdString());
+				currentEncoding.scale = xmlStream.attributes().value("scale").toString().toDouble();
+				currentEncoding.offset = xmlStream.attributes().value("offset").toString().toDouble();
+				fieldEncodings[xmlStream.attributes().value("fieldName").toString().toStdString()] = currentEncoding;
+			}
+
+			// Level of CustomParaViewContainer (extent and byte offset within the binary)
+			if(xmlStream.name() == "Level") {
+				levelExtent = xmlStream.attributes().value("extent").toString().split(" ", QString::SkipEmptyParts);
+				if (levelExtent.size() == 6) {
+					levelBounds.push_back(std::vector< int >(6));
+					for (int boundIdx = 0 ; boundIdx < 6 ; boundIdx++) {
+						levelBounds.back()[boundIdx] = levelExtent[boundIdx].toInt();
+					}
+					_levelOffsets.push_back(xmlStream.attributes().value("offset").toString().toLongLong());
+					levelFieldOffsets.push_back(std::map< std::string, long long >());
+					inLevel = true;
+				}
+			}
+
+			// FieldOffset (start of a field's plane within planar storage, or within a container Level)
+			if(xmlStream.name() == "FieldOffset") {
+				if (inLevel) levelFieldOffsets.back()[xmlStream.attributes().value("fieldName").toString().toStdString()] = xmlStream.attributes().value("offset").toString().toLongLong();
+				else fieldOffsets[xmlStream.attributes().value("fieldName").toString().toStdString()] = xmlStream.attributes().value("offset").toString().toLongLong();
+			}
+
+			// CustomParaViewStatistics
+			if(xmlStream.name() == "CustomParaViewStatistics") {
+				_statistics.readXML(&xmlStream);
+			}
+		}
+
+		if(xmlToken == QXmlStreamReader::EndElement && xmlStream.name() == "Level") inLevel = false;
+	}
+
+	xmlFile.close();
+
+	// Sidecar is relative to the XFDL file
+	if (!gridFileName.empty()) {
+		readGridFile(passFileName.substr(0, passFileName.find_last_of("/\\") + 1) + gridFileName, gridCounts);
+	}
+
+	// Binary named directly (not a multiresolution "@" reference) is relative to the XFDL file
+	if (!binaryFileName.empty() && binaryFileName[0] != '@') {
+		_binaryFileName = passFileName.substr(0, passFileName.find_last_of("/\\") + 1) + binaryFileName;
+	}
+
+	// Native storage only applies to a binary named directly
+	if (nativeStorage && !_binaryFileName.empty()) {
+		// Encodings in attribute order (fields not listed, and all fields of older files, are floats)
+		if (!fieldEncodings.empty()) {
+			for (int attrIdx = 0 ; attrIdx < _interop.getAttributeCount() ; attrIdx++) {
+				storageEncodings.push_back(GraniteStorage::makeEncoding(GraniteStorage::Float32, 0, 0));
+				if (fieldEncodings.find(_interop.getAttributeName(attrIdx)) != fieldEncodings.end()) storageEncodings.back() = fieldEncodings[_interop.getAttributeName(attrIdx)];
 			}
 		}
+
+		_storage.setFormat(storageByteOrder, storageLayout, _binaryFileName, storageEncodings);
+		_storage.setFieldOffsets(orderFieldOffsets(fieldOffsets));
+
+		for (int levelIdx = 0 ; levelIdx < levelFieldOffsets.size() ; levelIdx++) {
+			_levelFieldOffsets.push_back(orderFieldOffsets(levelFieldOffsets[levelIdx]));
+		}
+	}
+
+	// Container levels replace the single level Granite sees (coarser levels take spacing ahead of the root's, filled by calculateSpacing)
+	if (_storage.isNative() && levelBounds.size() > 1) {
+		_interop.setLevels(levelBounds);
+		_spacing.insert(_spacing.begin(), _interop.getLevelCount() - _spacing.size(), std::vector< double >(3, 1));
+	}
+	else {
+		_levelOffsets.clear();
+		_levelFieldOffsets.clear();
 	}
 }
 
-void GraniteShared::readFieldData(vtkPointData * passData) {
-	std::string compositeName, arrayName, componentName;
-	vtkDataArray * tempArray, * currentArray;
+void GraniteShared::readGridFile(std::string passFileName, int * passCounts) {
+	std::ifstream gridStream;
+	bool success;
 
-	// Iterate through all attributes
-	for (int attrIdx = 0 ; attrIdx < _interop.getAttributeCount() ; attrIdx++) {
-		// Parse array from components names
-		compositeName = _interop.getAttributeName(attrIdx);
-		if (compositeName.find(".") == std::string::npos) {
-			arrayName = "Granite Values";
-			componentName = compositeName;
+	gridStream.open(passFileName.c_str(), std::ios::in | std::ios::binary);
+	success = gridStream.is_open();
+
+	// Big-endian doubles, one axis after the other
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		_grid[dimIdx]->Initialize();
+		_grid[dimIdx]->SetNumberOfTuples(std::max(passCounts[dimIdx], 0));
+		if (!success || passCounts[dimIdx] <= 0) continue;
+
+		gridStream.read((char *) _grid[dimIdx]->GetPointer(0), passCounts[dimIdx] * sizeof(double));
+		vtkByteSwap::Swap8BERange(_grid[dimIdx]->GetPointer(0), passCounts[dimIdx]);
+		success = !gridStream.fail();
+	}
+
+	// Missing or short sidecar - unit spacing on every axis rather than leaving coordinates uninitialized
+	if (!success) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to read Granite grid coordinates from " + passFileName + ", using uniform spacing.").c_str());
+
+		for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+			for (vtkIdType tupleIdx = 0 ; tupleIdx < _grid[dimIdx]->GetNumberOfTuples() ; tupleIdx++) {
+				_grid[dimIdx]->SetValue(tupleIdx, tupleIdx);
+			}
 		}
-		else {
-			arrayName = compositeName.substr(0, compositeName.find("."));
-			componentName = compositeName.substr(compositeName.find(".") + 1);
+	}
+}
+
+void GraniteShared::getCoordinates(int passLevel, int * passExtent, vtkDoubleArray ** retCoordinates) {
+	int * rootBounds, * levelBounds;
+	vtkIdType stride, gridIdx, lastIdx;
+
+	rootBounds = _interop.getBounds(_interop.getLevelCount() - 1);
+	levelBounds = _interop.getBounds(passLevel);
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		// Coarser levels subsample the full resolution points at the level's stride
+		stride = std::max< vtkIdType >(1, (vtkIdType) floor((double) (rootBounds[2 * dimIdx + 1] + 1 - rootBounds[2 * dimIdx]) / (levelBounds[2 * dimIdx + 1] + 1 - levelBounds[2 * dimIdx]) + 0.5));
+		lastIdx = _grid[dimIdx]->GetNumberOfTuples() - 1;
+
+		retCoordinates[dimIdx]->Initialize();
+		retCoordinates[dimIdx]->SetNumberOfTuples(std::max(passExtent[2 * dimIdx + 1] - passExtent[2 * dimIdx] + 1, 0));
+
+		for (int pointIdx = passExtent[2 * dimIdx] ; pointIdx <= passExtent[2 * dimIdx + 1] ; pointIdx++) {
+			// Points past the grid take its last coordinate (no grid at all leaves index positions)
+			gridIdx = std::max< vtkIdType >(0, std::min((pointIdx - levelBounds[2 * dimIdx]) * stride, lastIdx));
+			retCoordinates[dimIdx]->SetValue(pointIdx - passExtent[2 * dimIdx], (lastIdx < 0 ? pointIdx : _grid[dimIdx]->GetValue(gridIdx)));
 		}
+	}
+}
+
+bool GraniteShared::copyData(int * passBounds, vtkDataSetAttributes * retData) {
+	// No arrays selected, nothing to read (an empty field list would otherwise mean every field)
+	if (retData->GetNumberOfArrays() == 0) return true;
+
+	if (_storage.isNative()) {
+		selectStorageLevel();
+
+		return _storage.copyFloatData(passBounds, _interop.getBounds(), retData, _interop.getCounters(), _progress);
+	}
+
+	return _interop.copyFloatData(passBounds, retData, _progress);
+}
+
+std::string GraniteShared::getCacheKey() {
+	std::vector< int > selectedFields;
+	std::string retKey;
+
+	// Extents are shared between readers of the same file, level, value type and fields (and discarded once the file changes)
+	retKey = _fileName + "|" + std::to_string(_interop.getLevel()) + "|" + getSourceVersion(_fileName) + (isQuantizedKept() ? "|q" : "|f");
+	selectedFields = getSelectedFields();
+	for (int fieldIdx = 0 ; fieldIdx < selectedFields.size() ; fieldIdx++) {
+		retKey += "|" + std::string(_interop.getAttributeName(selectedFields[fieldIdx]));
+	}
+
+	return retKey;
+}
+
+bool GraniteShared::fetchData(int * passBounds, vtkDataSetAttributes * retData) {
+	return GraniteNodeCache::getInstance()->read(getCacheKey(), passBounds, retData, [this](int * passFetchBounds, vtkDataSetAttributes * retFetchData) { return copyData(passFetchBounds, retFetchData); }, _interop.getCounters());
+}
+
+bool GraniteShared::readExtent(int * passBounds, vtkPointData * retData) {
+	if (retData->GetNumberOfArrays() == 0) return true;
+
+	return GraniteExtentCache::getInstance()->read(getCacheKey(), passBounds, retData, [this](int * passFetchBounds, vtkDataSetAttributes * retFetchData) { return fetchData(passFetchBounds, retFetchData); }, _interop.getCounters());
+}
+
+bool GraniteShared::isMappable(int * passBounds, int * passFullBounds) {
+	// Full extent of host ordered planar float storage
+	if (memcmp(passBounds, passFullBounds, 6 * sizeof(int)) != 0 || !_storage.isNative() || _storage.isEncoded()) return false;
+
+	return (_storage.getLayout() == GraniteStorage::Planar && _storage.getByteOrder() == GraniteStorage::getHostByteOrder());
+}
+
+long long GraniteShared::estimateReadBytes(int * passBounds, int * passFullBounds, int passValueSize, long long * retArrayBytes) {
+	std::vector< int > selectedFields;
+	long long pointCount, slicePoints, transientBytes, heapTotal, heapFree, heapMax;
+
+	selectedFields = getSelectedFields();
+	pointCount = 1;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		pointCount *= passBounds[2 * dimIdx + 1] - passBounds[2 * dimIdx] + 1;
+	}
+	slicePoints = pointCount / (passBounds[5] - passBounds[4] + 1);
+
+	// Output arrays (none when the fields' own arrays are mapped), then buffers held while they are filled - queued slabs, or one slice both in the JVM and copied out of it
+	*retArrayBytes = 0;
+	transientBytes = 0;
+
+	if (passValueSize > 0 || !isMappable(passBounds, passFullBounds)) {
+		for (int fieldIdx = 0 ; fieldIdx < selectedFields.size() ; fieldIdx++) {
+			*retArrayBytes += pointCount * (passValueSize > 0 ? passValueSize : vtkDataArray::GetDataTypeSize(getArrayType(selectedFields[fieldIdx])));
+		}
+
+		// Granite still hands every attribute across JNI, native storage only the selected ones
+		if (_storage.isNative()) {
+			_storage.setFields(selectedFields.size() == _interop.getAttributeCount() ? std::vector< int >() : selectedFields, _interop.getAttributeCount());
+			transientBytes = _storage.getBufferBytes(passBounds, passFullBounds, selectedFields.size());
+		}
+		else transientBytes = slicePoints * (_interop.getAttributeCount() + selectedFields.size()) * sizeof(float);
+	}
+
+	// Heap the JVM has already committed stays held throughout
+	if (_interop.getJVMMemory(&heapTotal, &heapFree, &heapMax) == false) heapTotal = 0;
+
+	return *retArrayBytes + transientBytes + heapTotal;
+}
+
+void GraniteShared::readFieldData(vtkPointData * passData, bool passAllocate) {
+	std::vector< int > selectedFields;
+	std::string arrayName, componentName;
+	vtkDataArray * tempArray, * currentArray;
+
+	// Only enabled arrays are read (every field when all are, so the copy paths stay unmapped)
+	selectedFields = getSelectedFields();
+	if (selectedFields.size() == _interop.getAttributeCount()) {
+		_interop.setFields(std::vector< int >());
+		_storage.setFields(std::vector< int >(), _interop.getAttributeCount());
+	}
+	else {
+		_interop.setFields(selectedFields);
+		_storage.setFields(selectedFields, _interop.getAttributeCount());
+	}
+
+	// Iterate through selected attributes (arrays are float unless quantized codes are kept)
+	for (int fieldIdx = 0 ; fieldIdx < selectedFields.size() ; fieldIdx++) {
+		// Parse array from components names
+		splitAttributeName(_interop.getAttributeName(selectedFields[fieldIdx]), &arrayName, &componentName);
 
 		// Add array if it doesn't exist
 		if ((currentArray = passData->GetArray(arrayName.c_str())) == NULL) {
-			tempArray = vtkDataArray::CreateDataArray(VTK_FLOAT);
+			tempArray = vtkDataArray::CreateDataArray(getArrayType(selectedFields[fieldIdx]));
 			tempArray->SetName(arrayName.c_str());
 			currentArray = passData->GetArray(passData->AddArray(tempArray));
 			tempArray->Delete();
 
 			// Make first array default scalars array (regardless of component count for now)
-			if (attrIdx == 0) {
+			if (fieldIdx == 0) {
 				passData->SetActiveScalars(arrayName.c_str());
 			}
 		}
@@ -217,11 +472,153 @@ void GraniteShared::readFieldData(vtkPointData * passData) {
 		currentArray->SetComponentName(currentArray->GetNumberOfComponents() - 2, componentName.c_str());
 	}
 
-	// Allocate space for all arrays
+	// Allocate space for all arrays (unless storage will be supplied by a mapping)
 	for (int arrayIdx = 0 ; arrayIdx < passData->GetNumberOfArrays() ; arrayIdx++) {
 		passData->GetArray(arrayIdx)->SetNumberOfComponents(passData->GetArray(arrayIdx)->GetNumberOfComponents() - 1);
-		passData->GetArray(arrayIdx)->SetNumberOfTuples(getVolumeSize());
+		if (passAllocate) passData->GetArray(arrayIdx)->SetNumberOfTuples(getVolumeSize());
+	}
+}
+
+void GraniteShared::updateArraySelection() {
+	vtkDataArraySelection * previousSelection;
+	std::string arrayName, componentName;
+
+	previousSelection = vtkDataArraySelection::New();
+	previousSelection->CopySelections(_arraySelection);
+	_arraySelection->RemoveAllArrays();
+
+	// Arrays enabled unless previously disabled
+	for (int attrIdx = 0 ; attrIdx < _interop.getAttributeCount() ; attrIdx++) {
+		splitAttributeName(_interop.getAttributeName(attrIdx), &arrayName, &componentName);
+		if (_arraySelection->ArrayExists(arrayName.c_str())) continue;
+
+		_arraySelection->AddArray(arrayName.c_str());
+		if (previousSelection->ArrayExists(arrayName.c_str()) && !previousSelection->ArrayIsEnabled(arrayName.c_str())) {
+			_arraySelection->DisableArray(arrayName.c_str());
+		}
+	}
+
+	previousSelection->Delete();
+}
+
+std::vector< int > GraniteShared::getSelectedFields() {
+	std::vector< int > retFields;
+	std::string arrayName, componentName;
+
+	for (int attrIdx = 0 ; attrIdx < _interop.getAttributeCount() ; attrIdx++) {
+		splitAttributeName(_interop.getAttributeName(attrIdx), &arrayName, &componentName);
+		if (_arraySelection->ArrayIsEnabled(arrayName.c_str())) retFields.push_back(attrIdx);
+	}
+
+	return retFields;
+}
+
+std::vector< long long > GraniteShared::orderFieldOffsets(std::map< std::string, long long > & passOffsets) {
+	std::vector< long long > retOffsets;
+
+	for (int attrIdx = 0 ; attrIdx < _interop.getAttributeCount() ; attrIdx++) {
+		if (passOffsets.find(_interop.getAttributeName(attrIdx)) == passOffsets.end()) return std::vector< long long >();
+		retOffsets.push_back(passOffsets[_interop.getAttributeName(attrIdx)]);
+	}
+
+	return retOffsets;
+}
+
+void GraniteShared::selectStorageLevel() {
+	int levelIdx;
+
+	// Container levels are listed full resolution first, as Granite orders them
+	if (_levelOffsets.empty()) return;
+
+	levelIdx = _interop.getLevelCount() - 1 - _interop.getLevel();
+	_storage.setOffset(_levelOffsets[levelIdx]);
+	if (levelIdx < _levelFieldOffsets.size()) _storage.setFieldOffsets(_levelFieldOffsets[levelIdx]);
+}
+
+bool GraniteShared::isQuantizedKept() {
+	return (_keepQuantized && _storage.isEncoded());
+}
+
+int GraniteShared::getArrayType(int passField) {
+	if (!_keepQuantized) return VTK_FLOAT;
+
+	switch (_storage.getEncoding(passField).type) {
+		case GraniteStorage::UInt8: return VTK_UNSIGNED_CHAR;
+		case GraniteStorage::UInt16: return VTK_UNSIGNED_SHORT;
+		default: return VTK_FLOAT;
+	}
+}
+
+void GraniteShared::splitAttributeName(std::string passName, std::string * retArray, std::string * retComponent) {
+	if (passName.find(".") == std::string::npos) {
+		*retArray = "Granite Values";
+		*retComponent = passName;
+	}
+	else {
+		*retArray = passName.substr(0, passName.find("."));
+		*retComponent = passName.substr(passName.find(".") + 1);
+	}
+}
+
+void GraniteShared::writeFieldRanges(vtkInformation * retInfo, int passAssociation, const char * passArrayName) {
+	std::map< std::string, std::pair< int, std::vector< double > > > arrayRanges;
+	std::map< std::string, std::pair< int, std::vector< double > > >::iterator rangeIter;
+	std::map< std::string, int > arrayTypes;
+	vtkInformationVector * fieldVector;
+	GraniteStorage::Encoding currentEncoding;
+	double currentRange[2];
+	vtkInformation * fieldInfo;
+	GraniteStatistics::Summary * currentSummary;
+	std::string arrayName, componentName;
+
+	if (_statistics.isEmpty()) return;
+
+	// Union component ranges per array (component count, then min/max)
+	for (int fieldIdx = 0 ; fieldIdx < _statistics.getFieldCount() ; fieldIdx++) {
+		currentSummary = _statistics.getField(fieldIdx);
+		if (currentSummary->count == 0) continue;
+
+		splitAttributeName(_statistics.getFieldName(fieldIdx), &arrayName, &componentName);
+		if (passArrayName) arrayName = passArrayName;
+
+		// Kept codes are published as code ranges
+		currentRange[0] = currentSummary->minimum;
+		currentRange[1] = currentSummary->maximum;
+		if (passArrayName == NULL && getArrayType(fieldIdx) != VTK_FLOAT) {
+			currentEncoding = _storage.getEncoding(fieldIdx);
+			currentRange[0] = floor((currentRange[0] - currentEncoding.offset) / currentEncoding.scale + 0.5);
+			currentRange[1] = floor((currentRange[1] - currentEncoding.offset) / currentEncoding.scale + 0.5);
+		}
+
+		if (arrayRanges.find(arrayName) == arrayRanges.end()) {
+			arrayRanges[arrayName] = std::make_pair(0, std::vector< double >(2));
+			arrayRanges[arrayName].second[0] = currentRange[0];
+			arrayRanges[arrayName].second[1] = currentRange[1];
+			arrayTypes[arrayName] = (passArrayName ? VTK_FLOAT : getArrayType(fieldIdx));
+		}
+
+		arrayRanges[arrayName].first++;
+		arrayRanges[arrayName].second[0] = std::min(arrayRanges[arrayName].second[0], currentRange[0]);
+		arrayRanges[arrayName].second[1] = std::max(arrayRanges[arrayName].second[1], currentRange[1]);
+	}
+
+	// Downstream filters and color maps read these without requesting any data
+	fieldVector = vtkInformationVector::New();
+	for (rangeIter = arrayRanges.begin() ; rangeIter != arrayRanges.end() ; rangeIter++) {
+		fieldInfo = vtkInformation::New();
+		fieldInfo->Set(vtkDataObject::FIELD_ARRAY_NAME(), rangeIter->first.c_str());
+		fieldInfo->Set(vtkDataObject::FIELD_ASSOCIATION(), passAssociation);
+		fieldInfo->Set(vtkDataObject::FIELD_ARRAY_TYPE(), arrayTypes[rangeIter->first]);
+		fieldInfo->Set(vtkDataObject::FIELD_NUMBER_OF_COMPONENTS(), rangeIter->second.first);
+		fieldInfo->Set(vtkDataObject::FIELD_RANGE(), &rangeIter->second.second[0], 2);
+		fieldVector->Append(fieldInfo);
+		fieldInfo->Delete();
 	}
+
+	if (passAssociation == vtkDataObject::FIELD_ASSOCIATION_CELLS) retInfo->Set(vtkDataObject::CELL_DATA_VECTOR(), fieldVector);
+	else retInfo->Set(vtkDataObject::POINT_DATA_VECTOR(), fieldVector);
+
+	fieldVector->Delete();
 }
 
 void GraniteShared::calculateSpacing() {
@@ -245,9 +642,50 @@ void GraniteShared::calculateSpacing() {
 	}
 }
 
-void GraniteShared::convertQList(QStringList passList, vtkFloatArray * retArray) {
-	// Parse float-formatted strings and add to floatArray
-	for (int listIdx = 0 ; listIdx < passList.size() ; listIdx++) {
-		retArray->InsertNextValue(passList[listIdx].toDouble());
+void GraniteShared::convertCoordinates(QString passString, vtkDoubleArray * retArray) {
+	QByteArray coordinateBytes;
+	const char * currentPos;
+	char * endPos;
+	double currentValue;
+
+	retArray->Initialize();
+	coordinateBytes = passString.toLatin1();
+	currentPos = coordinateBytes.constData();
+
+	// Parse values in place rather than splitting into a list of strings
+	while (true) {
+		currentValue = strtod(currentPos, &endPos);
+		if (endPos == currentPos) break;
+
+		retArray->InsertNextValue(currentValue);
+		currentPos = endPos;
 	}
-}
\ No newline at end of file
+}
+
+std::string GraniteShared::getSourceVersion(std::string passFileName) {
+	std::string retVersion;
+
+	// Rewriting the binary in place (e.g. an update within the same second) may leave the XFDL untouched
+	retVersion = getFileVersion(passFileName);
+	if (!_binaryFileName.empty()) retVersion += "+" + getFileVersion(_binaryFileName);
+
+	return retVersion;
+}
+
+std::string GraniteShared::getFileVersion(std::string passFileName) {
+	struct stat fileStat;
+	long long nanoseconds;
+
+	if (stat(passFileName.c_str(), &fileStat) != 0) return "0";
+
+	// Sub-second modification times where the platform keeps them
+#if defined(_WIN32)
+	nanoseconds = 0;
+#elif defined(__APPLE__)
+	nanoseconds = fileStat.st_mtimespec.tv_nsec;
+#else
+	nanoseconds = fileStat.st_mtim.tv_nsec;
+#endif
+
+	return std::to_string((long long) fileStat.st_mtime) + "." + std::to_string(nanoseconds) + ":" + std::to_string((long long) fileStat.st_size);
+}
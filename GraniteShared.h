@@ -12,20 +12,32 @@
 #ifndef __GraniteShared_h
 #define __GraniteShared_h
 
+#include <functional>
+#include <map>
 #include <string>
 
 #include "GraniteInterop.h"
-#include "qstringlist.h"
+#include "GraniteStatistics.h"
+#include "GraniteStorage.h"
+#include "qstring.h"
+#include "vtkDataArraySelection.h"
+#include "vtkInformation.h"
 #include "vtkPointData.h"
-#include "vtkFloatArray.h"
+#include "vtkDoubleArray.h"
 
 class vtkGraniteReader;
 class vtkGraniteReaderAMR;
+class vtkGraniteCollectionReader;
+class GraniteSlicePrefetch;
+class GraniteBenchmark;
 
 class GraniteShared {
 	// Allow trusted readers to access private common information without overhead
 	friend class vtkGraniteReader;
 	friend class vtkGraniteReaderAMR;
+	friend class vtkGraniteCollectionReader;
+	friend class GraniteSlicePrefetch;
+	friend class GraniteBenchmark;
 
 	public:
 		GraniteShared();
@@ -36,24 +48,52 @@ class GraniteShared {
 		int getVolumeSize(int passBlockID); // Return number of tuples for the specified AMR block ID
 		int getAMRDivisions(); // Return number of AMR divisions from settings menu
 		void getAMRBlock(int passBlockID, int * retLevel, int * retBounds); // Calculate level and bounds for the specified block ID
+		std::string getCacheKey(); // File, level, version, value type and selected fields shared extents are keyed by
+		bool copyData(int * passBounds, vtkDataSetAttributes * retData); // Copy data for bounds through Granite or directly from native storage (false if cancelled or failed)
+		bool fetchData(int * passBounds, vtkDataSetAttributes * retData); // Copy data for bounds through the node cache (arrays sized), or as copyData
+		bool readExtent(int * passBounds, vtkPointData * retData); // Copy data for bounds through the shared extent cache (arrays created, unsized)
+		bool isMappable(int * passBounds, int * passFullBounds); // Bounds of a level can be mapped from native storage rather than copied
+		long long estimateReadBytes(int * passBounds, int * passFullBounds, int passValueSize, long long * retArrayBytes); // Most bytes a read of bounds holds at once, from metadata alone (values of passValueSize bytes, 0 for the fields' own types)
+		void getCoordinates(int passLevel, int * passExtent, vtkDoubleArray ** retCoordinates); // vtkRectilinearGrid coordinates of an extent of a level (coarser levels subsample the full resolution grid)
+		void writeFieldRanges(vtkInformation * retInfo, int passAssociation, const char * passArrayName = NULL); // Publish array ranges from write-time statistics
+		static std::string getFileVersion(std::string passFileName); // Modification time (with nanoseconds) and size ("0" if missing)
 
 	private:
 		void readCustomData(std::string passFileName); // Read custom ParaView XML data
-		void readFieldData(vtkPointData * passData); // Read field data from Granite	
+		void readGridFile(std::string passFileName, int * passCounts); // Read binary vtkRectilinearGrid coordinates
+		void readFieldData(vtkPointData * passData, bool passAllocate = true); // Read field data from Granite (arrays enabled in the selection only)
+		void updateArraySelection(); // List arrays of the open data source, keeping earlier choices for those still present
+		std::vector< int > getSelectedFields(); // Attributes of enabled arrays, in attribute order
+		std::vector< long long > orderFieldOffsets(std::map< std::string, long long > & passOffsets); // Plane offsets in attribute order (empty unless every attribute is listed)
+		void selectStorageLevel(); // Point native storage at the current level (of a multiresolution container)
+		bool isQuantizedKept(); // Quantized fields are being read as codes
+		int getArrayType(int passField); // VTK type of a field's array (codes if kept quantized, else float)
+		void splitAttributeName(std::string passName, std::string * retArray, std::string * retComponent); // Split Granite attribute into array and component
 		void calculateSpacing(); // Calculate multiresolution spacing
-		void convertQList(QStringList passList, vtkFloatArray * retArray); // Convert QStringList of strings to double array
+		void convertCoordinates(QString passString, vtkDoubleArray * retArray); // Parse space separated coordinates (older XFDL files)
+		std::string getSourceVersion(std::string passFileName); // Versions of an XFDL and the open binary (changing whenever either is rewritten)
 
 		// Data type specific
 		std::vector< std::vector< double > > _spacing; // vtkImageData/vtkOverlappingAMR spacing per resolution
-		vtkFloatArray * _grid[3]; // vtkRectilinearGrid spacing
+		vtkDoubleArray * _grid[3]; // vtkRectilinearGrid spacing
 
 		// Common
 		std::string _fileName; // XFDL filename
+		std::string _openedFileName; // XFDL filename of open data source
+		std::string _binaryFileName; // Binary of open data source (empty for multiresolution references)
+		std::string _openedVersion; // Version of open XFDL and binary (reopened when changed)
 		std::string _dataType; // Data set type
 		double _origin[3]; // Axes origin
+		bool _keepQuantized; // Quantized fields read as their 8/16 bit codes rather than floats
 		bool _voiOverride; // Whether to use (or set) Volume of Interest
 		int _voiBounds[6]; // Volume of Interest bounds
+		GraniteStatistics _statistics; // Write-time statistics from XFDL (empty for older files)
+		GraniteStorage _storage; // Binary storage format (Granite unless XFDL specifies native storage)
+		std::vector< long long > _levelOffsets; // Byte offset of each level within a multiresolution container (full resolution first, empty otherwise)
+		std::vector< std::vector< long long > > _levelFieldOffsets; // Byte offset of each field's plane within each container level (empty if not listed)
+		vtkDataArraySelection * _arraySelection; // Point arrays to read
 		GraniteInterop _interop; // Interoperability with Granite java lib
+		std::function< bool(double) > _progress; // Fraction of current read done, returns false to cancel it (set by owning reader, unset for none)
 };
 
 #endif // __GraniteShared_h
\ No newline at end of file
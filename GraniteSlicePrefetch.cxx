@@ -0,0 +1,197 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteSlicePrefetch.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <cstdlib>
+#include <cstring>
+
+#include "GraniteSlicePrefetch.h"
+#include "GraniteTrace.h"
+
+GraniteSlicePrefetch::GraniteSlicePrefetch() {
+	_source = NULL;
+	_axis = 2;
+	_radius = 0;
+	_counters = NULL;
+	_generation = 0;
+	_servingGeneration = 0;
+	_fetchingIndex = -1;
+	_pending = false;
+	_busy = false;
+	_stopping = false;
+}
+
+GraniteSlicePrefetch::~GraniteSlicePrefetch() {
+	{
+		std::lock_guard< std::mutex > guard(_lock);
+
+		_stopping = true;
+		_generation++;
+		_requestCondition.notify_all();
+	}
+
+	if (_thread.joinable()) _thread.join();
+
+	delete _source;
+}
+
+bool GraniteSlicePrefetch::take(GraniteShared * passSource, int passAxis, int passIndex, vtkPointData * retData) {
+	std::unique_lock< std::mutex > lock(_lock);
+
+	if (_key.empty() || _key != getKey(passSource, passAxis)) return false;
+
+	// A slice being read is waited for rather than read again
+	_idleCondition.wait(lock, [this, passIndex] { return _fetchingIndex != passIndex; });
+
+	for (int slotIdx = 0 ; slotIdx < _slots.size() ; slotIdx++) {
+		if (_slots[slotIdx].index != passIndex) continue;
+
+		// Arrays are shared with the output, and never modified once prefetched
+		retData->ShallowCopy(_slots[slotIdx].data);
+
+		return true;
+	}
+
+	return false;
+}
+
+void GraniteSlicePrefetch::prefetch(GraniteShared * passSource, int * passBounds, int passAxis, int passRadius) {
+	std::unique_lock< std::mutex > lock(_lock);
+	std::string sliceKey;
+
+	if (passRadius <= 0) return;
+
+	// The background source is only reconfigured while the thread idles
+	cancel(lock);
+
+	if (_source == NULL || _source->_fileName != passSource->_fileName) {
+		delete _source;
+		_source = new GraniteShared;
+		_source->_fileName = passSource->_fileName;
+		_source->_progress = [this](double passFraction) { return _servingGeneration == _generation; };
+	}
+
+	// Opened here, so the JVM is always created on the pipeline thread
+	if (_source->initialize() == false) return;
+
+	_source->_keepQuantized = passSource->_keepQuantized;
+	_source->_arraySelection->CopySelections(passSource->_arraySelection);
+	_source->_interop.setLevel(passSource->_interop.getLevel());
+	_source->_interop.getCounters()->beginOperation();
+
+	// Slots of another file, level, array set or axis are dropped
+	sliceKey = getKey(passSource, passAxis);
+	if (sliceKey != _key || _slots.size() != 2 * passRadius) {
+		_slots.assign(2 * passRadius, Slot());
+		for (int slotIdx = 0 ; slotIdx < _slots.size() ; slotIdx++) {
+			_slots[slotIdx].index = -1;
+		}
+		_key = sliceKey;
+	}
+
+	memcpy(_bounds, passBounds, sizeof(_bounds));
+	memcpy(_levelBounds, passSource->_interop.getBounds(), sizeof(_levelBounds));
+	_axis = passAxis;
+	_radius = passRadius;
+	_counters = passSource->_interop.getCounters();
+	_pending = true;
+
+	if (!_thread.joinable()) _thread = std::thread(&GraniteSlicePrefetch::run, this);
+	_requestCondition.notify_all();
+}
+
+void GraniteSlicePrefetch::clear() {
+	std::unique_lock< std::mutex > lock(_lock);
+
+	cancel(lock);
+
+	_slots.clear();
+	_key.clear();
+}
+
+void GraniteSlicePrefetch::run() {
+	std::unique_lock< std::mutex > lock(_lock);
+	vtkSmartPointer< vtkPointData > sliceData;
+	int sliceBounds[6], center, sliceIndex, farthestIdx;
+	bool present, success;
+
+	while (true) {
+		_busy = false;
+		_idleCondition.notify_all();
+		_requestCondition.wait(lock, [this] { return _stopping || _pending; });
+		if (_stopping) break;
+
+		_pending = false;
+		_busy = true;
+		_servingGeneration = _generation;
+		center = _bounds[2 * _axis];
+
+		GraniteTrace::Span prefetchSpan("prefetchSlices", "read", _source->_fileName.c_str());
+		prefetchSpan.addArg("slice", center);
+
+		// Nearest neighbours first, alternating either side
+		for (int stepIdx = 0 ; stepIdx < 2 * _radius && _servingGeneration == _generation ; stepIdx++) {
+			sliceIndex = center + (stepIdx / 2 + 1) * (stepIdx % 2 == 0 ? 1 : -1);
+			if (sliceIndex < _levelBounds[2 * _axis] || sliceIndex > _levelBounds[2 * _axis + 1]) continue;
+
+			present = false;
+			for (int slotIdx = 0 ; slotIdx < _slots.size() ; slotIdx++) {
+				if (_slots[slotIdx].index == sliceIndex) present = true;
+			}
+			if (present) continue;
+
+			_fetchingIndex = sliceIndex;
+			memcpy(sliceBounds, _bounds, sizeof(sliceBounds));
+			sliceBounds[2 * _axis] = sliceIndex;
+			sliceBounds[2 * _axis + 1] = sliceIndex;
+
+			// Read without the lock, so the reader can take slices already prefetched meanwhile
+			lock.unlock();
+			sliceData = vtkSmartPointer< vtkPointData >::New();
+			_source->readFieldData(sliceData, false);
+			success = _source->readExtent(sliceBounds, sliceData);
+			lock.lock();
+
+			// Slices of cancelled requests are dropped (the new request may still want them, but from the start)
+			if (success && _servingGeneration == _generation) {
+				farthestIdx = 0;
+				for (int slotIdx = 0 ; slotIdx < _slots.size() ; slotIdx++) {
+					if (_slots[slotIdx].index < 0) {
+						farthestIdx = slotIdx;
+						break;
+					}
+					if (abs(_slots[slotIdx].index - center) > abs(_slots[farthestIdx].index - center)) farthestIdx = slotIdx;
+				}
+
+				_slots[farthestIdx].index = sliceIndex;
+				_slots[farthestIdx].data = sliceData;
+				_counters->increment(GraniteCounters::SlicesPrefetched);
+			}
+
+			_fetchingIndex = -1;
+			_idleCondition.notify_all();
+		}
+	}
+
+	lock.unlock();
+
+	// Attached to the JVM by its JNI calls
+	GraniteInterop::detachThread();
+}
+
+void GraniteSlicePrefetch::cancel(std::unique_lock< std::mutex > & passLock) {
+	_generation++;
+	_pending = false;
+	_idleCondition.wait(passLock, [this] { return !_busy; });
+}
+
+std::string GraniteSlicePrefetch::getKey(GraniteShared * passSource, int passAxis) {
+	return passSource->getCacheKey() + "|axis" + std::to_string(passAxis);
+}
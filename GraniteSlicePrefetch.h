@@ -0,0 +1,65 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteSlicePrefetch.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteSlicePrefetch_h
+#define __GraniteSlicePrefetch_h
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vtkPointData.h"
+#include "vtkSmartPointer.h"
+#include "GraniteShared.h"
+
+// Slices around the one last read along an axis, fetched on a background thread into a small ring of slots
+class GraniteSlicePrefetch {
+	public:
+		GraniteSlicePrefetch();
+		~GraniteSlicePrefetch(); // Stops the prefetch thread
+
+		bool take(GraniteShared * passSource, int passAxis, int passIndex, vtkPointData * retData); // Share a prefetched slice of the source's current file, level and fields (waiting if it is being read), false if not prefetched
+		void prefetch(GraniteShared * passSource, int * passBounds, int passAxis, int passRadius); // Fetch up to passRadius slices either side of the slice in passBounds, cancelling any earlier prefetch
+		void clear(); // Cancel prefetching and drop prefetched slices
+
+	private:
+		// Prefetched slice
+		struct Slot {
+			int index; // Position along the axis (-1 if empty)
+			vtkSmartPointer< vtkPointData > data;
+		};
+
+		void run(); // Serve prefetch requests until stopped
+		void cancel(std::unique_lock< std::mutex > & passLock); // Stop the read in progress and wait for the thread to idle
+		static std::string getKey(GraniteShared * passSource, int passAxis); // File, level, value type, fields and axis slots hold slices of
+
+		GraniteShared * _source; // Background data source (separate from the reader's, which stays on the pipeline thread)
+		std::string _key; // Key of the slots
+		std::vector< Slot > _slots; // Replaced farthest from the center first
+		int _bounds[6]; // Requested slice
+		int _levelBounds[6]; // Level extent neighbours are kept within
+		int _axis, _radius;
+		GraniteCounters * _counters; // Reader counters prefetched slices are counted against
+
+		std::thread _thread; // Started on first request
+		std::mutex _lock; // Guards requests, slots and the background data source while idle
+		std::condition_variable _requestCondition; // Signals new requests (or stop)
+		std::condition_variable _idleCondition; // Signals slices completed and the thread idling
+		std::atomic< unsigned long long > _generation; // Bumped per request, cancelling reads of older ones
+		unsigned long long _servingGeneration; // Request being served by the thread
+		int _fetchingIndex; // Slice being read (-1 for none)
+		bool _pending, _busy, _stopping;
+};
+
+#endif // __GraniteSlicePrefetch_h
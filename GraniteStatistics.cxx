@@ -0,0 +1,323 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteStatistics.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cfloat>
+
+#include "qstringlist.h"
+#include "GraniteStatistics.h"
+
+double GraniteStatistics::Summary::getMean() {
+	return (count > 0 ? sum / count : 0);
+}
+
+GraniteStatistics::GraniteStatistics() {
+	clear();
+}
+
+void GraniteStatistics::initialize(const std::vector< std::string > & passFieldNames, int * passDimensions, int passDivisions, int passBins) {
+	int blockCount;
+
+	_fieldNames = passFieldNames;
+	_divisions = (passDivisions > 0 ? passDivisions : 1);
+	_bins = passBins;
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		_dimensions[dimIdx] = passDimensions[dimIdx];
+	}
+
+	// Whole dataset summaries carry histograms, block summaries do not
+	_fields.resize(_fieldNames.size());
+	for (int fieldIdx = 0 ; fieldIdx < _fields.size() ; fieldIdx++) {
+		resetSummary(&_fields[fieldIdx], _bins);
+	}
+
+	blockCount = _divisions * _divisions * _divisions;
+	_blocks.resize(blockCount * _fieldNames.size());
+	for (int blockIdx = 0 ; blockIdx < _blocks.size() ; blockIdx++) {
+		resetSummary(&_blocks[blockIdx], 0);
+	}
+
+	partition();
+}
+
+void GraniteStatistics::clear() {
+	_fieldNames.clear();
+	_fields.clear();
+	_blocks.clear();
+	_dimensions[0] = _dimensions[1] = _dimensions[2] = 0;
+	_divisions = 1;
+	_bins = 0;
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		_firstBlocks[dimIdx].clear();
+		_lastBlocks[dimIdx].clear();
+	}
+}
+
+bool GraniteStatistics::isEmpty() {
+	return _fields.empty();
+}
+
+void GraniteStatistics::addValue(int passField, int passX, int passY, int passZ, double passValue) {
+	// NaN never contributes to ranges
+	if (passValue != passValue) return;
+
+	// Whole dataset, then every block holding the point (up to two per axis)
+	addSummaryValue(&_fields[passField], passValue);
+	if (_blocks.empty() || _firstBlocks[0][passX] < 0 || _firstBlocks[1][passY] < 0 || _firstBlocks[2][passZ] < 0) return;
+
+	for (int zIdx = _firstBlocks[2][passZ] ; zIdx <= _lastBlocks[2][passZ] ; zIdx++) {
+		for (int yIdx = _firstBlocks[1][passY] ; yIdx <= _lastBlocks[1][passY] ; yIdx++) {
+			for (int xIdx = _firstBlocks[0][passX] ; xIdx <= _lastBlocks[0][passX] ; xIdx++) {
+				addSummaryValue(&_blocks[((zIdx * _divisions + yIdx) * _divisions + xIdx) * _fieldNames.size() + passField], passValue);
+			}
+		}
+	}
+}
+
+void GraniteStatistics::addHistogramValue(int passField, double passValue) {
+	Summary * currentSummary;
+	int binIdx;
+
+	currentSummary = &_fields[passField];
+	if (currentSummary->histogram.empty() || currentSummary->count == 0 || passValue != passValue) return;
+
+	// Uniform bins across [minimum, maximum], with maximum falling in the last bin
+	if (currentSummary->maximum > currentSummary->minimum) {
+		binIdx = (int) ((passValue - currentSummary->minimum) / (currentSummary->maximum - currentSummary->minimum) * _bins);
+		if (binIdx >= _bins) binIdx = _bins - 1;
+		if (binIdx < 0) binIdx = 0;
+	}
+	else {
+		binIdx = 0;
+	}
+
+	currentSummary->histogram[binIdx]++;
+}
+
+int GraniteStatistics::getFieldCount() {
+	return _fieldNames.size();
+}
+
+int GraniteStatistics::getFieldIndex(const std::string & passFieldName) {
+	for (int fieldIdx = 0 ; fieldIdx < _fieldNames.size() ; fieldIdx++) {
+		if (_fieldNames[fieldIdx] == passFieldName) return fieldIdx;
+	}
+
+	return -1;
+}
+
+std::string GraniteStatistics::getFieldName(int passField) {
+	return _fieldNames.at(passField);
+}
+
+int GraniteStatistics::getDivisions() {
+	return _divisions;
+}
+
+GraniteStatistics::Summary * GraniteStatistics::getField(int passField) {
+	if (passField < 0 || passField >= _fields.size()) return NULL;
+
+	return &_fields[passField];
+}
+
+GraniteStatistics::Summary * GraniteStatistics::getBlockField(int passBlock, int passField) {
+	if (passField < 0 || passField >= _fieldNames.size()) return NULL;
+	if (passBlock < 0 || passBlock * _fieldNames.size() + passField >= _blocks.size()) return NULL;
+
+	return &_blocks[passBlock * _fieldNames.size() + passField];
+}
+
+int * GraniteStatistics::getDimensions() {
+	return _dimensions;
+}
+
+bool GraniteStatistics::getRegionRange(int passField, int * passLower, int * passUpper, double * retRange) {
+	int blockLower[3], blockUpper[3];
+	Summary * currentSummary;
+	bool found;
+
+	if (_blocks.empty() || passField < 0 || passField >= _fieldNames.size()) return false;
+
+	// Blocks containing the region corners (regions reaching points outside every block are unknown)
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		if (_dimensions[dimIdx] <= 0) return false;
+		blockLower[dimIdx] = _firstBlocks[dimIdx][std::min(std::max(passLower[dimIdx], 0), _dimensions[dimIdx] - 1)];
+		blockUpper[dimIdx] = _lastBlocks[dimIdx][std::min(std::max(passUpper[dimIdx], 0), _dimensions[dimIdx] - 1)];
+		if (blockLower[dimIdx] < 0 || blockUpper[dimIdx] < 0) return false;
+	}
+
+	// Union of every overlapping block
+	found = false;
+	for (int zIdx = blockLower[2] ; zIdx <= blockUpper[2] ; zIdx++) {
+		for (int yIdx = blockLower[1] ; yIdx <= blockUpper[1] ; yIdx++) {
+			for (int xIdx = blockLower[0] ; xIdx <= blockUpper[0] ; xIdx++) {
+				currentSummary = getBlockField((zIdx * _divisions + yIdx) * _divisions + xIdx, passField);
+				if (currentSummary == NULL || currentSummary->count == 0) continue;
+
+				if (!found) {
+					retRange[0] = currentSummary->minimum;
+					retRange[1] = currentSummary->maximum;
+					found = true;
+				}
+
+				retRange[0] = std::min(retRange[0], currentSummary->minimum);
+				retRange[1] = std::max(retRange[1], currentSummary->maximum);
+			}
+		}
+	}
+
+	return found;
+}
+
+void GraniteStatistics::writeHeader(GraniteFormat::Header * retHeader) {
+	GraniteFormat::FieldStatistics currentStatistics;
+	Summary * currentSummary;
+
+	if (isEmpty()) return;
+
+	retHeader->statistics = true;
+	retHeader->divisions = _divisions;
+	retHeader->bins = _bins;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		retHeader->dimensions[dimIdx] = _dimensions[dimIdx];
+	}
+
+	// Whole dataset summary with histogram per field
+	for (int fieldIdx = 0 ; fieldIdx < _fields.size() ; fieldIdx++) {
+		currentSummary = &_fields[fieldIdx];
+
+		currentStatistics.fieldName = _fieldNames[fieldIdx];
+		currentStatistics.block = -1;
+		currentStatistics.minimum = currentSummary->minimum;
+		currentStatistics.maximum = currentSummary->maximum;
+		currentStatistics.mean = currentSummary->getMean();
+		currentStatistics.count = currentSummary->count;
+		currentStatistics.histogram = currentSummary->histogram;
+		retHeader->fieldStatistics.push_back(currentStatistics);
+	}
+
+	// Block summaries (skip blocks with no points, e.g. more divisions than points)
+	for (int blockIdx = 0 ; blockIdx < _blocks.size() ; blockIdx++) {
+		currentSummary = &_blocks[blockIdx];
+		if (currentSummary->count == 0) continue;
+
+		currentStatistics.fieldName = _fieldNames[blockIdx % _fieldNames.size()];
+		currentStatistics.block = (int) (blockIdx / _fieldNames.size());
+		currentStatistics.minimum = currentSummary->minimum;
+		currentStatistics.maximum = currentSummary->maximum;
+		currentStatistics.mean = currentSummary->getMean();
+		currentStatistics.count = currentSummary->count;
+		currentStatistics.histogram.clear();
+		retHeader->fieldStatistics.push_back(currentStatistics);
+	}
+}
+
+void GraniteStatistics::readXML(QXmlStreamReader * passStream) {
+	QXmlStreamReader::TokenType xmlToken;
+	QStringList histogramList;
+	Summary * currentSummary;
+	int fieldIdx;
+	bool blocksKnown;
+
+	clear();
+	_divisions = passStream->attributes().value("divisions").toString().toInt();
+	_bins = passStream->attributes().value("bins").toString().toInt();
+	_dimensions[0] = passStream->attributes().value("x").toString().toInt();
+	_dimensions[1] = passStream->attributes().value("y").toString().toInt();
+	_dimensions[2] = passStream->attributes().value("z").toString().toInt();
+	if (_divisions < 1) _divisions = 1;
+	partition();
+
+	// Blocks of older files were split differently from AMR blocks, so their ranges are dropped
+	blocksKnown = (passStream->attributes().value("blocks").toString() == "amr");
+
+	while (!passStream->atEnd()) {
+		xmlToken = passStream->readNext();
+
+		if (xmlToken == QXmlStreamReader::EndElement && passStream->name() == "CustomParaViewStatistics") break;
+		if (xmlToken != QXmlStreamReader::StartElement) continue;
+
+		// Field summaries always precede block summaries
+		if (passStream->name() == "FieldStatistics") {
+			_fieldNames.push_back(passStream->attributes().value("fieldName").toString().toStdString());
+			_fields.push_back(Summary());
+			currentSummary = &_fields.back();
+
+			histogramList = passStream->attributes().value("histogram").toString().split(" ", QString::SkipEmptyParts);
+			for (int binIdx = 0 ; binIdx < histogramList.size() ; binIdx++) {
+				currentSummary->histogram.push_back(histogramList[binIdx].toULongLong());
+			}
+		}
+		else if (passStream->name() == "BlockStatistics" && blocksKnown) {
+			if (_blocks.empty()) {
+				_blocks.resize(_divisions * _divisions * _divisions * _fieldNames.size());
+				for (int blockIdx = 0 ; blockIdx < _blocks.size() ; blockIdx++) resetSummary(&_blocks[blockIdx], 0);
+			}
+
+			fieldIdx = getFieldIndex(passStream->attributes().value("fieldName").toString().toStdString());
+			currentSummary = getBlockField(passStream->attributes().value("block").toString().toInt(), fieldIdx);
+			if (currentSummary == NULL) continue;
+		}
+		else {
+			continue;
+		}
+
+		currentSummary->minimum = passStream->attributes().value("min").toString().toDouble();
+		currentSummary->maximum = passStream->attributes().value("max").toString().toDouble();
+		currentSummary->count = passStream->attributes().value("count").toString().toULongLong();
+		currentSummary->sum = passStream->attributes().value("mean").toString().toDouble() * currentSummary->count;
+	}
+}
+
+void GraniteStatistics::resetSummary(Summary * retSummary, int passBins) {
+	retSummary->minimum = DBL_MAX;
+	retSummary->maximum = -DBL_MAX;
+	retSummary->sum = 0;
+	retSummary->count = 0;
+	retSummary->histogram.assign(passBins, 0);
+}
+
+void GraniteStatistics::addSummaryValue(Summary * retSummary, double passValue) {
+	if (passValue < retSummary->minimum) retSummary->minimum = passValue;
+	if (passValue > retSummary->maximum) retSummary->maximum = passValue;
+	retSummary->sum += passValue;
+	retSummary->count++;
+}
+
+void GraniteStatistics::getBlockExtent(int passPoints, int passDivisions, int passLocation, int * retLower, int * retUpper) {
+	int length;
+
+	// Even lengths, with upper bounds inclusive (neighbours share their boundary point) and blocks ending within a length of the axis end taking the remainder
+	length = passPoints / passDivisions;
+	*retLower = passLocation * length;
+	*retUpper = (passLocation + 1) * length;
+	if (passPoints - 1 - *retUpper < length) *retUpper = passPoints - 1;
+}
+
+void GraniteStatistics::partition() {
+	int lower, upper;
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		_firstBlocks[dimIdx].assign(std::max(_dimensions[dimIdx], 0), -1);
+		_lastBlocks[dimIdx].assign(std::max(_dimensions[dimIdx], 0), -1);
+
+		// Blocks in order, so the first holding a point is set once and the last overwritten
+		for (int locationIdx = 0 ; locationIdx < _divisions ; locationIdx++) {
+			getBlockExtent(_dimensions[dimIdx], _divisions, locationIdx, &lower, &upper);
+			for (int pointIdx = lower ; pointIdx <= std::min(upper, _dimensions[dimIdx] - 1) ; pointIdx++) {
+				if (_firstBlocks[dimIdx][pointIdx] < 0) _firstBlocks[dimIdx][pointIdx] = locationIdx;
+				_lastBlocks[dimIdx][pointIdx] = locationIdx;
+			}
+		}
+	}
+}
@@ -0,0 +1,73 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteStatistics.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteStatistics_h
+#define __GraniteStatistics_h
+
+#include <string>
+#include <vector>
+
+#include "qxmlstream.h"
+#include "GraniteFormat.h"
+
+class GraniteStatistics {
+	public:
+		// Running summary of one field over the whole dataset or one block
+		struct Summary {
+			double minimum;
+			double maximum;
+			double sum;
+			unsigned long long count;
+			std::vector< unsigned long long > histogram; // Only kept for whole dataset summaries
+
+			double getMean();
+		};
+
+		GraniteStatistics();
+
+		void initialize(const std::vector< std::string > & passFieldNames, int * passDimensions, int passDivisions, int passBins); // Reset for a new dataset
+		void clear(); // Remove all statistics
+		bool isEmpty();
+
+		// Accumulation (histogram needs the final range, so is a second pass)
+		void addValue(int passField, int passX, int passY, int passZ, double passValue); // Value of a point, counted in every block holding it
+		void addHistogramValue(int passField, double passValue);
+
+		// Queries
+		int getFieldCount();
+		int getFieldIndex(const std::string & passFieldName); // -1 if not present
+		std::string getFieldName(int passField);
+		int getDivisions();
+		Summary * getField(int passField);
+		Summary * getBlockField(int passBlock, int passField);
+		int * getDimensions(); // Points per axis of the data set described
+		bool getRegionRange(int passField, int * passLower, int * passUpper, double * retRange); // Union of ranges of blocks overlapping a point region (x, y, z)
+		static void getBlockExtent(int passPoints, int passDivisions, int passLocation, int * retLower, int * retUpper); // Points of one block along an axis, split as AMR blocks are
+
+		// XFDL serialization (CustomParaViewStatistics element)
+		void writeHeader(GraniteFormat::Header * retHeader); // Fill the statistics section of a header
+		void readXML(QXmlStreamReader * passStream); // Called with the stream positioned on the start element
+
+	private:
+		void resetSummary(Summary * retSummary, int passBins);
+		void addSummaryValue(Summary * retSummary, double passValue);
+		void partition(); // Blocks holding each point along each axis
+
+		std::vector< std::string > _fieldNames; // Granite field names ("Array.Component")
+		std::vector< Summary > _fields; // Summary per field
+		std::vector< Summary > _blocks; // Summary per block per field (block major)
+		int _dimensions[3]; // Points per axis
+		int _divisions; // Blocks per axis
+		std::vector< int > _firstBlocks[3], _lastBlocks[3]; // First and last block along each axis holding each point (-1 for none), as neighbouring blocks share their boundary point
+		int _bins; // Histogram bins per field
+};
+
+#endif // __GraniteStatistics_h
@@ -0,0 +1,682 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteStorage.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+// Memory mapping is only available on POSIX platforms
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "vtkByteSwap.h"
+#include "vtkDataArray.h"
+#include "vtkFloatArray.h"
+#include "GraniteStorage.h"
+#include "GraniteTrace.h"
+#include "vtkGraniteSettings.h"
+
+GraniteStorage::GraniteStorage() {
+	reset();
+}
+
+void GraniteStorage::reset() {
+	_native = false;
+	_byteOrder = ByteOrderDef::BigEndian;
+	_layout = LayoutDef::Interleaved;
+	_fileName = "";
+	_offset = 0;
+	_encodings.clear();
+	_fieldOffsets.clear();
+	_fields.clear();
+	_fieldCount = 0;
+}
+
+void GraniteStorage::setFormat(ByteOrderDef passByteOrder, LayoutDef passLayout, std::string passFileName, std::vector< Encoding > passEncodings) {
+	_native = true;
+	_byteOrder = passByteOrder;
+	_layout = passLayout;
+	_fileName = passFileName;
+	_offset = 0;
+	_encodings = passEncodings;
+	_fieldOffsets.clear();
+}
+
+void GraniteStorage::setOffset(long long passOffset) {
+	_offset = passOffset;
+}
+
+void GraniteStorage::setFieldOffsets(std::vector< long long > passOffsets) {
+	_fieldOffsets = passOffsets;
+}
+
+void GraniteStorage::setFields(std::vector< int > passFields, int passFieldCount) {
+	_fields = passFields;
+	_fieldCount = passFieldCount;
+}
+
+bool GraniteStorage::isNative() {
+	return _native;
+}
+
+bool GraniteStorage::isEncoded() {
+	for (int fieldIdx = 0 ; fieldIdx < _encodings.size() ; fieldIdx++) {
+		if (_encodings[fieldIdx].type != EncodingDef::Float32) return true;
+	}
+
+	return false;
+}
+
+GraniteStorage::ByteOrderDef GraniteStorage::getByteOrder() {
+	return _byteOrder;
+}
+
+GraniteStorage::LayoutDef GraniteStorage::getLayout() {
+	return _layout;
+}
+
+GraniteStorage::Encoding GraniteStorage::getEncoding(int passField) {
+	Encoding floatEncoding = { EncodingDef::Float32, 1.0, 0.0 };
+
+	if (passField < 0 || passField >= _encodings.size()) return floatEncoding;
+
+	return _encodings[passField];
+}
+
+bool GraniteStorage::copyFloatData(int * passBounds, int * passFullBounds, vtkDataSetAttributes * retData, GraniteCounters * passCounters, std::function< bool(double) > passProgress) {
+	GraniteIO * ioEngine;
+	std::vector< std::vector< char > > slabBuffers;
+	std::vector< GraniteIO::Request > slabRequests;
+	std::vector< vtkDataArray * > fieldArrays;
+	std::vector< int > fieldComponents;
+	vtkDataArray * currentArray;
+	EncodingDef currentType;
+	long long fullLength[3], pointCount, rowLength, slabPoints, rowOffset, currentData, recordSize, readSize;
+	int fileHandle, fieldCount, requestCount, queueDepth, sliceCount, currentSlot, currentRequest, fieldSize, dataType, storedField;
+	bool success, cancelled;
+
+	GraniteCounters::ScopedTimer readTimer(passCounters, GraniteCounters::TimeNativeRead);
+	GraniteTrace::Span readSpan("copyFloatData", "native", _fileName.c_str());
+
+	// Destination per field (Granite attributes are arrays, then components), floats or the field's own codes when kept quantized
+	for (int arrayIdx = 0 ; arrayIdx < retData->GetNumberOfArrays() ; arrayIdx++) {
+		currentArray = retData->GetArray(arrayIdx);
+
+		for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+			currentType = getEncoding(getStoredField(fieldArrays.size())).type;
+			dataType = currentArray->GetDataType();
+			if (dataType != VTK_FLOAT && !(dataType == VTK_UNSIGNED_CHAR && currentType == EncodingDef::UInt8) && !(dataType == VTK_UNSIGNED_SHORT && currentType == EncodingDef::UInt16)) return false;
+
+			fieldArrays.push_back(currentArray);
+			fieldComponents.push_back(compIdx);
+		}
+	}
+
+	fieldCount = fieldArrays.size();
+	if (fieldCount == 0) return true;
+
+	pointCount = 1;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		fullLength[dimIdx] = passFullBounds[2 * dimIdx + 1] - passFullBounds[2 * dimIdx] + 1;
+		pointCount *= fullLength[dimIdx];
+	}
+
+	ioEngine = GraniteIO::getInstance();
+	if ((fileHandle = ioEngine->openFile(_fileName)) < 0) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to open Granite binary " + _fileName).c_str());
+		return false;
+	}
+
+	// Each slab is the span of requested rows in one slice, read whole (whole records if interleaved, else one request per field plane read)
+	rowLength = passBounds[1] - passBounds[0] + 1;
+	slabPoints = (long long) (passBounds[3] - passBounds[2]) * fullLength[0] + rowLength;
+	recordSize = getRecordSize(getStoredCount(fieldCount));
+	requestCount = (_layout == LayoutDef::Interleaved ? 1 : fieldCount);
+
+	readSize = recordSize;
+	if (_layout == LayoutDef::Planar) {
+		readSize = 0;
+		for (int fieldIdx = 0 ; fieldIdx < fieldCount ; fieldIdx++) {
+			readSize += getEncodingSize(getEncoding(getStoredField(fieldIdx)).type);
+		}
+	}
+	sliceCount = passBounds[5] - passBounds[4] + 1;
+
+	// Double buffered at minimum, deeper queues keep more reads outstanding while converting
+	queueDepth = std::max(2, vtkGraniteSettings::GetInstance()->getIOQueueDepth());
+	queueDepth = std::min(queueDepth, sliceCount);
+	ioEngine->setWorkerCount(queueDepth);
+	slabBuffers.resize(queueDepth * requestCount);
+	slabRequests.resize(queueDepth * requestCount);
+
+	for (int slotIdx = 0 ; slotIdx < slabBuffers.size() ; slotIdx++) {
+		slabBuffers[slotIdx].resize(slabPoints * (_layout == LayoutDef::Interleaved ? recordSize : getEncodingSize(getEncoding(getStoredField(slotIdx % requestCount)).type)));
+	}
+	GraniteCounters::ScopedMemory bufferMemory(passCounters, GraniteCounters::MemoryBuffers, getBufferBytes(passBounds, passFullBounds, fieldCount));
+
+	// Prime queue
+	for (int sliceIdx = 0 ; sliceIdx < queueDepth ; sliceIdx++) {
+		submitSlab(fileHandle, passBounds, passFullBounds, passBounds[4] + sliceIdx, pointCount, fieldCount, slabPoints, &slabRequests[sliceIdx * requestCount], &slabBuffers[sliceIdx * requestCount]);
+	}
+
+	success = true;
+	cancelled = false;
+	currentData = 0;
+
+	for (int sliceIdx = 0 ; sliceIdx < sliceCount ; sliceIdx++) {
+		currentSlot = sliceIdx % queueDepth;
+
+		// Wait for slab, byte swap as needed
+		for (int requestIdx = 0 ; requestIdx < requestCount ; requestIdx++) {
+			currentRequest = currentSlot * requestCount + requestIdx;
+			if (ioEngine->wait(&slabRequests[currentRequest]) == false) success = false;
+		}
+
+		for (int fieldIdx = 0 ; success && fieldIdx < fieldCount ; fieldIdx++) {
+			storedField = getStoredField(fieldIdx);
+			fieldSize = getEncodingSize(getEncoding(storedField).type);
+			if (_layout == LayoutDef::Interleaved) swapValues(&slabBuffers[currentSlot][getFieldOffset(storedField, pointCount)], slabPoints, recordSize, fieldSize);
+			else swapValues(&slabBuffers[currentSlot * requestCount + fieldIdx][0], slabPoints, fieldSize, fieldSize);
+		}
+
+		// Decode rows into arrays while the following slabs are read
+		for (int yIdx = passBounds[2] ; success && yIdx <= passBounds[3] ; yIdx++) {
+			rowOffset = (yIdx - passBounds[2]) * fullLength[0];
+
+			for (int fieldIdx = 0 ; fieldIdx < fieldCount ; fieldIdx++) {
+				storedField = getStoredField(fieldIdx);
+
+				if (_layout == LayoutDef::Interleaved) {
+					decodeRow(&slabBuffers[currentSlot][rowOffset * recordSize + getFieldOffset(storedField, pointCount)], rowLength, recordSize, storedField, fieldArrays[fieldIdx], currentData, fieldComponents[fieldIdx]);
+				}
+				else {
+					fieldSize = getEncodingSize(getEncoding(storedField).type);
+					decodeRow(&slabBuffers[currentSlot * requestCount + fieldIdx][rowOffset * fieldSize], rowLength, fieldSize, storedField, fieldArrays[fieldIdx], currentData, fieldComponents[fieldIdx]);
+				}
+			}
+
+			currentData += rowLength;
+		}
+
+		passCounters->increment(GraniteCounters::SlicesFetched);
+
+		// Cancelled reads stop submitting, slabs already in flight are drained below
+		if (success && passProgress && !passProgress((sliceIdx + 1.0) / sliceCount)) {
+			passCounters->increment(GraniteCounters::ReadsCancelled);
+			cancelled = true;
+			break;
+		}
+
+		// Reuse slot for next outstanding slab
+		if (success && sliceIdx + queueDepth < sliceCount) {
+			submitSlab(fileHandle, passBounds, passFullBounds, passBounds[4] + sliceIdx + queueDepth, pointCount, fieldCount, slabPoints, &slabRequests[currentSlot * requestCount], &slabBuffers[currentSlot * requestCount]);
+		}
+	}
+
+	// Drain anything still outstanding after a failure (never submitted requests have no buffer)
+	for (int requestIdx = 0 ; requestIdx < slabRequests.size() ; requestIdx++) {
+		if (slabRequests[requestIdx].buffer != NULL) ioEngine->wait(&slabRequests[requestIdx]);
+	}
+
+	ioEngine->closeFile(fileHandle);
+	passCounters->increment(GraniteCounters::BytesTransferred, currentData * readSize);
+
+	if (!success) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to read Granite binary " + _fileName).c_str());
+	}
+
+	return (success && !cancelled);
+}
+
+void GraniteStorage::submitSlab(int passHandle, int * passBounds, int * passFullBounds, int passSlice, long long passPointCount, int passFieldCount, long long passSlabPoints, GraniteIO::Request * retRequests, std::vector< char > * retBuffers) {
+	long long slabStart;
+	int fieldSize, recordSize;
+
+	// First requested point of slice
+	slabStart = (((long long) passSlice - passFullBounds[4]) * (passFullBounds[3] - passFullBounds[2] + 1) + (passBounds[2] - passFullBounds[2])) * (passFullBounds[1] - passFullBounds[0] + 1) + (passBounds[0] - passFullBounds[0]);
+
+	if (_layout == LayoutDef::Interleaved) {
+		recordSize = getRecordSize(getStoredCount(passFieldCount));
+		GraniteIO::getInstance()->submit(&retRequests[0], passHandle, _offset + slabStart * recordSize, passSlabPoints * recordSize, &retBuffers[0][0]);
+	}
+	else {
+		// Planes of fields not read are never touched
+		for (int fieldIdx = 0 ; fieldIdx < passFieldCount ; fieldIdx++) {
+			fieldSize = getEncodingSize(getEncoding(getStoredField(fieldIdx)).type);
+			GraniteIO::getInstance()->submit(&retRequests[fieldIdx], passHandle, _offset + getFieldOffset(getStoredField(fieldIdx), passPointCount) + slabStart * fieldSize, passSlabPoints * fieldSize, &retBuffers[fieldIdx][0]);
+		}
+	}
+}
+
+void GraniteStorage::decodeRow(const char * passValues, long long passCount, long long passStride, int passField, vtkDataArray * retArray, long long passTuple, int passComponent) {
+	Encoding fieldEncoding;
+	unsigned char * byteCodes;
+	unsigned short * shortCodes, codeValue;
+	float * floatValues, scale, offset, missing;
+	int components;
+
+	fieldEncoding = getEncoding(passField);
+	components = retArray->GetNumberOfComponents();
+
+	// Kept codes are copied as stored
+	if (retArray->GetDataType() == VTK_UNSIGNED_CHAR) {
+		byteCodes = (unsigned char *) retArray->GetVoidPointer(0) + passTuple * components + passComponent;
+		for (long long pointIdx = 0 ; pointIdx < passCount ; pointIdx++) {
+			byteCodes[pointIdx * components] = (unsigned char) passValues[pointIdx * passStride];
+		}
+
+		return;
+	}
+
+	if (retArray->GetDataType() == VTK_UNSIGNED_SHORT) {
+		shortCodes = (unsigned short *) retArray->GetVoidPointer(0) + passTuple * components + passComponent;
+		for (long long pointIdx = 0 ; pointIdx < passCount ; pointIdx++) {
+			memcpy(&shortCodes[pointIdx * components], passValues + pointIdx * passStride, sizeof(unsigned short));
+		}
+
+		return;
+	}
+
+	floatValues = (float *) retArray->GetVoidPointer(0) + passTuple * components + passComponent;
+	scale = (float) fieldEncoding.scale;
+	offset = (float) fieldEncoding.offset;
+	missing = std::numeric_limits< float >::quiet_NaN();
+
+	// One branch free loop per encoding, so each vectorizes (top codes select NaN)
+	switch (fieldEncoding.type) {
+		case EncodingDef::UInt8:
+			for (long long pointIdx = 0 ; pointIdx < passCount ; pointIdx++) {
+				codeValue = (unsigned char) passValues[pointIdx * passStride];
+				floatValues[pointIdx * components] = (codeValue == 0xFF ? missing : codeValue * scale + offset);
+			}
+			break;
+
+		case EncodingDef::UInt16:
+			for (long long pointIdx = 0 ; pointIdx < passCount ; pointIdx++) {
+				memcpy(&codeValue, passValues + pointIdx * passStride, sizeof(codeValue));
+				floatValues[pointIdx * components] = (codeValue == 0xFFFF ? missing : codeValue * scale + offset);
+			}
+			break;
+
+		case EncodingDef::Float16:
+			for (long long pointIdx = 0 ; pointIdx < passCount ; pointIdx++) {
+				memcpy(&codeValue, passValues + pointIdx * passStride, sizeof(codeValue));
+				floatValues[pointIdx * components] = getHalfValue(codeValue);
+			}
+			break;
+
+		default:
+			// Contiguous floats into a single component array are copied whole
+			if (components == 1 && passStride == sizeof(float)) {
+				memcpy(floatValues, passValues, passCount * sizeof(float));
+				break;
+			}
+
+			for (long long pointIdx = 0 ; pointIdx < passCount ; pointIdx++) {
+				memcpy(&floatValues[pointIdx * components], passValues + pointIdx * passStride, sizeof(float));
+			}
+			break;
+	}
+}
+
+int GraniteStorage::getRecordSize(int passFieldCount) {
+	int recordSize;
+
+	recordSize = 0;
+	for (int fieldIdx = 0 ; fieldIdx < passFieldCount ; fieldIdx++) {
+		recordSize += getEncodingSize(getEncoding(fieldIdx).type);
+	}
+
+	return recordSize;
+}
+
+long long GraniteStorage::getFieldOffset(int passField, long long passPointCount) {
+	long long fieldOffset;
+
+	// Planes listed by the XFDL, otherwise preceding fields once per point (interleaved) or as whole planes (planar)
+	if (_layout == LayoutDef::Planar && passField < _fieldOffsets.size()) return _fieldOffsets[passField];
+
+	fieldOffset = getRecordSize(passField);
+	if (_layout == LayoutDef::Planar) fieldOffset *= passPointCount;
+
+	return fieldOffset;
+}
+
+int GraniteStorage::getStoredField(int passField) {
+	if (passField < 0 || passField >= _fields.size()) return passField;
+
+	return _fields[passField];
+}
+
+int GraniteStorage::getStoredCount(int passFieldCount) {
+	return std::max(passFieldCount, _fieldCount);
+}
+
+bool GraniteStorage::mapFloatData(int * passFullBounds, vtkDataSetAttributes * retData, GraniteCounters * passCounters) {
+#ifdef _WIN32
+	return false;
+#else
+	vtkDataArray * currentArray;
+	Mapping * currentMapping;
+	struct stat fileStat;
+	long long pointCount, mapStart, dataLength;
+	int fileHandle, fieldCount, fieldIdx;
+	char * mappedBytes, * mappedData;
+	float * fieldValues;
+
+	// Only host ordered float planes can be handed to VTK as they are
+	if (!_native || _byteOrder != getHostByteOrder() || _layout != LayoutDef::Planar || isEncoded()) return false;
+
+	GraniteTrace::Span mapSpan("mapFloatData", "native", _fileName.c_str());
+
+	pointCount = 1;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		pointCount *= passFullBounds[2 * dimIdx + 1] - passFullBounds[2 * dimIdx] + 1;
+	}
+
+	fieldCount = 0;
+	for (int arrayIdx = 0 ; arrayIdx < retData->GetNumberOfArrays() ; arrayIdx++) {
+		fieldCount += retData->GetArray(arrayIdx)->GetNumberOfComponents();
+	}
+
+	// Every stored plane is mapped, though only those of fields read are ever paged in
+	dataLength = pointCount * getStoredCount(fieldCount) * (long long) sizeof(float);
+	for (int readIdx = 0 ; readIdx < fieldCount ; readIdx++) {
+		dataLength = std::max(dataLength, getFieldOffset(getStoredField(readIdx), pointCount) + pointCount * (long long) sizeof(float));
+	}
+
+	// Map data from the page holding its start (private, so downstream writes never reach the file)
+	if ((fileHandle = open(_fileName.c_str(), O_RDONLY)) < 0) return false;
+	if (fstat(fileHandle, &fileStat) != 0 || fileStat.st_size < _offset + dataLength) {
+		close(fileHandle);
+		return false;
+	}
+
+	mapStart = _offset - _offset % sysconf(_SC_PAGESIZE);
+	mappedBytes = (char *) mmap(NULL, _offset - mapStart + dataLength, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileHandle, mapStart);
+	close(fileHandle);
+	if (mappedBytes == MAP_FAILED) return false;
+
+	mappedData = mappedBytes + (_offset - mapStart);
+
+	currentMapping = new Mapping;
+	currentMapping->address = mappedBytes;
+	currentMapping->length = _offset - mapStart + dataLength;
+	currentMapping->references = 0;
+
+	// Single component float arrays point straight into the mapping, others are gathered from it
+	fieldIdx = 0;
+	for (int arrayIdx = 0 ; arrayIdx < retData->GetNumberOfArrays() ; arrayIdx++) {
+		currentArray = retData->GetArray(arrayIdx);
+		fieldValues = (float *) (mappedData + getFieldOffset(getStoredField(fieldIdx), pointCount));
+
+		if (currentArray->GetNumberOfComponents() == 1 && vtkFloatArray::SafeDownCast(currentArray)) {
+			{
+				std::lock_guard< std::mutex > guard(_mappingLock);
+				_mappedArrays[fieldValues] = currentMapping;
+				currentMapping->references++;
+			}
+
+			// Free function is set after the array, as SetArray resets it to free()
+			vtkFloatArray::SafeDownCast(currentArray)->SetArray(fieldValues, pointCount, 0, vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+			vtkFloatArray::SafeDownCast(currentArray)->SetArrayFreeFunction(releaseArray);
+			passCounters->increment(GraniteCounters::BytesMapped, pointCount * sizeof(float));
+		}
+		else {
+			currentArray->SetNumberOfTuples(pointCount);
+			for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+				fieldValues = (float *) (mappedData + getFieldOffset(getStoredField(fieldIdx + compIdx), pointCount));
+				for (long long pointIdx = 0 ; pointIdx < pointCount ; pointIdx++) {
+					currentArray->SetComponent(pointIdx, compIdx, fieldValues[pointIdx]);
+				}
+			}
+			passCounters->increment(GraniteCounters::BytesTransferred, pointCount * currentArray->GetNumberOfComponents() * sizeof(float));
+		}
+
+		fieldIdx += currentArray->GetNumberOfComponents();
+	}
+
+	// No array kept a reference
+	std::lock_guard< std::mutex > guard(_mappingLock);
+	if (currentMapping->references == 0) {
+		munmap(currentMapping->address, currentMapping->length);
+		delete currentMapping;
+	}
+
+	return true;
+#endif
+}
+
+GraniteStorage::ByteOrderDef GraniteStorage::getHostByteOrder() {
+#ifdef VTK_WORDS_BIGENDIAN
+	return ByteOrderDef::BigEndian;
+#else
+	return ByteOrderDef::LittleEndian;
+#endif
+}
+
+long long GraniteStorage::getBufferBytes(int * passBounds, int * passFullBounds, int passFieldCount) {
+	long long slabPoints, pointSize;
+	int queueDepth;
+
+	// Queued slabs hold whole records (interleaved) or the planes read (planar)
+	slabPoints = (long long) (passBounds[3] - passBounds[2]) * (passFullBounds[1] - passFullBounds[0] + 1) + passBounds[1] - passBounds[0] + 1;
+	queueDepth = std::min(std::max(2, vtkGraniteSettings::GetInstance()->getIOQueueDepth()), passBounds[5] - passBounds[4] + 1);
+
+	pointSize = getRecordSize(getStoredCount(passFieldCount));
+	if (_layout == LayoutDef::Planar) {
+		pointSize = 0;
+		for (int fieldIdx = 0 ; fieldIdx < passFieldCount ; fieldIdx++) {
+			pointSize += getEncodingSize(getEncoding(getStoredField(fieldIdx)).type);
+		}
+	}
+
+	return queueDepth * slabPoints * pointSize;
+}
+
+const char * GraniteStorage::getByteOrderName(ByteOrderDef passByteOrder) {
+	static const char * byteOrderNames[ByteOrderDef::ByteOrderCount] = { "big", "little" };
+
+	return byteOrderNames[passByteOrder];
+}
+
+const char * GraniteStorage::getLayoutName(LayoutDef passLayout) {
+	static const char * layoutNames[LayoutDef::LayoutCount] = { "interleaved", "planar" };
+
+	return layoutNames[passLayout];
+}
+
+GraniteStorage::ByteOrderDef GraniteStorage::parseByteOrder(std::string passName) {
+	return (passName == getByteOrderName(ByteOrderDef::LittleEndian) ? ByteOrderDef::LittleEndian : ByteOrderDef::BigEndian);
+}
+
+GraniteStorage::LayoutDef GraniteStorage::parseLayout(std::string passName) {
+	return (passName == getLayoutName(LayoutDef::Planar) ? LayoutDef::Planar : LayoutDef::Interleaved);
+}
+
+GraniteStorage::Encoding GraniteStorage::makeEncoding(EncodingDef passType, double passMinimum, double passMaximum) {
+	Encoding retEncoding;
+	double maxCode;
+
+	retEncoding.type = passType;
+	retEncoding.scale = 1.0;
+	retEncoding.offset = 0.0;
+
+	// Codes below the top (reserved for NaN) span the range
+	if (passType == EncodingDef::UInt8 || passType == EncodingDef::UInt16) {
+		maxCode = (passType == EncodingDef::UInt8 ? 0xFF : 0xFFFF);
+		retEncoding.offset = passMinimum;
+		if (passMaximum > passMinimum) retEncoding.scale = (passMaximum - passMinimum) / (maxCode - 1);
+	}
+
+	return retEncoding;
+}
+
+int GraniteStorage::getEncodingSize(EncodingDef passType) {
+	static const int encodingSizes[EncodingDef::EncodingCount] = { sizeof(float), sizeof(unsigned char), sizeof(unsigned short), sizeof(unsigned short) };
+
+	return encodingSizes[passType];
+}
+
+const char * GraniteStorage::getEncodingName(EncodingDef passType) {
+	static const char * encodingNames[EncodingDef::EncodingCount] = { "float32", "uint8", "uint16", "float16" };
+
+	return encodingNames[passType];
+}
+
+GraniteStorage::EncodingDef GraniteStorage::parseEncoding(std::string passName) {
+	for (int typeIdx = 0 ; typeIdx < EncodingDef::EncodingCount ; typeIdx++) {
+		if (passName == getEncodingName((EncodingDef) typeIdx)) return (EncodingDef) typeIdx;
+	}
+
+	return EncodingDef::Float32;
+}
+
+void GraniteStorage::encodeValue(float passValue, const Encoding & passEncoding, char * retValue) {
+	unsigned short codeValue;
+	double maxCode;
+
+	switch (passEncoding.type) {
+		case EncodingDef::UInt8:
+		case EncodingDef::UInt16:
+			// Nearest code, clamped below the NaN code
+			maxCode = (passEncoding.type == EncodingDef::UInt8 ? 0xFF : 0xFFFF);
+			if (std::isnan(passValue)) codeValue = (unsigned short) maxCode;
+			else codeValue = (unsigned short) std::max(0.0, std::min(maxCode - 1, nearbyint((passValue - passEncoding.offset) / passEncoding.scale)));
+
+			if (passEncoding.type == EncodingDef::UInt8) *retValue = (char) codeValue;
+			else memcpy(retValue, &codeValue, sizeof(codeValue));
+			break;
+
+		case EncodingDef::Float16:
+			codeValue = getHalfBits(passValue);
+			memcpy(retValue, &codeValue, sizeof(codeValue));
+			break;
+
+		default:
+			memcpy(retValue, &passValue, sizeof(float));
+			break;
+	}
+}
+
+float GraniteStorage::decodeValue(const char * passValue, const Encoding & passEncoding) {
+	unsigned short codeValue;
+	float retValue;
+
+	switch (passEncoding.type) {
+		case EncodingDef::UInt8:
+			codeValue = (unsigned char) *passValue;
+			return (codeValue == 0xFF ? std::numeric_limits< float >::quiet_NaN() : (float) (codeValue * passEncoding.scale + passEncoding.offset));
+
+		case EncodingDef::UInt16:
+			memcpy(&codeValue, passValue, sizeof(codeValue));
+			return (codeValue == 0xFFFF ? std::numeric_limits< float >::quiet_NaN() : (float) (codeValue * passEncoding.scale + passEncoding.offset));
+
+		case EncodingDef::Float16:
+			memcpy(&codeValue, passValue, sizeof(codeValue));
+			return getHalfValue(codeValue);
+
+		default:
+			memcpy(&retValue, passValue, sizeof(float));
+			return retValue;
+	}
+}
+
+float GraniteStorage::getHalfValue(unsigned short passHalf) {
+	// Every half converted once, so decoding is a lookup
+	static const std::vector< float > halfTable = [] {
+		std::vector< float > retTable(0x10000);
+		int exponent, mantissa;
+		float currentValue;
+
+		for (int halfIdx = 0 ; halfIdx < retTable.size() ; halfIdx++) {
+			exponent = (halfIdx >> 10) & 0x1F;
+			mantissa = halfIdx & 0x3FF;
+
+			if (exponent == 0) currentValue = (float) ldexp((double) mantissa, -24);
+			else if (exponent == 0x1F) currentValue = (mantissa == 0 ? std::numeric_limits< float >::infinity() : std::numeric_limits< float >::quiet_NaN());
+			else currentValue = (float) ldexp((double) (mantissa | 0x400), exponent - 25);
+
+			retTable[halfIdx] = ((halfIdx & 0x8000) ? -currentValue : currentValue);
+		}
+
+		return retTable;
+	}();
+
+	return halfTable[passHalf];
+}
+
+unsigned short GraniteStorage::getHalfBits(float passValue) {
+	unsigned short signBits;
+	double absolute, fraction;
+	int exponent, mantissa;
+
+	signBits = (std::signbit(passValue) ? 0x8000 : 0);
+	absolute = fabs((double) passValue);
+
+	if (std::isnan(passValue)) return signBits | 0x7E00;
+	if (absolute >= 65520.0) return signBits | 0x7C00;
+
+	// Subnormal (rounding up into the smallest normal gives the same bits)
+	if (absolute < ldexp(1.0, -14)) return signBits | (unsigned short) nearbyint(absolute * ldexp(1.0, 24));
+
+	// Normal, rounded to nearest even
+	fraction = frexp(absolute, &exponent);
+	mantissa = (int) nearbyint((fraction * 2.0 - 1.0) * 1024.0);
+	exponent += 14;
+
+	if (mantissa == 1024) {
+		mantissa = 0;
+		exponent++;
+	}
+
+	return signBits | (unsigned short) ((exponent << 10) | mantissa);
+}
+
+void GraniteStorage::releaseArray(void * passArray) {
+#ifndef _WIN32
+	std::map< void *, Mapping * >::iterator mappingIter;
+
+	std::lock_guard< std::mutex > guard(_mappingLock);
+	if ((mappingIter = _mappedArrays.find(passArray)) == _mappedArrays.end()) return;
+
+	// Unmap once the last array pointing into the binary is released
+	if (--mappingIter->second->references == 0) {
+		munmap(mappingIter->second->address, mappingIter->second->length);
+		delete mappingIter->second;
+	}
+
+	_mappedArrays.erase(mappingIter);
+#endif
+}
+
+void GraniteStorage::swapValues(char * retValues, size_t passCount, long long passStride, int passSize) {
+	if (_byteOrder == getHostByteOrder() || passSize == 1) return;
+
+	// Packed values swap as a range, values within records one at a time
+	if (passStride == passSize) {
+		vtkByteSwap::SwapVoidRange(retValues, passCount, passSize);
+		return;
+	}
+
+	for (size_t valueIdx = 0 ; valueIdx < passCount ; valueIdx++) {
+		std::reverse(retValues + valueIdx * passStride, retValues + valueIdx * passStride + passSize);
+	}
+}
+
+std::mutex GraniteStorage::_mappingLock;
+std::map< void *, GraniteStorage::Mapping * > GraniteStorage::_mappedArrays;
@@ -0,0 +1,117 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteStorage.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteStorage_h
+#define __GraniteStorage_h
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vtkDataArray.h"
+#include "vtkDataSetAttributes.h"
+#include "GraniteCounters.h"
+#include "GraniteIO.h"
+
+class GraniteStorage {
+	public:
+		// Supported byte orders
+		enum ByteOrderDef { BigEndian,
+							LittleEndian,
+							ByteOrderCount };
+
+		// Supported value layouts
+		enum LayoutDef { Interleaved, // Record per point (Granite default)
+						 Planar, // Field per plane
+						 LayoutCount };
+
+		// Supported value encodings (native storage only, values are floats once read)
+		enum EncodingDef { Float32,
+						   UInt8, // Quantized to 8 bit codes with scale/offset
+						   UInt16, // Quantized to 16 bit codes with scale/offset
+						   Float16, // IEEE half precision
+						   EncodingCount };
+
+		// Stored encoding of one field (value = code * scale + offset, top code is NaN)
+		struct Encoding {
+			EncodingDef type;
+			double scale;
+			double offset;
+		};
+
+		GraniteStorage();
+
+		void reset(); // Return to Granite (JNI) storage
+		void setFormat(ByteOrderDef passByteOrder, LayoutDef passLayout, std::string passFileName, std::vector< Encoding > passEncodings = std::vector< Encoding >()); // Storage read directly by the plugin (encoding per field, float if empty)
+		void setOffset(long long passOffset); // Start of data within binary (level of a multiresolution container)
+		void setFieldOffsets(std::vector< long long > passOffsets); // Start of each field's plane within the data (planar, computed from encodings if empty)
+		void setFields(std::vector< int > passFields, int passFieldCount); // Stored fields read, in array component order, out of all passFieldCount stored (all if empty)
+		bool isNative(); // Binary read directly rather than through Granite
+		bool isEncoded(); // Any field stored other than as float
+		ByteOrderDef getByteOrder();
+		LayoutDef getLayout();
+		Encoding getEncoding(int passField);
+
+		// Reads of binary (bounds in {xLow, xHigh, ...} within full bounds)
+		bool copyFloatData(int * passBounds, int * passFullBounds, vtkDataSetAttributes * retData, GraniteCounters * passCounters, std::function< bool(double) > passProgress = nullptr); // Progress called per slab with fraction done (false cancels)
+		bool mapFloatData(int * passFullBounds, vtkDataSetAttributes * retData, GraniteCounters * passCounters); // Zero-copy where possible (full bounds only)
+		long long getBufferBytes(int * passBounds, int * passFullBounds, int passFieldCount); // Slab buffers copyFloatData holds while reading bounds
+
+		static ByteOrderDef getHostByteOrder();
+		static const char * getByteOrderName(ByteOrderDef passByteOrder);
+		static const char * getLayoutName(LayoutDef passLayout);
+		static ByteOrderDef parseByteOrder(std::string passName);
+		static LayoutDef parseLayout(std::string passName);
+
+		// Field encodings
+		static Encoding makeEncoding(EncodingDef passType, double passMinimum, double passMaximum); // Scale/offset covering range
+		static int getEncodingSize(EncodingDef passType); // Bytes per stored value
+		static const char * getEncodingName(EncodingDef passType);
+		static EncodingDef parseEncoding(std::string passName);
+		static void encodeValue(float passValue, const Encoding & passEncoding, char * retValue); // Host byte order
+		static float decodeValue(const char * passValue, const Encoding & passEncoding); // Host byte order
+		static float getHalfValue(unsigned short passHalf);
+		static unsigned short getHalfBits(float passValue);
+
+	private:
+		// Mapped binary shared by all arrays pointing into it
+		struct Mapping {
+			void * address;
+			size_t length;
+			int references;
+		};
+
+		static void releaseArray(void * passArray); // VTK free function for arrays pointing into a mapping
+		void swapValues(char * retValues, size_t passCount, long long passStride, int passSize); // Convert stored byte order to host
+		void decodeRow(const char * passValues, long long passCount, long long passStride, int passField, vtkDataArray * retArray, long long passTuple, int passComponent); // Stored values of one field into an array (floats or kept codes)
+		void submitSlab(int passHandle, int * passBounds, int * passFullBounds, int passSlice, long long passPointCount, int passFieldCount, long long passSlabPoints, GraniteIO::Request * retRequests, std::vector< char > * retBuffers); // Queue reads of one slice
+		int getRecordSize(int passFieldCount); // Bytes per point (of the first passFieldCount fields)
+		int getStoredField(int passField); // Stored field read into the passField'th array component
+		int getStoredCount(int passFieldCount); // Fields stored per point, when passFieldCount are read
+		long long getFieldOffset(int passField, long long passPointCount); // Byte offset of field within record (interleaved) or binary (planar)
+
+		bool _native; // Binary read directly rather than through Granite
+		ByteOrderDef _byteOrder; // Byte order of binary
+		LayoutDef _layout; // Layout of binary
+		std::string _fileName; // Binary file
+		long long _offset; // Start of data within binary
+		std::vector< long long > _fieldOffsets; // Start of each field's plane within the data (empty to compute)
+		std::vector< int > _fields; // Stored fields read, in array component order (empty for all)
+		int _fieldCount; // Fields stored per point (0 if unknown, i.e. all are read)
+		std::vector< Encoding > _encodings; // Stored encoding per field (empty if all float)
+
+		static std::mutex _mappingLock; // Arrays may be released from any thread
+		static std::map< void *, Mapping * > _mappedArrays; // Array pointer to owning mapping
+};
+
+#endif // __GraniteStorage_h
@@ -0,0 +1,172 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteTrace.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <cstdio>
+#include <map>
+#include <thread>
+
+// Windows makes use of process.h for getpid
+#ifdef _WIN32
+	#include <process.h>
+	#define getpid _getpid
+#else
+	#include <unistd.h>
+#endif
+
+#include "GraniteTrace.h"
+
+GraniteTrace::Span::Span(const char * passName, const char * passCategory, const char * passDetail) {
+	_active = GraniteTrace::isEnabled();
+	_argCount = 0;
+	if (!_active) return;
+
+	_name = passName;
+	_category = passCategory;
+	if (passDetail) _detail = passDetail;
+	_start = std::chrono::steady_clock::now();
+}
+
+GraniteTrace::Span::~Span() {
+	if (_active && GraniteTrace::isEnabled()) {
+		GraniteTrace::getInstance()->writeEvent(this, std::chrono::steady_clock::now());
+	}
+}
+
+void GraniteTrace::Span::addArg(const char * passKey, long long passValue) {
+	if (!_active || _argCount >= 2) return;
+
+	_argKeys[_argCount] = passKey;
+	_argValues[_argCount++] = passValue;
+}
+
+void GraniteTrace::configure(bool passEnabled, const char * passFileName) {
+	GraniteTrace * instance;
+
+	instance = getInstance();
+	std::lock_guard< std::mutex > guard(instance->_lock);
+
+	// Nothing to do if already in the requested state
+	if (passEnabled == _enabled && (!passEnabled || instance->_fileName == passFileName)) return;
+
+	// Close any existing trace (closing bracket is optional in the Chrome trace format, but keep files well formed)
+	if (instance->_fileStream.is_open()) {
+		instance->_fileStream << "\n]\n";
+		instance->_fileStream.close();
+	}
+
+	_enabled = false;
+	instance->_fileName = "";
+	if (!passEnabled || passFileName == NULL || *passFileName == '\0') return;
+
+	// Start new trace
+	instance->_fileStream.open(passFileName, std::ios::out | std::ios::trunc);
+	if (!instance->_fileStream.is_open()) return;
+
+	instance->_fileStream << "[";
+	instance->_fileName = passFileName;
+	instance->_firstEvent = true;
+	_enabled = true;
+}
+
+bool GraniteTrace::isEnabled() {
+	return _enabled;
+}
+
+void GraniteTrace::flush() {
+	GraniteTrace * instance;
+
+	if (!_enabled) return;
+
+	instance = getInstance();
+	std::lock_guard< std::mutex > guard(instance->_lock);
+	if (instance->_fileStream.is_open()) instance->_fileStream.flush();
+}
+
+GraniteTrace::GraniteTrace() {
+	_epoch = std::chrono::steady_clock::now();
+	_processID = getpid();
+	_firstEvent = true;
+}
+
+GraniteTrace::~GraniteTrace() {
+	if (_fileStream.is_open()) {
+		_fileStream << "\n]\n";
+		_fileStream.close();
+	}
+}
+
+GraniteTrace * GraniteTrace::getInstance() {
+	static GraniteTrace instance;
+
+	return &instance;
+}
+
+void GraniteTrace::writeEvent(Span * passSpan, std::chrono::steady_clock::time_point passEnd) {
+	static std::map< std::thread::id, int > threadIDs;
+	long long startUS, durationUS;
+	int threadID;
+
+	startUS = std::chrono::duration_cast< std::chrono::microseconds >(passSpan->_start - _epoch).count();
+	durationUS = std::chrono::duration_cast< std::chrono::microseconds >(passEnd - passSpan->_start).count();
+
+	std::lock_guard< std::mutex > guard(_lock);
+	if (!_fileStream.is_open()) return;
+
+	// Small sequential thread IDs read better in the trace viewer than native handles
+	if (threadIDs.find(std::this_thread::get_id()) == threadIDs.end()) {
+		threadID = threadIDs.size() + 1;
+		threadIDs[std::this_thread::get_id()] = threadID;
+	}
+	threadID = threadIDs[std::this_thread::get_id()];
+
+	// Complete ("X") event
+	_fileStream << (_firstEvent ? "\n" : ",\n");
+	_fileStream << "{\"name\":\"" << passSpan->_name << "\",\"cat\":\"" << passSpan->_category << "\",\"ph\":\"X\"";
+	_fileStream << ",\"ts\":" << startUS << ",\"dur\":" << durationUS << ",\"pid\":" << _processID << ",\"tid\":" << threadID;
+	_fileStream << ",\"args\":{";
+
+	if (!passSpan->_detail.empty()) {
+		_fileStream << "\"detail\":\"" << escape(passSpan->_detail) << "\"" << (passSpan->_argCount > 0 ? "," : "");
+	}
+
+	for (int argIdx = 0 ; argIdx < passSpan->_argCount ; argIdx++) {
+		_fileStream << (argIdx > 0 ? "," : "") << "\"" << passSpan->_argKeys[argIdx] << "\":" << passSpan->_argValues[argIdx];
+	}
+
+	_fileStream << "}}";
+	_firstEvent = false;
+}
+
+std::string GraniteTrace::escape(const std::string & passString) {
+	std::string retString;
+	char hexBuffer[8];
+
+	for (size_t charIdx = 0 ; charIdx < passString.length() ; charIdx++) {
+		switch (passString[charIdx]) {
+			case '"': retString += "\\\""; break;
+			case '\\': retString += "\\\\"; break;
+			case '\n': retString += "\\n"; break;
+			case '\t': retString += "\\t"; break;
+			default:
+				if ((unsigned char) passString[charIdx] < 0x20) {
+					snprintf(hexBuffer, sizeof(hexBuffer), "\\u%04x", passString[charIdx]);
+					retString += hexBuffer;
+				}
+				else {
+					retString += passString[charIdx];
+				}
+		}
+	}
+
+	return retString;
+}
+
+std::atomic< bool > GraniteTrace::_enabled(false);
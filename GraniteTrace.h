@@ -0,0 +1,65 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteTrace.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteTrace_h
+#define __GraniteTrace_h
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+class GraniteTrace {
+	public:
+		// Records a complete event for the lifetime of the object (no-op while tracing is disabled)
+		class Span {
+			friend class GraniteTrace;
+
+			public:
+				Span(const char * passName, const char * passCategory, const char * passDetail = NULL);
+				~Span();
+
+				void addArg(const char * passKey, long long passValue); // Attach up to two integer arguments
+
+			private:
+				bool _active;
+				const char * _name;
+				const char * _category;
+				std::string _detail;
+				const char * _argKeys[2];
+				long long _argValues[2];
+				int _argCount;
+				std::chrono::steady_clock::time_point _start;
+		};
+
+		static void configure(bool passEnabled, const char * passFileName); // Start or stop writing trace file
+		static bool isEnabled();
+		static void flush(); // Push buffered events to disk
+
+	private:
+		GraniteTrace();
+		~GraniteTrace();
+
+		static GraniteTrace * getInstance();
+		void writeEvent(Span * passSpan, std::chrono::steady_clock::time_point passEnd); // Append Chrome trace "X" event
+		static std::string escape(const std::string & passString); // JSON string escaping
+
+		static std::atomic< bool > _enabled; // Checked on every span, so kept outside the lock
+		std::mutex _lock; // Serializes writes from reader/writer threads
+		std::ofstream _fileStream; // Open trace file
+		std::string _fileName; // Current trace file name
+		std::chrono::steady_clock::time_point _epoch; // Timestamp origin for the trace
+		int _processID;
+		bool _firstEvent;
+};
+
+#endif // __GraniteTrace_h
@@ -0,0 +1,614 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteWorkerPool.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+
+#include "vtkDataArray.h"
+#include "vtkFloatArray.h"
+#include "vtkGraniteSettings.h"
+#include "GraniteTrace.h"
+#include "GraniteWorkerPool.h"
+
+// Worker processes use POSIX process, socket and shared memory APIs (unavailable on Windows)
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <signal.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/socket.h>
+	#include <sys/wait.h>
+#endif
+
+// Writes to a worker that has exited fail rather than raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+	#define GRANITE_SEND_FLAGS MSG_NOSIGNAL
+#else
+	#define GRANITE_SEND_FLAGS 0
+#endif
+
+GraniteWorkerPool * GraniteWorkerPool::getInstance() {
+	static GraniteWorkerPool instance;
+
+	return &instance;
+}
+
+bool GraniteWorkerPool::isEnabled() {
+#ifdef _WIN32
+	return false;
+#else
+	return (vtkGraniteSettings::GetInstance()->getWorkerProcesses() > 0);
+#endif
+}
+
+bool GraniteWorkerPool::openDataSource(std::string passFileName, Metadata * retMetadata, std::string * retError) {
+	std::vector< Worker * > openWorkers;
+	std::string replyPayload;
+	Command openCommand;
+	Reply openReply;
+	bool success;
+
+	GraniteTrace::Span openSpan("workerOpen", "worker", passFileName.c_str());
+
+	if ((openWorkers = acquire(1)).empty()) {
+		*retError = "Unable to start Granite worker process " + std::string(vtkGraniteSettings::GetInstance()->getWorkerFileName());
+		vtkOutputWindowDisplayErrorText(("ERROR: " + *retError).c_str());
+		return false;
+	}
+
+	memset(&openCommand, 0, sizeof(openCommand));
+	openCommand.type = CommandDef::CommandOpen;
+
+	// Workers that exit mid-request are stopped and replaced on the next request
+	success = (sendCommand(openWorkers[0], openCommand, passFileName, "", std::vector< Field >()) && receiveReply(openWorkers[0], &openReply, &replyPayload));
+	release(openWorkers, std::vector< bool >(1, !success));
+
+	if (success == false) {
+		*retError = "Granite worker process exited while opening " + passFileName;
+		vtkOutputWindowDisplayErrorText(("ERROR: " + *retError).c_str());
+		return false;
+	}
+
+	if (openReply.type == ReplyDef::ReplyError) {
+		*retError = replyPayload;
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to open Granite data source " + passFileName + " (" + replyPayload + ")").c_str());
+		return false;
+	}
+
+	return unpackMetadata(replyPayload, retMetadata);
+}
+
+bool GraniteWorkerPool::copyFloatData(std::string passFileName, int passLevel, int * passBounds, int passAttributeCount, std::vector< int > passFields, vtkDataSetAttributes * retData, GraniteCounters * passCounters, std::function< bool(double) > passProgress, std::string * retError) {
+#ifdef _WIN32
+	return false;
+#else
+	std::vector< Worker * > readWorkers;
+	std::vector< Field > segmentFields;
+	std::vector< long long > arrayOffsets;
+	std::vector< int > slicesDone;
+	std::vector< bool > workersPending, workersFailed;
+	std::vector< struct pollfd > pollHandles;
+	std::string segmentName, replyPayload;
+	vtkDataArray * currentArray;
+	Command readCommand;
+	Reply readReply;
+	SegmentHeader * segmentHeader;
+	Mapping * currentMapping;
+	char * segmentBytes;
+	float * arrayValues;
+	long long pointCount, slicePoints, segmentLength, pageSize;
+	int sliceCount, workerSlices, firstSlice, pendingCount, fieldIdx, segmentHandle;
+	bool success, cancelled;
+
+	GraniteTrace::Span readSpan("workerRead", "worker", passFileName.c_str());
+	readSpan.addArg("level", passLevel);
+
+	slicePoints = (long long) (passBounds[1] - passBounds[0] + 1) * (passBounds[3] - passBounds[2] + 1);
+	sliceCount = passBounds[5] - passBounds[4] + 1;
+	pointCount = slicePoints * sliceCount;
+	pageSize = sysconf(_SC_PAGESIZE);
+
+	// Header page, then one page aligned region per array laid out as VTK stores it
+	segmentLength = pageSize;
+	fieldIdx = 0;
+	for (int arrayIdx = 0 ; arrayIdx < retData->GetNumberOfArrays() ; arrayIdx++) {
+		currentArray = retData->GetArray(arrayIdx);
+		arrayOffsets.push_back(segmentLength);
+
+		for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+			segmentFields.push_back(Field());
+			segmentFields.back().attribute = (passFields.empty() ? fieldIdx : passFields[fieldIdx]);
+			segmentFields.back().components = currentArray->GetNumberOfComponents();
+			segmentFields.back().component = compIdx;
+			segmentFields.back().offset = segmentLength;
+			fieldIdx++;
+		}
+
+		segmentLength += (pointCount * currentArray->GetNumberOfComponents() * (long long) sizeof(float) + pageSize - 1) / pageSize * pageSize;
+	}
+
+	GraniteCounters::ScopedMemory segmentMemory(passCounters, GraniteCounters::MemoryBuffers, segmentLength);
+
+	// Create segment (unlinked once read, so it lives on only as long as the arrays using it)
+	{
+		std::lock_guard< std::mutex > guard(_poolLock);
+		segmentName = "/granite-" + std::to_string(getpid()) + "-" + std::to_string(_segmentCount++);
+	}
+
+	if ((segmentHandle = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)) < 0) {
+		*retError = "Unable to create shared memory segment " + segmentName + " (" + strerror(errno) + ")";
+		vtkOutputWindowDisplayErrorText(("ERROR: " + *retError).c_str());
+		return false;
+	}
+
+	segmentBytes = (char *) MAP_FAILED;
+	if (ftruncate(segmentHandle, segmentLength) == 0) segmentBytes = (char *) mmap(NULL, segmentLength, PROT_READ | PROT_WRITE, MAP_SHARED, segmentHandle, 0);
+	close(segmentHandle);
+
+	if (segmentBytes == MAP_FAILED) {
+		shm_unlink(segmentName.c_str());
+		*retError = "Unable to map shared memory segment " + segmentName + " (" + strerror(errno) + ")";
+		vtkOutputWindowDisplayErrorText(("ERROR: " + *retError).c_str());
+		return false;
+	}
+
+	segmentHeader = (SegmentHeader *) segmentBytes;
+	segmentHeader->cancelled = 0;
+
+	// Split slices into contiguous ranges, one per idle worker
+	if ((readWorkers = acquire(std::min(sliceCount, vtkGraniteSettings::GetInstance()->getWorkerProcesses()))).empty()) {
+		munmap(segmentBytes, segmentLength);
+		shm_unlink(segmentName.c_str());
+		*retError = "Unable to start Granite worker process " + std::string(vtkGraniteSettings::GetInstance()->getWorkerFileName());
+		vtkOutputWindowDisplayErrorText(("ERROR: " + *retError).c_str());
+		return false;
+	}
+
+	memset(&readCommand, 0, sizeof(readCommand));
+	readCommand.type = CommandDef::CommandRead;
+	readCommand.level = passLevel;
+	readCommand.attributeCount = passAttributeCount;
+	memcpy(readCommand.bounds, passBounds, sizeof(readCommand.bounds));
+
+	slicesDone.assign(readWorkers.size(), 0);
+	workersPending.assign(readWorkers.size(), false);
+	workersFailed.assign(readWorkers.size(), false);
+	pendingCount = 0;
+	firstSlice = 0;
+	success = true;
+	cancelled = false;
+
+	for (int workerIdx = 0 ; workerIdx < readWorkers.size() ; workerIdx++) {
+		workerSlices = sliceCount / readWorkers.size() + (workerIdx < sliceCount % readWorkers.size() ? 1 : 0);
+		readCommand.bounds[4] = passBounds[4] + firstSlice;
+		readCommand.bounds[5] = readCommand.bounds[4] + workerSlices - 1;
+		readCommand.segmentSlice = firstSlice;
+		firstSlice += workerSlices;
+
+		if (sendCommand(readWorkers[workerIdx], readCommand, passFileName, segmentName, segmentFields)) {
+			workersPending[workerIdx] = true;
+			pendingCount++;
+		}
+		else {
+			workersFailed[workerIdx] = true;
+			success = false;
+		}
+	}
+
+	passCounters->increment(GraniteCounters::WorkerRequests, pendingCount);
+
+	// Gather progress until every worker has finished its range (or stopped, once cancelled)
+	while (pendingCount > 0) {
+		pollHandles.clear();
+		for (int workerIdx = 0 ; workerIdx < readWorkers.size() ; workerIdx++) {
+			pollHandles.push_back(pollfd());
+			pollHandles.back().fd = (workersPending[workerIdx] ? readWorkers[workerIdx]->handle : -1);
+			pollHandles.back().events = POLLIN;
+			pollHandles.back().revents = 0;
+		}
+
+		if (poll(&pollHandles[0], pollHandles.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+
+		for (int workerIdx = 0 ; workerIdx < readWorkers.size() ; workerIdx++) {
+			if (!workersPending[workerIdx] || pollHandles[workerIdx].revents == 0) continue;
+
+			if (receiveReply(readWorkers[workerIdx], &readReply, &replyPayload) == false) {
+				*retError = "Granite worker process exited while reading " + passFileName;
+				workersFailed[workerIdx] = true;
+				readReply.type = ReplyDef::ReplyError;
+				replyPayload = *retError;
+			}
+
+			switch (readReply.type) {
+				case ReplyDef::ReplyProgress:
+					slicesDone[workerIdx] = readReply.slices;
+
+					// Workers check the header between slices
+					if (!cancelled && passProgress && !passProgress((double) std::accumulate(slicesDone.begin(), slicesDone.end(), 0) / sliceCount)) {
+						segmentHeader->cancelled = 1;
+						cancelled = true;
+					}
+					break;
+
+				case ReplyDef::ReplyError:
+					*retError = replyPayload;
+					vtkOutputWindowDisplayErrorText(("ERROR: " + replyPayload).c_str());
+					success = false;
+					workersPending[workerIdx] = false;
+					pendingCount--;
+					break;
+
+				default:
+					workersPending[workerIdx] = false;
+					pendingCount--;
+					break;
+			}
+		}
+	}
+
+	// Workers still reading (if polling failed) would answer the next request out of turn
+	for (int workerIdx = 0 ; workerIdx < readWorkers.size() ; workerIdx++) {
+		if (workersPending[workerIdx]) workersFailed[workerIdx] = true;
+	}
+
+	release(readWorkers, workersFailed);
+	shm_unlink(segmentName.c_str());
+
+	if (cancelled) passCounters->increment(GraniteCounters::ReadsCancelled);
+	if (!success || cancelled || pendingCount > 0) {
+		munmap(segmentBytes, segmentLength);
+		return false;
+	}
+
+	passCounters->increment(GraniteCounters::BytesTransferred, pointCount * segmentFields.size() * sizeof(float));
+	passCounters->increment(GraniteCounters::SlicesFetched, sliceCount);
+
+	currentMapping = new Mapping;
+	currentMapping->address = segmentBytes;
+	currentMapping->length = segmentLength;
+	currentMapping->references = 0;
+
+	// Float arrays sized for the bounds adopt their region as is, others are copied from it
+	for (int arrayIdx = 0 ; arrayIdx < retData->GetNumberOfArrays() ; arrayIdx++) {
+		currentArray = retData->GetArray(arrayIdx);
+		arrayValues = (float *) (segmentBytes + arrayOffsets[arrayIdx]);
+
+		if (vtkFloatArray::SafeDownCast(currentArray) && currentArray->GetNumberOfTuples() == pointCount) {
+			{
+				std::lock_guard< std::mutex > guard(_mappingLock);
+				_mappedArrays[arrayValues] = currentMapping;
+				currentMapping->references++;
+			}
+
+			// Free function is set after the array, as SetArray resets it to free()
+			vtkFloatArray::SafeDownCast(currentArray)->SetArray(arrayValues, pointCount * currentArray->GetNumberOfComponents(), 0, vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+			vtkFloatArray::SafeDownCast(currentArray)->SetArrayFreeFunction(releaseArray);
+		}
+		else {
+			currentArray->SetNumberOfTuples(pointCount);
+			for (long long valueIdx = 0 ; valueIdx < pointCount * currentArray->GetNumberOfComponents() ; valueIdx++) {
+				currentArray->SetComponent(valueIdx / currentArray->GetNumberOfComponents(), valueIdx % currentArray->GetNumberOfComponents(), arrayValues[valueIdx]);
+			}
+		}
+	}
+
+	// No array kept a reference
+	std::lock_guard< std::mutex > guard(_mappingLock);
+	if (currentMapping->references == 0) {
+		munmap(currentMapping->address, currentMapping->length);
+		delete currentMapping;
+	}
+
+	return true;
+#endif
+}
+
+bool GraniteWorkerPool::readFully(int passHandle, void * retBuffer, size_t passLength) {
+#ifdef _WIN32
+	return false;
+#else
+	ssize_t readLength;
+
+	while (passLength > 0) {
+		if ((readLength = recv(passHandle, retBuffer, passLength, 0)) <= 0) {
+			if (readLength < 0 && errno == EINTR) continue;
+			return false;
+		}
+
+		retBuffer = (char *) retBuffer + readLength;
+		passLength -= readLength;
+	}
+
+	return true;
+#endif
+}
+
+bool GraniteWorkerPool::writeFully(int passHandle, const void * passBuffer, size_t passLength) {
+#ifdef _WIN32
+	return false;
+#else
+	ssize_t writeLength;
+
+	while (passLength > 0) {
+		if ((writeLength = send(passHandle, passBuffer, passLength, GRANITE_SEND_FLAGS)) < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+
+		passBuffer = (const char *) passBuffer + writeLength;
+		passLength -= writeLength;
+	}
+
+	return true;
+#endif
+}
+
+std::string GraniteWorkerPool::packMetadata(const Metadata & passMetadata) {
+	std::vector< int > packedValues;
+	std::string retBuffer;
+
+	// Counts and bounds as ints, then names (each preceded by its length)
+	packedValues.push_back(passMetadata.multiresolution);
+	packedValues.push_back(passMetadata.dimensions);
+	packedValues.push_back(passMetadata.bounds.size());
+	for (int levelIdx = 0 ; levelIdx < passMetadata.bounds.size() ; levelIdx++) {
+		packedValues.insert(packedValues.end(), passMetadata.bounds[levelIdx].begin(), passMetadata.bounds[levelIdx].begin() + 6);
+	}
+	packedValues.push_back(passMetadata.attributeNames.size());
+
+	retBuffer.assign((const char *) &packedValues[0], packedValues.size() * sizeof(int));
+	for (int attrIdx = 0 ; attrIdx < passMetadata.attributeNames.size() ; attrIdx++) {
+		packedValues.assign(1, passMetadata.attributeNames[attrIdx].size());
+		retBuffer.append((const char *) &packedValues[0], sizeof(int));
+		retBuffer.append(passMetadata.attributeNames[attrIdx]);
+	}
+
+	return retBuffer;
+}
+
+bool GraniteWorkerPool::unpackMetadata(const std::string & passBuffer, Metadata * retMetadata) {
+	size_t bufferPos;
+	int multiresolution, levelCount, attributeCount, nameLength;
+	std::function< bool(int *) > readInt;
+
+	bufferPos = 0;
+	readInt = [&](int * retValue) {
+		if (bufferPos + sizeof(int) > passBuffer.size()) return false;
+		memcpy(retValue, passBuffer.data() + bufferPos, sizeof(int));
+		bufferPos += sizeof(int);
+
+		return true;
+	};
+
+	retMetadata->bounds.clear();
+	retMetadata->attributeNames.clear();
+
+	if (!readInt(&multiresolution) || !readInt(&retMetadata->dimensions) || !readInt(&levelCount)) return false;
+	retMetadata->multiresolution = (multiresolution != 0);
+
+	for (int levelIdx = 0 ; levelIdx < levelCount ; levelIdx++) {
+		retMetadata->bounds.push_back(std::vector< int >(6, 0));
+		for (int boundIdx = 0 ; boundIdx < 6 ; boundIdx++) {
+			if (!readInt(&retMetadata->bounds.back()[boundIdx])) return false;
+		}
+	}
+
+	if (!readInt(&attributeCount)) return false;
+	for (int attrIdx = 0 ; attrIdx < attributeCount ; attrIdx++) {
+		if (!readInt(&nameLength) || nameLength < 0 || bufferPos + nameLength > passBuffer.size()) return false;
+		retMetadata->attributeNames.push_back(passBuffer.substr(bufferPos, nameLength));
+		bufferPos += nameLength;
+	}
+
+	return true;
+}
+
+GraniteWorkerPool::GraniteWorkerPool() {
+	_segmentCount = 0;
+}
+
+GraniteWorkerPool::~GraniteWorkerPool() {
+	for (int workerIdx = 0 ; workerIdx < _workers.size() ; workerIdx++) {
+		stopWorker(_workers[workerIdx], false);
+	}
+}
+
+std::vector< GraniteWorkerPool::Worker * > GraniteWorkerPool::acquire(int passCount) {
+	std::vector< Worker * > retWorkers;
+	std::string configuration;
+	Worker * newWorker;
+	int workerCount, idleCount;
+
+	std::unique_lock< std::mutex > lock(_poolLock);
+
+	configuration = getConfiguration();
+	workerCount = std::max(1, vtkGraniteSettings::GetInstance()->getWorkerProcesses());
+	passCount = std::max(1, passCount);
+
+	while (true) {
+		// Idle workers started with other settings, or beyond the configured count, are stopped
+		for (int workerIdx = _workers.size() - 1 ; workerIdx >= 0 ; workerIdx--) {
+			if (_workers[workerIdx]->busy || (_workers[workerIdx]->configuration == configuration && _workers.size() <= workerCount)) continue;
+
+			stopWorker(_workers[workerIdx], false);
+			_workers.erase(_workers.begin() + workerIdx);
+		}
+
+		idleCount = 0;
+		for (int workerIdx = 0 ; workerIdx < _workers.size() ; workerIdx++) {
+			if (!_workers[workerIdx]->busy) idleCount++;
+		}
+
+		// Start workers (up to the configured count) for as much of the request as possible
+		while (idleCount < passCount && _workers.size() < workerCount) {
+			if ((newWorker = startWorker(configuration)) == NULL) break;
+
+			_workers.push_back(newWorker);
+			idleCount++;
+		}
+
+		if (idleCount > 0) break;
+		if (_workers.empty()) return retWorkers;
+
+		_idleCondition.wait(lock);
+	}
+
+	for (int workerIdx = 0 ; workerIdx < _workers.size() && retWorkers.size() < passCount ; workerIdx++) {
+		if (_workers[workerIdx]->busy) continue;
+
+		_workers[workerIdx]->busy = true;
+		retWorkers.push_back(_workers[workerIdx]);
+	}
+
+	return retWorkers;
+}
+
+void GraniteWorkerPool::release(std::vector< Worker * > passWorkers, std::vector< bool > passFailed) {
+	std::lock_guard< std::mutex > guard(_poolLock);
+
+	for (int workerIdx = 0 ; workerIdx < passWorkers.size() ; workerIdx++) {
+		passWorkers[workerIdx]->busy = false;
+		if (passFailed[workerIdx] == false) continue;
+
+		_workers.erase(std::find(_workers.begin(), _workers.end(), passWorkers[workerIdx]));
+		stopWorker(passWorkers[workerIdx], true);
+	}
+
+	_idleCondition.notify_all();
+}
+
+GraniteWorkerPool::Worker * GraniteWorkerPool::startWorker(std::string passConfiguration) {
+#ifdef _WIN32
+	return NULL;
+#else
+	std::string workerFileName, graniteFileName, javaArguments;
+	std::vector< char * > workerArguments;
+	Worker * retWorker;
+	int workerHandles[2];
+	int processID, optionValue;
+
+	// Arguments are prepared before forking, as only async-signal-safe calls may follow it
+	workerFileName = vtkGraniteSettings::GetInstance()->getWorkerFileName();
+	graniteFileName = vtkGraniteSettings::GetInstance()->getGraniteFileName();
+	javaArguments = vtkGraniteSettings::GetInstance()->getJavaArguments();
+	workerArguments.push_back(&workerFileName[0]);
+	workerArguments.push_back(&graniteFileName[0]);
+	workerArguments.push_back(&javaArguments[0]);
+	workerArguments.push_back(NULL);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, workerHandles) != 0) return NULL;
+	fcntl(workerHandles[0], F_SETFD, FD_CLOEXEC);
+	fcntl(workerHandles[1], F_SETFD, FD_CLOEXEC);
+
+	#ifdef SO_NOSIGPIPE
+		optionValue = 1;
+		setsockopt(workerHandles[0], SOL_SOCKET, SO_NOSIGPIPE, &optionValue, sizeof(optionValue));
+	#else
+		(void) optionValue;
+	#endif
+
+	// Worker's end of the connection is passed as a known descriptor (its stdout may carry JVM output)
+	if ((processID = fork()) == 0) {
+		if (workerHandles[1] == WorkerHandle) fcntl(WorkerHandle, F_SETFD, 0);
+		else dup2(workerHandles[1], WorkerHandle);
+
+		execvp(workerArguments[0], &workerArguments[0]);
+		_exit(127);
+	}
+
+	close(workerHandles[1]);
+	if (processID < 0) {
+		close(workerHandles[0]);
+		return NULL;
+	}
+
+	retWorker = new Worker;
+	retWorker->process = processID;
+	retWorker->handle = workerHandles[0];
+	retWorker->busy = false;
+	retWorker->configuration = passConfiguration;
+
+	return retWorker;
+#endif
+}
+
+void GraniteWorkerPool::stopWorker(Worker * passWorker, bool passKill) {
+#ifndef _WIN32
+	Command quitCommand;
+
+	// Idle workers quit when asked, failed ones may be stuck mid-request
+	if (passKill) kill(passWorker->process, SIGKILL);
+	else {
+		memset(&quitCommand, 0, sizeof(quitCommand));
+		quitCommand.type = CommandDef::CommandQuit;
+		writeFully(passWorker->handle, &quitCommand, sizeof(quitCommand));
+	}
+
+	close(passWorker->handle);
+	while (waitpid(passWorker->process, NULL, 0) < 0 && errno == EINTR);
+#endif
+
+	delete passWorker;
+}
+
+bool GraniteWorkerPool::sendCommand(Worker * passWorker, Command passCommand, std::string passFileName, std::string passSegmentName, std::vector< Field > passFields) {
+	std::string commandBuffer;
+
+	passCommand.fileNameLength = passFileName.size();
+	passCommand.segmentNameLength = passSegmentName.size();
+	passCommand.fieldCount = passFields.size();
+
+	// Sent as one message, so a worker never sees part of a command
+	commandBuffer.assign((const char *) &passCommand, sizeof(passCommand));
+	commandBuffer += passFileName + passSegmentName;
+	if (!passFields.empty()) commandBuffer.append((const char *) &passFields[0], passFields.size() * sizeof(Field));
+
+	return writeFully(passWorker->handle, commandBuffer.data(), commandBuffer.size());
+}
+
+bool GraniteWorkerPool::receiveReply(Worker * passWorker, Reply * retReply, std::string * retPayload) {
+	if (readFully(passWorker->handle, retReply, sizeof(Reply)) == false || retReply->length < 0) return false;
+
+	retPayload->resize(retReply->length);
+	if (retReply->length == 0) return true;
+
+	return readFully(passWorker->handle, &(*retPayload)[0], retReply->length);
+}
+
+std::string GraniteWorkerPool::getConfiguration() {
+	return std::string(vtkGraniteSettings::GetInstance()->getWorkerFileName()) + "\n" + vtkGraniteSettings::GetInstance()->getGraniteFileName() + "\n" + vtkGraniteSettings::GetInstance()->getJavaArguments();
+}
+
+void GraniteWorkerPool::releaseArray(void * passArray) {
+#ifndef _WIN32
+	std::map< void *, Mapping * >::iterator mappingIter;
+
+	std::lock_guard< std::mutex > guard(_mappingLock);
+	if ((mappingIter = _mappedArrays.find(passArray)) == _mappedArrays.end()) return;
+
+	// Unmap once the last array pointing into the segment is released
+	if (--mappingIter->second->references == 0) {
+		munmap(mappingIter->second->address, mappingIter->second->length);
+		delete mappingIter->second;
+	}
+
+	_mappedArrays.erase(mappingIter);
+#endif
+}
+
+std::mutex GraniteWorkerPool::_mappingLock;
+std::map< void *, GraniteWorkerPool::Mapping * > GraniteWorkerPool::_mappedArrays;
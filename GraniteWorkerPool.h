@@ -0,0 +1,129 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteWorkerPool.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteWorkerPool_h
+#define __GraniteWorkerPool_h
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vtkDataSetAttributes.h"
+#include "GraniteCounters.h"
+
+// Granite helper processes (granite-worker), each hosting its own JVM, which serve reads into shared memory
+class GraniteWorkerPool {
+	public:
+		// Commands sent to a worker (header, then file name, segment name and fields)
+		enum CommandDef { CommandOpen, // Open (and activate) data source, reply with its metadata
+						  CommandRead, // Read bounds of a level into the segment, replying with progress per slice
+						  CommandQuit,
+						  CommandCount };
+
+		// Replies from a worker (header, then payload)
+		enum ReplyDef { ReplyDone, // Payload is metadata for open, empty for read
+						ReplyProgress, // Slices completed so far
+						ReplyError, // Payload is the error message
+						ReplyCount };
+
+		struct Command {
+			int type;
+			int level; // Resolution level (VTK ordering)
+			int bounds[6]; // {xLow, xHigh, yLow, yHigh, zLow, zHigh} within the level
+			int segmentSlice; // Slice of the segment the first slice of bounds is written to
+			int attributeCount; // Values per point returned by Granite
+			int fieldCount; // Fields following the names
+			int fileNameLength;
+			int segmentNameLength;
+		};
+
+		// Destination of one attribute within the segment (array region of points, components interleaved as VTK stores them)
+		struct Field {
+			int attribute;
+			int components;
+			int component;
+			long long offset; // Byte offset of the array region within the segment
+		};
+
+		struct Reply {
+			int type;
+			int slices; // Slices completed (progress)
+			int length; // Payload bytes
+		};
+
+		// Data source description returned by open
+		struct Metadata {
+			bool multiresolution;
+			int dimensions;
+			std::vector< std::vector< int > > bounds; // Per level, full resolution first (as Granite orders them)
+			std::vector< std::string > attributeNames;
+		};
+
+		// Shared segment header (array regions follow from the first page)
+		struct SegmentHeader {
+			volatile int cancelled; // Set by the parent to stop workers at the next slice
+		};
+
+		static const int WorkerHandle = 3; // Descriptor of the worker's end of its connection
+
+		static GraniteWorkerPool * getInstance();
+
+		bool isEnabled(); // Worker processes configured (Granite Settings -> WorkerProcesses)
+		bool openDataSource(std::string passFileName, Metadata * retMetadata, std::string * retError); // Open through an idle worker, return success
+		bool copyFloatData(std::string passFileName, int passLevel, int * passBounds, int passAttributeCount, std::vector< int > passFields, vtkDataSetAttributes * retData, GraniteCounters * passCounters, std::function< bool(double) > passProgress, std::string * retError); // Read bounds split by slices across idle workers (fields as GraniteInterop::setFields)
+
+		// Message transfer (shared with granite-worker)
+		static bool readFully(int passHandle, void * retBuffer, size_t passLength);
+		static bool writeFully(int passHandle, const void * passBuffer, size_t passLength);
+		static std::string packMetadata(const Metadata & passMetadata);
+		static bool unpackMetadata(const std::string & passBuffer, Metadata * retMetadata);
+
+	private:
+		// Running worker process
+		struct Worker {
+			int process;
+			int handle; // Parent end of the connection
+			bool busy;
+			std::string configuration; // Settings the worker was started with
+		};
+
+		// Shared segment adopted by arrays
+		struct Mapping {
+			void * address;
+			size_t length;
+			int references;
+		};
+
+		GraniteWorkerPool();
+		~GraniteWorkerPool(); // Quits all workers
+
+		std::vector< Worker * > acquire(int passCount); // Claim up to passCount idle workers (at least one, starting or waiting for one as needed)
+		void release(std::vector< Worker * > passWorkers, std::vector< bool > passFailed); // Return workers to the pool, stopping failed ones
+		Worker * startWorker(std::string passConfiguration);
+		void stopWorker(Worker * passWorker, bool passKill); // Quit (or kill, if it failed) and reap worker
+		bool sendCommand(Worker * passWorker, Command passCommand, std::string passFileName, std::string passSegmentName, std::vector< Field > passFields);
+		bool receiveReply(Worker * passWorker, Reply * retReply, std::string * retPayload);
+		std::string getConfiguration(); // Worker executable, Granite library and Java arguments
+		static void releaseArray(void * passArray); // VTK free function for arrays pointing into a segment
+
+		std::mutex _poolLock; // Guards workers and busy flags
+		std::condition_variable _idleCondition; // Signals released workers
+		std::vector< Worker * > _workers;
+		unsigned long long _segmentCount; // Unique segment names
+
+		static std::mutex _mappingLock; // Arrays may be released from any thread
+		static std::map< void *, Mapping * > _mappedArrays; // Array pointer to owning segment
+};
+
+#endif // __GraniteWorkerPool_h
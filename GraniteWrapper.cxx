@@ -20,12 +20,14 @@
 	#include <unistd.h>
 #endif
 
+#include "GraniteTrace.h"
 #include "GraniteWrapper.h"
 #include "vtkGraniteSettings.h"
 #include "vtkSetGet.h"
 
 GraniteWrapper::GraniteWrapper() {
 	javaEnv = NULL;
+	_creatingThread = std::this_thread::get_id();
 
 	// Create the JVM
 	if (createJVM() == false) return;
@@ -41,6 +43,27 @@ GraniteWrapper::~GraniteWrapper() {
 	freeMethods();
 }
 
+JNIEnv * GraniteWrapper::env() {
+	JNIEnv * threadEnv;
+
+	if (javaEnv == NULL) return NULL;
+	if (std::this_thread::get_id() == _creatingThread) return javaEnv;
+
+	// JNI environments are per thread, so other threads attach before their first call
+	if (_javaVM->GetEnv((void * *) &threadEnv, JNI_VERSION_1_6) == JNI_EDETACHED) {
+		GraniteTrace::Span attachSpan("attachThread", "jvm");
+		if (_javaVM->AttachCurrentThread((void * *) &threadEnv, NULL) != JNI_OK) return NULL;
+	}
+
+	return threadEnv;
+}
+
+void GraniteWrapper::detachThread() {
+	if (javaEnv == NULL || std::this_thread::get_id() == _creatingThread) return;
+
+	_javaVM->DetachCurrentThread();
+}
+
 bool GraniteWrapper::createJVM() {
 	std::string jvmArgString;
 	std::vector< std::string > tempArgVector;
@@ -48,6 +71,8 @@ bool GraniteWrapper::createJVM() {
 	JavaVMOption * jvmOptions;
 	int lastPos;
 
+	GraniteTrace::Span createSpan("createJVM", "jvm");
+
 	// Ensure the Granite jar file exists
 	if (access(vtkGraniteSettings::GetInstance()->getGraniteFileName(), 0) == -1) {
 		displayError();
@@ -101,6 +126,7 @@ void GraniteWrapper::initClasses() {
 	graniteClasses[ClassDef::MRDataSource] = (jclass) javaEnv->NewGlobalRef(javaEnv->FindClass("edu/unh/sdb/datasource/MRDataSource")); 
 	graniteClasses[ClassDef::ISBounds] = (jclass) javaEnv->NewGlobalRef(javaEnv->FindClass("edu/unh/sdb/datasource/ISBounds")); 
 	graniteClasses[ClassDef::RecordDescriptor] = (jclass) javaEnv->NewGlobalRef(javaEnv->FindClass("edu/unh/sdb/common/RecordDescriptor")); 
+	graniteClasses[ClassDef::Runtime] = (jclass) javaEnv->NewGlobalRef(javaEnv->FindClass("java/lang/Runtime"));
 }
 
 void GraniteWrapper::initMethods() {
@@ -119,6 +145,10 @@ void GraniteWrapper::initMethods() {
 	graniteMethods[MethodDef::ISBoundsGetUpper] = (jmethodID) javaEnv->NewGlobalRef((jobject) javaEnv->GetMethodID(graniteClasses[ClassDef::ISBounds], "getUpper", "(I)I"));
 	graniteMethods[MethodDef::ISBoundsISBounds] = (jmethodID) javaEnv->NewGlobalRef((jobject) javaEnv->GetMethodID(graniteClasses[ClassDef::ISBounds], "<init>", "([I[I)V"));
 	graniteMethods[MethodDef::RecordDescriptorName] = (jmethodID) javaEnv->NewGlobalRef((jobject) javaEnv->GetMethodID(graniteClasses[ClassDef::RecordDescriptor], "name", "(I)Ljava/lang/String;"));
+	graniteMethods[MethodDef::StaticRuntimeGetRuntime] = (jmethodID) javaEnv->NewGlobalRef((jobject) javaEnv->GetStaticMethodID(graniteClasses[ClassDef::Runtime], "getRuntime", "()Ljava/lang/Runtime;"));
+	graniteMethods[MethodDef::RuntimeTotalMemory] = (jmethodID) javaEnv->NewGlobalRef((jobject) javaEnv->GetMethodID(graniteClasses[ClassDef::Runtime], "totalMemory", "()J"));
+	graniteMethods[MethodDef::RuntimeFreeMemory] = (jmethodID) javaEnv->NewGlobalRef((jobject) javaEnv->GetMethodID(graniteClasses[ClassDef::Runtime], "freeMemory", "()J"));
+	graniteMethods[MethodDef::RuntimeMaxMemory] = (jmethodID) javaEnv->NewGlobalRef((jobject) javaEnv->GetMethodID(graniteClasses[ClassDef::Runtime], "maxMemory", "()J"));
 }
 
 void GraniteWrapper::freeClasses() {
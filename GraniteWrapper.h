@@ -12,6 +12,7 @@
 #ifndef __GraniteWrapper_h
 #define __GraniteWrapper_h
 
+#include <thread>
 #include <jni.h>
 
 class GraniteWrapper {
@@ -23,6 +24,7 @@ class GraniteWrapper {
 						MRDataSource,
 						ISBounds, 
 						RecordDescriptor, 
+						Runtime,
 						ClassCount };
 
 		// Supported Granite Methods
@@ -41,12 +43,19 @@ class GraniteWrapper {
 						 ISBoundsGetUpper, 
 						 ISBoundsISBounds,
 						 RecordDescriptorName,
+						 StaticRuntimeGetRuntime,
+						 RuntimeTotalMemory,
+						 RuntimeFreeMemory,
+						 RuntimeMaxMemory,
 						 MethodCount };
 
 		GraniteWrapper();
 		~GraniteWrapper();
 
-		// JVM Environment
+		JNIEnv * env(); // Environment for calling thread (attached on first use, NULL without a JVM)
+		void detachThread(); // Release calling thread's attachment (threads other than the creating thread)
+
+		// JVM Environment (creating thread)
 		JNIEnv * javaEnv;
 
 		// Granite global references
@@ -63,5 +72,6 @@ class GraniteWrapper {
 		void displayError();
 
 		JavaVM * _javaVM;		
+		std::thread::id _creatingThread; // Thread that created the JVM (never detached)
 };
 #endif // __GraniteWrapper_h
@@ -0,0 +1,448 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteFileWriter.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#include <direct.h>
+#endif
+
+#include "GraniteFileWriter.h"
+#include "GraniteFormat.h"
+
+GraniteFileWriter::GraniteFileWriter() {
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		_extent[2 * dimIdx] = 0;
+		_extent[2 * dimIdx + 1] = -1;
+		_origin[dimIdx] = 0;
+		_spacing[dimIdx] = 1;
+	}
+
+	_mrCount = 1;
+	_mrSteps = 2;
+	_layout = Interleaved;
+	_busy = false;
+	_success = true;
+	_bytesWritten = 0;
+}
+
+GraniteFileWriter::~GraniteFileWriter() {
+	wait();
+}
+
+void GraniteFileWriter::setExtent(const int * passExtent) {
+	memcpy(_extent, passExtent, sizeof(_extent));
+}
+
+void GraniteFileWriter::setOrigin(const double * passOrigin) {
+	memcpy(_origin, passOrigin, sizeof(_origin));
+}
+
+void GraniteFileWriter::setSpacing(const double * passSpacing) {
+	memcpy(_spacing, passSpacing, sizeof(_spacing));
+}
+
+void GraniteFileWriter::addAttribute(const char * passName, TypeDef passType, int passComponents, const void * passData, const char * const * passComponentNames) {
+	Attribute newAttribute;
+
+	newAttribute.name = (passName != NULL ? passName : "");
+	newAttribute.type = passType;
+	newAttribute.components = std::max(1, passComponents);
+	newAttribute.data = passData;
+
+	for (int compIdx = 0 ; passComponentNames != NULL && compIdx < newAttribute.components ; compIdx++) {
+		newAttribute.componentNames.push_back(passComponentNames[compIdx] != NULL ? passComponentNames[compIdx] : "");
+	}
+
+	_attributes.push_back(newAttribute);
+}
+
+void GraniteFileWriter::clearAttributes() {
+	_attributes.clear();
+}
+
+void GraniteFileWriter::setMultiresolution(int passCount, int passSteps) {
+	_mrCount = std::max(1, passCount);
+	_mrSteps = std::max(2, passSteps);
+}
+
+void GraniteFileWriter::setLayout(LayoutDef passLayout) {
+	_layout = passLayout;
+}
+
+bool GraniteFileWriter::write(const char * passFileName) {
+	// Never alongside a background write, which shares buffers, statistics and error state
+	wait();
+
+	return writeFiles(passFileName);
+}
+
+bool GraniteFileWriter::writeFiles(const char * passFileName) {
+	std::vector< Statistics > statistics;
+	std::string fullPath, filePath, fileBase, currentDirectory, mrPostfix;
+	size_t pathPos;
+	bool success;
+
+	_error.clear();
+	_bytesWritten = 0;
+
+	// Validate request
+	fullPath = (passFileName != NULL ? passFileName : "");
+	if (fullPath.length() < 6 || fullPath.substr(fullPath.length() - 5) != ".xfdl") _error = "File name must end in .xfdl";
+	else if (_attributes.empty()) _error = "No attributes to write";
+	else if (_extent[1] < _extent[0] || _extent[3] < _extent[2] || _extent[5] < _extent[4]) _error = "Extent is empty";
+	else if (_layout == Planar && _mrCount > 1) _error = "Planar layout is only supported for single resolution data";
+
+	for (size_t attrIdx = 0 ; _error.empty() && attrIdx < _attributes.size() ; attrIdx++) {
+		if (_attributes[attrIdx].data == NULL) _error = "Attribute " + _attributes[attrIdx].name + " has no buffer";
+	}
+
+	if (!_error.empty()) return false;
+
+	// Split path and base name
+	pathPos = fullPath.find_last_of("/\\");
+	filePath = (pathPos == std::string::npos ? "" : fullPath.substr(0, pathPos + 1));
+	fileBase = fullPath.substr(filePath.length(), fullPath.length() - filePath.length() - 5);
+
+	// Single resolution - binary, then header (which carries the binary's statistics)
+	if (_mrCount == 1) {
+		return writeBinary(0, filePath + fileBase + ".bin", &statistics) && writeXFDL(0, filePath + fileBase + ".xfdl", fileBase + ".bin", &statistics);
+	}
+
+	// Multiresolution - nested level directories, as the readers expect
+	currentDirectory = filePath + fileBase + "/";
+	success = true;
+
+	for (int levelIdx = 0 ; success && levelIdx < _mrCount ; levelIdx++) {
+		success = makeDirectory(currentDirectory);
+
+		if (success && levelIdx == 0) {
+			success = writeBinary(0, currentDirectory + fileBase + ".bin", &statistics) &&
+					  writeXFDL(0, filePath + fileBase + ".xfdl", "@" + fileBase + "/" + fileBase + ".bin", &statistics) &&
+					  writeXFDL(0, currentDirectory + fileBase + ".xfdl", fileBase + ".bin", &statistics);
+		}
+		else if (success) {
+			mrPostfix = ".d" + std::to_string(levelIdx);
+			success = writeBinary(levelIdx, currentDirectory + fileBase + ".bin" + mrPostfix, &statistics) &&
+					  writeXFDL(levelIdx, currentDirectory + fileBase + ".bin" + mrPostfix + ".fdl", fileBase + ".bin" + mrPostfix, &statistics) &&
+					  writeXFDL(levelIdx, currentDirectory + "data.fdl", fileBase + ".bin" + mrPostfix, &statistics);
+		}
+
+		currentDirectory += "level" + std::to_string(levelIdx + 1) + "/";
+	}
+
+	return success;
+}
+
+bool GraniteFileWriter::writeAsync(const char * passFileName) {
+	std::string fileName;
+
+	if (_busy) return false;
+
+	// Previous write has finished, but its thread must still be joined
+	if (_writeThread.joinable()) _writeThread.join();
+
+	fileName = (passFileName != NULL ? passFileName : "");
+	_busy = true;
+	_writeThread = std::thread([this, fileName] {
+		_success = writeFiles(fileName.c_str());
+		_busy = false;
+	});
+
+	return true;
+}
+
+bool GraniteFileWriter::wait() {
+	if (_writeThread.joinable()) _writeThread.join();
+
+	return _success;
+}
+
+bool GraniteFileWriter::isBusy() {
+	return _busy;
+}
+
+const char * GraniteFileWriter::getError() {
+	return _error.c_str();
+}
+
+unsigned long long GraniteFileWriter::getBytesWritten() {
+	return _bytesWritten;
+}
+
+bool GraniteFileWriter::writeBinary(int passLevel, std::string passBinaryName, std::vector< Statistics > * retStatistics) {
+	std::vector< char > sliceBuffers[2];
+	std::thread flushThread;
+	std::mutex flushLock;
+	std::condition_variable flushCondition;
+	FILE * fileHandle;
+	Statistics emptyStatistics;
+	int levelExtent[6], sliceCount, planeCount, chunkCount, encodedCount, flushedCount;
+	size_t sliceBytes;
+	bool flushSuccess;
+
+	fileHandle = fopen(passBinaryName.c_str(), "wb");
+	if (fileHandle == NULL) {
+		_error = "Unable to create " + passBinaryName;
+		return false;
+	}
+
+	emptyStatistics.minimum = DBL_MAX;
+	emptyStatistics.maximum = -DBL_MAX;
+	emptyStatistics.sum = 0;
+	emptyStatistics.count = 0;
+	retStatistics->assign(getFieldCount(), emptyStatistics);
+
+	// A slice holds every field (interleaved) or one field (planar)
+	getLevelExtent(passLevel, levelExtent);
+	sliceCount = levelExtent[5] - levelExtent[4] + 1;
+	planeCount = (_layout == Planar ? getFieldCount() : 1);
+	chunkCount = planeCount * sliceCount;
+	sliceBytes = (size_t) (levelExtent[1] - levelExtent[0] + 1) * (levelExtent[3] - levelExtent[2] + 1) * (_layout == Planar ? 1 : getFieldCount()) * sizeof(float);
+	sliceBuffers[0].resize(sliceBytes);
+	sliceBuffers[1].resize(sliceBytes);
+
+	flushSuccess = true;
+	encodedCount = 0;
+	flushedCount = 0;
+
+	// Double buffered - one flush thread writes each slice while the next is encoded
+	flushThread = std::thread([&] {
+		std::unique_lock< std::mutex > lock(flushLock);
+		bool written;
+
+		while (flushedCount < chunkCount && flushSuccess) {
+			flushCondition.wait(lock, [&] { return flushedCount < encodedCount; });
+
+			lock.unlock();
+			written = (fwrite(&sliceBuffers[flushedCount % 2][0], 1, sliceBytes, fileHandle) == sliceBytes);
+			lock.lock();
+
+			if (!written) flushSuccess = false;
+			flushedCount++;
+			flushCondition.notify_all();
+		}
+	});
+
+	for (int chunkIdx = 0 ; chunkIdx < chunkCount ; chunkIdx++) {
+		{
+			// Wait for the buffer's previous slice to be flushed (stopping once a write has failed)
+			std::unique_lock< std::mutex > lock(flushLock);
+			flushCondition.wait(lock, [&] { return chunkIdx - flushedCount < 2 || !flushSuccess; });
+			if (!flushSuccess) break;
+		}
+
+		encodeSlice(passLevel, chunkIdx % sliceCount, (_layout == Planar ? chunkIdx / sliceCount : -1), &sliceBuffers[chunkIdx % 2][0], retStatistics);
+
+		{
+			std::lock_guard< std::mutex > guard(flushLock);
+			encodedCount++;
+			flushCondition.notify_all();
+		}
+	}
+
+	flushThread.join();
+	if (fclose(fileHandle) != 0) flushSuccess = false;
+
+	if (!flushSuccess) {
+		_error = "Unable to write " + passBinaryName;
+		return false;
+	}
+
+	_bytesWritten += (unsigned long long) sliceBytes * chunkCount;
+
+	return true;
+}
+
+bool GraniteFileWriter::writeXFDL(int passLevel, std::string passXFDLName, std::string passHeaderBinary, std::vector< Statistics > * passStatistics) {
+	GraniteFormat::Header xfdlHeader;
+	GraniteFormat::FieldStatistics fieldStatistics;
+	GraniteFormat::FieldOffset fieldOffset;
+	Statistics * currentStatistics;
+	int levelScale, fieldIdx;
+	long long levelPoints;
+
+	getLevelExtent(passLevel, xfdlHeader.extent);
+	levelScale = (int) pow(_mrSteps, passLevel);
+	levelPoints = (long long) (xfdlHeader.extent[1] - xfdlHeader.extent[0] + 1) * (xfdlHeader.extent[3] - xfdlHeader.extent[2] + 1) * (xfdlHeader.extent[5] - xfdlHeader.extent[4] + 1);
+
+	// Header, as vtkGraniteWriter writes it for a vtkImageData
+	xfdlHeader.binaryName = passHeaderBinary;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		xfdlHeader.origin[dimIdx] = _origin[dimIdx];
+		xfdlHeader.spacing[dimIdx] = _spacing[dimIdx] * levelScale;
+		xfdlHeader.dimensions[dimIdx] = xfdlHeader.extent[2 * dimIdx + 1] - xfdlHeader.extent[2 * dimIdx] + 1;
+	}
+
+	// Field ranges (no blocks or histograms, which the readers treat as unknown, and none for fields without values)
+	xfdlHeader.statistics = true;
+	fieldIdx = 0;
+	for (size_t attrIdx = 0 ; attrIdx < _attributes.size() ; attrIdx++) {
+		for (int compIdx = 0 ; compIdx < _attributes[attrIdx].components ; compIdx++) {
+			xfdlHeader.fieldNames.push_back(getFieldName(attrIdx, compIdx));
+			currentStatistics = &passStatistics->at(fieldIdx++);
+			if (currentStatistics->count == 0) continue;
+
+			fieldStatistics.fieldName = xfdlHeader.fieldNames.back();
+			fieldStatistics.block = -1;
+			fieldStatistics.minimum = currentStatistics->minimum;
+			fieldStatistics.maximum = currentStatistics->maximum;
+			fieldStatistics.mean = currentStatistics->sum / currentStatistics->count;
+			fieldStatistics.count = currentStatistics->count;
+			xfdlHeader.fieldStatistics.push_back(fieldStatistics);
+		}
+	}
+
+	// Native storage - host order float planes, in field order
+	if (_layout == Planar) {
+		xfdlHeader.storage = true;
+		xfdlHeader.byteOrder = (GraniteFormat::isHostBigEndian() ? "big" : "little");
+		xfdlHeader.layout = "planar";
+
+		for (size_t planeIdx = 0 ; planeIdx < xfdlHeader.fieldNames.size() ; planeIdx++) {
+			fieldOffset.fieldName = xfdlHeader.fieldNames[planeIdx];
+			fieldOffset.offset = (long long) planeIdx * levelPoints * sizeof(float);
+			xfdlHeader.fieldOffsets.push_back(fieldOffset);
+		}
+	}
+
+	if (GraniteFormat::writeXFDL(xfdlHeader, passXFDLName) == false) {
+		_error = "Unable to write " + passXFDLName;
+		return false;
+	}
+
+	return true;
+}
+
+void GraniteFileWriter::encodeSlice(int passLevel, int passSlice, int passField, char * retBuffer, std::vector< Statistics > * retStatistics) {
+	Statistics * currentStatistics;
+	int levelExtent[6], sourceLocation[3], levelScale, fieldIdx;
+	size_t sourcePoint;
+	float currentValue;
+	bool bigEndian;
+
+	getLevelExtent(passLevel, levelExtent);
+	levelScale = (int) pow(_mrSteps, passLevel);
+	bigEndian = (_layout == Interleaved || GraniteFormat::isHostBigEndian());
+
+	// Coarser levels subsample every levelScale-th point of the buffers, which is where vtkImageResample's linear interpolation lands at magnification 1 / levelScale, so both writers produce the same values
+	sourceLocation[2] = std::min((levelExtent[4] + passSlice) * levelScale, _extent[5]);
+
+	for (int yIdx = levelExtent[2] ; yIdx <= levelExtent[3] ; yIdx++) {
+		sourceLocation[1] = std::min(yIdx * levelScale, _extent[3]);
+
+		for (int xIdx = levelExtent[0] ; xIdx <= levelExtent[1] ; xIdx++) {
+			sourceLocation[0] = std::min(xIdx * levelScale, _extent[1]);
+			sourcePoint = ((size_t) (sourceLocation[2] - _extent[4]) * (_extent[3] - _extent[2] + 1) + (sourceLocation[1] - _extent[2])) * (_extent[1] - _extent[0] + 1) + (sourceLocation[0] - _extent[0]);
+			fieldIdx = 0;
+
+			for (size_t attrIdx = 0 ; attrIdx < _attributes.size() ; attrIdx++) {
+				for (int compIdx = 0 ; compIdx < _attributes[attrIdx].components ; compIdx++, fieldIdx++) {
+					if (passField >= 0 && fieldIdx != passField) continue;
+
+					currentValue = (float) getValue(_attributes[attrIdx], sourcePoint, compIdx);
+
+					// NaN never contributes to ranges
+					if (currentValue == currentValue) {
+						currentStatistics = &retStatistics->at(fieldIdx);
+						currentStatistics->minimum = std::min(currentStatistics->minimum, (double) currentValue);
+						currentStatistics->maximum = std::max(currentStatistics->maximum, (double) currentValue);
+						currentStatistics->sum += currentValue;
+						currentStatistics->count++;
+					}
+
+					GraniteFormat::encodeFloats(&currentValue, 1, bigEndian, retBuffer);
+					retBuffer += sizeof(float);
+				}
+			}
+		}
+	}
+}
+
+void GraniteFileWriter::getLevelExtent(int passLevel, int * retExtent) {
+	int levelScale;
+
+	// Matches extent produced by vtkImageResample at magnification 1 / steps^level
+	levelScale = (int) pow(_mrSteps, passLevel);
+	for (int dimIdx = 0 ; dimIdx < 6 ; dimIdx++) {
+		retExtent[dimIdx] = (int) floor((double) _extent[dimIdx] / levelScale);
+	}
+
+	// Never start before the buffers
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		if (retExtent[2 * dimIdx] * levelScale < _extent[2 * dimIdx]) retExtent[2 * dimIdx]++;
+	}
+}
+
+int GraniteFileWriter::getFieldCount() {
+	int fieldCount;
+
+	fieldCount = 0;
+	for (size_t attrIdx = 0 ; attrIdx < _attributes.size() ; attrIdx++) {
+		fieldCount += _attributes[attrIdx].components;
+	}
+
+	return fieldCount;
+}
+
+std::string GraniteFileWriter::getFieldName(size_t passAttribute, int passComponent) {
+	std::string arrayName, compName;
+
+	arrayName = (!_attributes[passAttribute].name.empty() ? _attributes[passAttribute].name : "array" + std::to_string(passAttribute));
+	compName = (passComponent < (int) _attributes[passAttribute].componentNames.size() && !_attributes[passAttribute].componentNames[passComponent].empty() ? _attributes[passAttribute].componentNames[passComponent] : "comp" + std::to_string(passComponent));
+
+	return arrayName + "." + compName;
+}
+
+double GraniteFileWriter::getValue(const Attribute & passAttribute, size_t passPoint, int passComponent) {
+	size_t valueIdx;
+
+	valueIdx = passPoint * passAttribute.components + passComponent;
+
+	switch (passAttribute.type) {
+		case Int8: return ((const int8_t *) passAttribute.data)[valueIdx];
+		case UInt8: return ((const uint8_t *) passAttribute.data)[valueIdx];
+		case Int16: return ((const int16_t *) passAttribute.data)[valueIdx];
+		case UInt16: return ((const uint16_t *) passAttribute.data)[valueIdx];
+		case Int32: return ((const int32_t *) passAttribute.data)[valueIdx];
+		case UInt32: return ((const uint32_t *) passAttribute.data)[valueIdx];
+		case Float32: return ((const float *) passAttribute.data)[valueIdx];
+		case Float64: return ((const double *) passAttribute.data)[valueIdx];
+		default: return 0;
+	}
+}
+
+bool GraniteFileWriter::makeDirectory(std::string passDirectory) {
+	struct stat directoryStat;
+
+	#ifdef _WIN32
+		mkdir(passDirectory.c_str());
+	#else
+		mkdir(passDirectory.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+	#endif
+
+	// Existing directories are reused
+	if (stat(passDirectory.c_str(), &directoryStat) != 0 || (directoryStat.st_mode & S_IFDIR) == 0) {
+		_error = "Unable to create directory " + passDirectory;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,107 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteFileWriter.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteFileWriter_h
+#define __GraniteFileWriter_h
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes Granite XFDL/BIN files the plugin reads directly from simulation buffers, with no ParaView or VTK dependency (headers and records come from GraniteFormat, as vtkGraniteWriter's do)
+class GraniteFileWriter {
+	public:
+		// Supported buffer value types (always stored as float)
+		enum TypeDef { Int8,
+					   UInt8,
+					   Int16,
+					   UInt16,
+					   Int32,
+					   UInt32,
+					   Float32,
+					   Float64,
+					   TypeCount };
+
+		// Supported binary layouts
+		enum LayoutDef { Interleaved, // Granite storage - big-endian record per point
+						 Planar, // Native storage - host order plane per field (single resolution only, read by the plugin alone)
+						 LayoutCount };
+
+		GraniteFileWriter();
+		~GraniteFileWriter(); // Waits for any background write
+
+		// Uniform grid (extent in points as {xLow, xHigh, yLow, yHigh, zLow, zHigh}, buffers x fastest)
+		void setExtent(const int * passExtent);
+		void setOrigin(const double * passOrigin);
+		void setSpacing(const double * passSpacing);
+
+		// Attributes are referenced rather than copied, so buffers must stay valid until the write completes
+		void addAttribute(const char * passName, TypeDef passType, int passComponents, const void * passData, const char * const * passComponentNames = NULL);
+		void clearAttributes();
+
+		void setMultiresolution(int passCount, int passSteps); // Levels (1 is single resolution) and subsampling step between levels
+		void setLayout(LayoutDef passLayout);
+
+		bool write(const char * passFileName); // Write dataset named *.xfdl (after any background write finishes), return success
+		bool writeAsync(const char * passFileName); // Start write on a background thread, return false if one is still running
+		bool wait(); // Wait for background write, return its success
+		bool isBusy(); // Background write still running
+
+		const char * getError(); // Reason last write failed
+		unsigned long long getBytesWritten(); // Binary bytes written by last write
+
+	private:
+		// Typed buffer of one attribute
+		struct Attribute {
+			std::string name;
+			TypeDef type;
+			int components;
+			const void * data;
+			std::vector< std::string > componentNames;
+		};
+
+		// Range of one field, gathered while writing
+		struct Statistics {
+			double minimum;
+			double maximum;
+			double sum;
+			unsigned long long count;
+		};
+
+		GraniteFileWriter(const GraniteFileWriter&);  // Not implemented
+		void operator=(const GraniteFileWriter&);  // Not implemented
+
+		bool writeFiles(const char * passFileName); // Validate, then write every level's binary and headers
+		bool writeBinary(int passLevel, std::string passBinaryName, std::vector< Statistics > * retStatistics); // Encode slices while a flush thread writes the previous one
+		bool writeXFDL(int passLevel, std::string passXFDLName, std::string passHeaderBinary, std::vector< Statistics > * passStatistics);
+		void encodeSlice(int passLevel, int passSlice, int passField, char * retBuffer, std::vector< Statistics > * retStatistics); // One level slice (one field for planar) in stored form
+		void getLevelExtent(int passLevel, int * retExtent); // Subsampled extent of a level
+		int getFieldCount();
+		std::string getFieldName(size_t passAttribute, int passComponent); // Granite field name (array.component)
+		double getValue(const Attribute & passAttribute, size_t passPoint, int passComponent);
+		bool makeDirectory(std::string passDirectory);
+
+		int _extent[6];
+		double _origin[3];
+		double _spacing[3];
+		std::vector< Attribute > _attributes;
+		int _mrCount, _mrSteps; // Number of multiresolution levels and steps between level
+		LayoutDef _layout;
+
+		std::thread _writeThread; // Background write
+		std::atomic< bool > _busy;
+		bool _success; // Result of last write
+		std::string _error;
+		unsigned long long _bytesWritten;
+};
+
+#endif // __GraniteFileWriter_h
@@ -0,0 +1,198 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteFormat.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "GraniteFormat.h"
+
+GraniteFormat::Header::Header() {
+	dataType = "vtkImageData";
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		extent[2 * dimIdx] = 0;
+		extent[2 * dimIdx + 1] = -1;
+		origin[dimIdx] = 0;
+		spacing[dimIdx] = 1;
+		gridCounts[dimIdx] = 0;
+		dimensions[dimIdx] = 0;
+	}
+
+	statistics = false;
+	divisions = 1;
+	bins = 0;
+	storage = false;
+	containerAlignment = 0;
+}
+
+std::string GraniteFormat::getXFDL(const Header & passHeader) {
+	std::string retXML;
+	const FieldStatistics * currentStatistics;
+
+	// Header information
+	retXML = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	retXML += "<!DOCTYPE FileDescriptor PUBLIC \"-//SDB//DTD//EN\"  \"fdl.dtd\">\n";
+	retXML += "<FileDescriptor fileName=\"" + escape(passHeader.binaryName) + "\" fileType=\"binary\">\n";
+
+	// Fields
+	for (size_t fieldIdx = 0 ; fieldIdx < passHeader.fieldNames.size() ; fieldIdx++) {
+		retXML += "    <Field fieldName=\"" + escape(passHeader.fieldNames[fieldIdx]) + "\" fieldType=\"float\"/>\n";
+	}
+
+	// Custom - ParaView type, then bounds (outermost axis first)
+	retXML += "    <CustomParaViewType>" + escape(passHeader.dataType) + "</CustomParaViewType>\n";
+	for (int dimIdx = 2 ; dimIdx >= 0 ; dimIdx--) {
+		retXML += "    <Bounds lower=\"" + std::to_string(passHeader.extent[2 * dimIdx]) + "\" upper=\"" + std::to_string(passHeader.extent[2 * dimIdx + 1]) + "\"/>\n";
+	}
+
+	// Custom - ParaView geometry (uniform spacing, or coordinates in a sidecar)
+	if (passHeader.gridFileName.empty()) {
+		retXML += "    <CustomParaViewOrigin x=\"" + formatNumber(passHeader.origin[0]) + "\" y=\"" + formatNumber(passHeader.origin[1]) + "\" z=\"" + formatNumber(passHeader.origin[2]) + "\"/>\n";
+		retXML += "    <CustomParaViewSpacing x=\"" + formatNumber(passHeader.spacing[0]) + "\" y=\"" + formatNumber(passHeader.spacing[1]) + "\" z=\"" + formatNumber(passHeader.spacing[2]) + "\"/>\n";
+	}
+	else {
+		retXML += "    <CustomParaViewGridFile fileName=\"" + escape(passHeader.gridFileName) + "\" x=\"" + std::to_string(passHeader.gridCounts[0]) + "\" y=\"" + std::to_string(passHeader.gridCounts[1]) + "\" z=\"" + std::to_string(passHeader.gridCounts[2]) + "\" type=\"double\" byteOrder=\"big\"/>\n";
+	}
+
+	// Custom - ParaView statistics (blocks split as AMR blocks are)
+	if (passHeader.statistics) {
+		retXML += "    <CustomParaViewStatistics divisions=\"" + std::to_string(passHeader.divisions) + "\" bins=\"" + std::to_string(passHeader.bins) + "\" x=\"" + std::to_string(passHeader.dimensions[0]) + "\" y=\"" + std::to_string(passHeader.dimensions[1]) + "\" z=\"" + std::to_string(passHeader.dimensions[2]) + "\" blocks=\"amr\"";
+		retXML += (passHeader.fieldStatistics.empty() ? "/>\n" : ">\n");
+
+		for (size_t statIdx = 0 ; statIdx < passHeader.fieldStatistics.size() ; statIdx++) {
+			currentStatistics = &passHeader.fieldStatistics[statIdx];
+
+			if (currentStatistics->block < 0) {
+				retXML += "        <FieldStatistics fieldName=\"" + escape(currentStatistics->fieldName) + "\"";
+			}
+			else {
+				retXML += "        <BlockStatistics block=\"" + std::to_string(currentStatistics->block) + "\" fieldName=\"" + escape(currentStatistics->fieldName) + "\"";
+			}
+
+			retXML += " min=\"" + formatNumber(currentStatistics->minimum) + "\" max=\"" + formatNumber(currentStatistics->maximum) + "\" mean=\"" + formatNumber(currentStatistics->mean) + "\" count=\"" + std::to_string(currentStatistics->count) + "\"";
+
+			if (currentStatistics->block < 0) {
+				retXML += " histogram=\"";
+				for (size_t binIdx = 0 ; binIdx < currentStatistics->histogram.size() ; binIdx++) {
+					if (binIdx > 0) retXML += " ";
+					retXML += std::to_string(currentStatistics->histogram[binIdx]);
+				}
+				retXML += "\"";
+			}
+
+			retXML += "/>\n";
+		}
+
+		if (!passHeader.fieldStatistics.empty()) retXML += "    </CustomParaViewStatistics>\n";
+	}
+
+	// Custom - ParaView storage (binary read directly by the plugin)
+	if (passHeader.storage) {
+		retXML += "    <CustomParaViewStorage byteOrder=\"" + escape(passHeader.byteOrder) + "\" layout=\"" + escape(passHeader.layout) + "\"";
+		retXML += (passHeader.fieldEncodings.empty() && passHeader.fieldOffsets.empty() ? "/>\n" : ">\n");
+
+		for (size_t fieldIdx = 0 ; fieldIdx < passHeader.fieldEncodings.size() ; fieldIdx++) {
+			retXML += "        <FieldEncoding fieldName=\"" + escape(passHeader.fieldEncodings[fieldIdx].fieldName) + "\" type=\"" + escape(passHeader.fieldEncodings[fieldIdx].type) + "\" scale=\"" + formatNumber(passHeader.fieldEncodings[fieldIdx].scale) + "\" offset=\"" + formatNumber(passHeader.fieldEncodings[fieldIdx].offset) + "\"/>\n";
+		}
+
+		writeFieldOffsets(passHeader.fieldOffsets, "        ", &retXML);
+
+		if (!passHeader.fieldEncodings.empty() || !passHeader.fieldOffsets.empty()) retXML += "    </CustomParaViewStorage>\n";
+	}
+
+	// Custom - ParaView container (extent and byte offset of each level within the binary)
+	if (!passHeader.levels.empty()) {
+		retXML += "    <CustomParaViewContainer alignment=\"" + std::to_string(passHeader.containerAlignment) + "\">\n";
+
+		for (size_t levelIdx = 0 ; levelIdx < passHeader.levels.size() ; levelIdx++) {
+			retXML += "        <Level index=\"" + std::to_string(levelIdx) + "\" extent=\"" + std::to_string(passHeader.levels[levelIdx].extent[0]);
+			for (int boundIdx = 1 ; boundIdx < 6 ; boundIdx++) {
+				retXML += " " + std::to_string(passHeader.levels[levelIdx].extent[boundIdx]);
+			}
+			retXML += "\" offset=\"" + std::to_string(passHeader.levels[levelIdx].offset) + "\"";
+
+			if (passHeader.levels[levelIdx].fieldOffsets.empty()) {
+				retXML += "/>\n";
+			}
+			else {
+				retXML += ">\n";
+				writeFieldOffsets(passHeader.levels[levelIdx].fieldOffsets, "            ", &retXML);
+				retXML += "        </Level>\n";
+			}
+		}
+
+		retXML += "    </CustomParaViewContainer>\n";
+	}
+
+	retXML += "</FileDescriptor>\n";
+
+	return retXML;
+}
+
+bool GraniteFormat::writeXFDL(const Header & passHeader, std::string passFileName) {
+	std::ofstream fileStream;
+
+	fileStream.open(passFileName.c_str(), std::ios::out | std::ios::binary);
+	fileStream << getXFDL(passHeader);
+	fileStream.close();
+
+	return !fileStream.fail();
+}
+
+void GraniteFormat::encodeFloats(const float * passValues, size_t passCount, bool passBigEndian, char * retBytes) {
+	memcpy(retBytes, passValues, passCount * sizeof(float));
+	if (passBigEndian == isHostBigEndian()) return;
+
+	for (size_t valueIdx = 0 ; valueIdx < passCount ; valueIdx++) {
+		std::reverse(retBytes + valueIdx * sizeof(float), retBytes + (valueIdx + 1) * sizeof(float));
+	}
+}
+
+bool GraniteFormat::isHostBigEndian() {
+	unsigned int testValue;
+
+	testValue = 1;
+
+	return *((unsigned char *) &testValue) == 0;
+}
+
+std::string GraniteFormat::escape(const std::string & passString) {
+	std::string retString;
+
+	for (size_t charIdx = 0 ; charIdx < passString.length() ; charIdx++) {
+		switch (passString[charIdx]) {
+			case '&': retString += "&amp;"; break;
+			case '<': retString += "&lt;"; break;
+			case '>': retString += "&gt;"; break;
+			case '"': retString += "&quot;"; break;
+			default: retString += passString[charIdx];
+		}
+	}
+
+	return retString;
+}
+
+std::string GraniteFormat::formatNumber(double passValue) {
+	std::ostringstream numberStream;
+
+	numberStream.precision(17);
+	numberStream << passValue;
+
+	return numberStream.str();
+}
+
+void GraniteFormat::writeFieldOffsets(const std::vector< FieldOffset > & passOffsets, std::string passIndent, std::string * retXML) {
+	for (size_t fieldIdx = 0 ; fieldIdx < passOffsets.size() ; fieldIdx++) {
+		*retXML += passIndent + "<FieldOffset fieldName=\"" + escape(passOffsets[fieldIdx].fieldName) + "\" offset=\"" + std::to_string(passOffsets[fieldIdx].offset) + "\"/>\n";
+	}
+}
@@ -0,0 +1,91 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteFormat.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __GraniteFormat_h
+#define __GraniteFormat_h
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// XFDL headers and binary records of Granite datasets, shared by vtkGraniteWriter and GraniteFileWriter (no ParaView, VTK or Qt dependency)
+class GraniteFormat {
+	public:
+		// Range of one field, over the whole data set or one block
+		struct FieldStatistics {
+			std::string fieldName;
+			int block; // Block index (-1 for the whole data set)
+			double minimum;
+			double maximum;
+			double mean;
+			unsigned long long count;
+			std::vector< unsigned long long > histogram; // Whole data set only (empty if not gathered)
+		};
+
+		// Stored encoding of a field not stored as float (value = code * scale + offset)
+		struct FieldEncoding {
+			std::string fieldName;
+			std::string type;
+			double scale;
+			double offset;
+		};
+
+		// Byte offset of a field's plane (planar storage)
+		struct FieldOffset {
+			std::string fieldName;
+			long long offset;
+		};
+
+		// Level of a multiresolution container
+		struct Level {
+			int extent[6];
+			long long offset; // Byte offset within the binary
+			std::vector< FieldOffset > fieldOffsets;
+		};
+
+		// Everything an XFDL describes (sections left empty are not written)
+		struct Header {
+			Header();
+
+			std::string binaryName; // As named by the XFDL (relative, "@" prefixed for multiresolution roots)
+			std::vector< std::string > fieldNames; // Granite field names (array.component), all read as floats
+			std::string dataType; // vtkImageData or vtkRectilinearGrid
+			int extent[6]; // Point extent as {xLow, xHigh, yLow, yHigh, zLow, zHigh}
+			double origin[3]; // vtkImageData only
+			double spacing[3]; // vtkImageData only
+			std::string gridFileName; // Coordinate sidecar of big-endian doubles (vtkRectilinearGrid only)
+			long long gridCounts[3];
+
+			bool statistics; // Statistics section present
+			int divisions, bins, dimensions[3];
+			std::vector< FieldStatistics > fieldStatistics; // Whole data set summaries, then block summaries
+
+			bool storage; // Binary read directly by the plugin
+			std::string byteOrder, layout;
+			std::vector< FieldEncoding > fieldEncodings;
+			std::vector< FieldOffset > fieldOffsets;
+
+			long long containerAlignment;
+			std::vector< Level > levels; // Container levels, full resolution first (empty unless a container)
+		};
+
+		static std::string getXFDL(const Header & passHeader);
+		static bool writeXFDL(const Header & passHeader, std::string passFileName); // False if it could not be written
+		static void encodeFloats(const float * passValues, size_t passCount, bool passBigEndian, char * retBytes); // Values in stored byte order
+		static bool isHostBigEndian();
+
+	private:
+		static std::string escape(const std::string & passString); // XML attribute escaping
+		static std::string formatNumber(double passValue); // Full precision
+		static void writeFieldOffsets(const std::vector< FieldOffset > & passOffsets, std::string passIndent, std::string * retXML);
+};
+
+#endif // __GraniteFormat_h
@@ -0,0 +1,235 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: GraniteWorker.cxx
+ Author: Toni Westbrook
+
+ Granite helper process started by GraniteWorkerPool.  Hosts its own JVM
+ (with the Granite library and Java arguments passed on the command line),
+ keeps data sources open across requests, and writes the slices it is
+ asked for straight into the requesting process's shared memory segment.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "vtkGraniteSettings.h"
+#include "GraniteInterop.h"
+#include "GraniteShared.h"
+#include "GraniteWorkerPool.h"
+
+class GraniteWorker {
+	public:
+		GraniteWorker();
+		~GraniteWorker();
+
+		bool parseArguments(int passCount, char * * passArguments);
+		int run(); // Serve commands until the pool quits or disconnects
+
+	private:
+		GraniteInterop * getDataSource(std::string passFileName, std::string * retError); // Open data source (kept for later requests until the file changes), NULL on failure
+		bool openData(std::string passFileName); // Reply with metadata
+		bool readData(GraniteWorkerPool::Command & passCommand, std::string passFileName, std::string passSegmentName, std::vector< GraniteWorkerPool::Field > & passFields); // Write slices into segment, replying with progress
+		bool sendReply(int passType, int passSlices, std::string passPayload);
+
+		std::map< std::string, GraniteInterop * > _dataSources; // Open data sources by XFDL filename
+		std::map< std::string, std::string > _fileVersions; // Modification time and size of each XFDL when opened
+};
+
+GraniteWorker::GraniteWorker() { }
+
+GraniteWorker::~GraniteWorker() {
+	for (std::map< std::string, GraniteInterop * >::iterator sourceIter = _dataSources.begin() ; sourceIter != _dataSources.end() ; sourceIter++) {
+		delete sourceIter->second;
+	}
+}
+
+bool GraniteWorker::parseArguments(int passCount, char * * passArguments) {
+	if (passCount != 3) {
+		fprintf(stderr, "Usage: %s <granite jar> <java arguments>\n", passArguments[0]);
+		fprintf(stderr, "Started by the Granite plugin (Granite Settings -> WorkerProcesses), connected on descriptor %d.\n", GraniteWorkerPool::WorkerHandle);
+		return false;
+	}
+
+	// Never serve reads through a pool of its own
+	vtkGraniteSettings::GetInstance()->setGraniteFileName(passArguments[1]);
+	vtkGraniteSettings::GetInstance()->setJavaArguments(passArguments[2]);
+	vtkGraniteSettings::GetInstance()->setWorkerProcesses(0);
+
+	return true;
+}
+
+int GraniteWorker::run() {
+	GraniteWorkerPool::Command currentCommand;
+	std::vector< GraniteWorkerPool::Field > commandFields;
+	std::string fileName, segmentName;
+
+	while (GraniteWorkerPool::readFully(GraniteWorkerPool::WorkerHandle, &currentCommand, sizeof(currentCommand))) {
+		if (currentCommand.type == GraniteWorkerPool::CommandDef::CommandQuit) break;
+		if (currentCommand.fileNameLength < 0 || currentCommand.segmentNameLength < 0 || currentCommand.fieldCount < 0) return 1;
+
+		// Names and fields follow the header
+		fileName.resize(currentCommand.fileNameLength);
+		segmentName.resize(currentCommand.segmentNameLength);
+		commandFields.resize(currentCommand.fieldCount);
+		if (!fileName.empty() && !GraniteWorkerPool::readFully(GraniteWorkerPool::WorkerHandle, &fileName[0], fileName.size())) return 1;
+		if (!segmentName.empty() && !GraniteWorkerPool::readFully(GraniteWorkerPool::WorkerHandle, &segmentName[0], segmentName.size())) return 1;
+		if (!commandFields.empty() && !GraniteWorkerPool::readFully(GraniteWorkerPool::WorkerHandle, &commandFields[0], commandFields.size() * sizeof(GraniteWorkerPool::Field))) return 1;
+
+		switch (currentCommand.type) {
+			case GraniteWorkerPool::CommandDef::CommandOpen:
+				if (openData(fileName) == false) return 1;
+				break;
+
+			case GraniteWorkerPool::CommandDef::CommandRead:
+				if (readData(currentCommand, fileName, segmentName, commandFields) == false) return 1;
+				break;
+
+			default:
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+GraniteInterop * GraniteWorker::getDataSource(std::string passFileName, std::string * retError) {
+	GraniteInterop * retSource;
+	std::string fileVersion;
+
+	fileVersion = GraniteShared::getFileVersion(passFileName);
+
+	// Files changed since they were opened are read afresh
+	if (_dataSources.find(passFileName) != _dataSources.end()) {
+		if (_fileVersions[passFileName] == fileVersion) return _dataSources[passFileName];
+
+		delete _dataSources[passFileName];
+		_dataSources.erase(passFileName);
+	}
+
+	retSource = new GraniteInterop;
+	if (retSource->openDataSource(passFileName.c_str(), true) == false) {
+		*retError = retSource->getExceptionMessage();
+		if (retError->empty()) *retError = "Unable to open Granite data source " + passFileName;
+		delete retSource;
+
+		return NULL;
+	}
+
+	_dataSources[passFileName] = retSource;
+	_fileVersions[passFileName] = fileVersion;
+
+	return retSource;
+}
+
+bool GraniteWorker::openData(std::string passFileName) {
+	GraniteWorkerPool::Metadata sourceMetadata;
+	GraniteInterop * dataSource;
+	std::string openError;
+
+	if ((dataSource = getDataSource(passFileName, &openError)) == NULL) return sendReply(GraniteWorkerPool::ReplyDef::ReplyError, 0, openError);
+
+	sourceMetadata.multiresolution = dataSource->isMultiresolution();
+	sourceMetadata.dimensions = dataSource->getDimensions();
+	// Metadata lists levels in Granite order (full resolution first)
+	for (int levelIdx = dataSource->getLevelCount() - 1 ; levelIdx >= 0 ; levelIdx--) {
+		sourceMetadata.bounds.push_back(std::vector< int >(dataSource->getBounds(levelIdx), dataSource->getBounds(levelIdx) + 6));
+	}
+	for (int attrIdx = 0 ; attrIdx < dataSource->getAttributeCount() ; attrIdx++) {
+		sourceMetadata.attributeNames.push_back(dataSource->getAttributeName(attrIdx));
+	}
+
+	return sendReply(GraniteWorkerPool::ReplyDef::ReplyDone, 0, GraniteWorkerPool::packMetadata(sourceMetadata));
+}
+
+bool GraniteWorker::readData(GraniteWorkerPool::Command & passCommand, std::string passFileName, std::string passSegmentName, std::vector< GraniteWorkerPool::Field > & passFields) {
+	GraniteWorkerPool::SegmentHeader * segmentHeader;
+	GraniteInterop * dataSource;
+	std::string readError;
+	char * segmentBytes;
+	float * fieldValues;
+	long long slicePoints, segmentLength, pointIdx;
+	int segmentHandle, sliceStart, slicesDone, attributeCount;
+	bool replied, cancelled, success;
+
+	if ((dataSource = getDataSource(passFileName, &readError)) == NULL) return sendReply(GraniteWorkerPool::ReplyDef::ReplyError, 0, readError);
+
+	// Map the whole segment, of which only this worker's slices are written
+	if ((segmentHandle = shm_open(passSegmentName.c_str(), O_RDWR, 0600)) < 0) return sendReply(GraniteWorkerPool::ReplyDef::ReplyError, 0, "Unable to open shared memory segment " + passSegmentName);
+	segmentLength = lseek(segmentHandle, 0, SEEK_END);
+	segmentBytes = (char *) mmap(NULL, segmentLength, PROT_READ | PROT_WRITE, MAP_SHARED, segmentHandle, 0);
+	close(segmentHandle);
+	if (segmentBytes == MAP_FAILED) return sendReply(GraniteWorkerPool::ReplyDef::ReplyError, 0, "Unable to map shared memory segment " + passSegmentName);
+
+	segmentHeader = (GraniteWorkerPool::SegmentHeader *) segmentBytes;
+	slicePoints = (long long) (passCommand.bounds[1] - passCommand.bounds[0] + 1) * (passCommand.bounds[3] - passCommand.bounds[2] + 1);
+	sliceStart = passCommand.bounds[4];
+	attributeCount = std::max(1, passCommand.attributeCount);
+	slicesDone = 0;
+	replied = true;
+	cancelled = false;
+
+	// Segment slices are counted from the first slice of the parent's bounds, which precede this worker's range
+	dataSource->setLevel(passCommand.level);
+	success = dataSource->readFloatData(passCommand.bounds, [&](int passSlice, const float * passValues, int passCount) {
+		pointIdx = (passCommand.segmentSlice + passSlice - sliceStart) * slicePoints;
+
+		for (int fieldIdx = 0 ; fieldIdx < passFields.size() ; fieldIdx++) {
+			fieldValues = (float *) (segmentBytes + passFields[fieldIdx].offset) + pointIdx * passFields[fieldIdx].components + passFields[fieldIdx].component;
+
+			for (long long recordIdx = 0 ; recordIdx < slicePoints && (recordIdx + 1) * attributeCount <= passCount ; recordIdx++) {
+				fieldValues[recordIdx * passFields[fieldIdx].components] = passValues[recordIdx * attributeCount + passFields[fieldIdx].attribute];
+			}
+		}
+
+		// Stop between slices once the parent cancels (or disconnects)
+		replied = sendReply(GraniteWorkerPool::ReplyDef::ReplyProgress, ++slicesDone, "");
+		cancelled = (segmentHeader->cancelled != 0);
+
+		return (replied && !cancelled);
+	});
+
+	munmap(segmentBytes, segmentLength);
+	if (replied == false) return false;
+
+	// Cancelled ranges finish early without error
+	if (success == false && cancelled == false) {
+		readError = dataSource->getExceptionMessage();
+		if (readError.empty()) readError = "Unable to read Granite data source " + passFileName;
+
+		return sendReply(GraniteWorkerPool::ReplyDef::ReplyError, 0, readError);
+	}
+
+	return sendReply(GraniteWorkerPool::ReplyDef::ReplyDone, slicesDone, "");
+}
+
+bool GraniteWorker::sendReply(int passType, int passSlices, std::string passPayload) {
+	GraniteWorkerPool::Reply currentReply;
+	std::string replyBuffer;
+
+	currentReply.type = passType;
+	currentReply.slices = passSlices;
+	currentReply.length = passPayload.size();
+
+	replyBuffer.assign((const char *) &currentReply, sizeof(currentReply));
+	replyBuffer += passPayload;
+
+	return GraniteWorkerPool::writeFully(GraniteWorkerPool::WorkerHandle, replyBuffer.data(), replyBuffer.size());
+}
+
+int main(int argc, char * argv[]) {
+	GraniteWorker worker;
+
+	if (worker.parseArguments(argc, argv) == false) return 1;
+
+	return worker.run();
+}
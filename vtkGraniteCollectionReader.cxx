@@ -0,0 +1,301 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: vtkGraniteCollectionReader.cxx
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include "vtkGraniteCollectionReader.h"
+#include "GraniteTrace.h"
+#include "vtkCompositeDataSet.h"
+#include "vtkDataObject.h"
+#include "vtkDirectory.h"
+#include "vtkGlobFileNames.h"
+#include "vtkImageData.h"
+#include "vtkMultiBlockDataSet.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkRectilinearGrid.h"
+
+// VTK Instantiation Macro (Provides NEW definition)
+vtkStandardNewMacro(vtkGraniteCollectionReader);
+
+void vtkGraniteCollectionReader::PrintSelf(ostream& retStream, vtkIndent passIndent) {
+  Superclass::PrintSelf(retStream, passIndent);
+
+  retStream << passIndent << "File Names: " << _fileNames.size() << "\n";
+  for (int fileIdx = 0 ; fileIdx < _openFileNames.size() ; fileIdx++) {
+    retStream << passIndent.GetNextIndent() << _openFileNames[fileIdx] << (_files[fileIdx] ? "" : " (failed)") << "\n";
+  }
+}
+
+void vtkGraniteCollectionReader::addFileName(const char * passName) {
+	if (passName == NULL || strlen(passName) == 0) return;
+
+	_fileNames.push_back(passName);
+
+	this->Modified();
+}
+
+void vtkGraniteCollectionReader::clearFileNames() {
+	if (_fileNames.empty()) return;
+
+	_fileNames.clear();
+
+	this->Modified();
+}
+
+int vtkGraniteCollectionReader::getNumberOfFiles() {
+	return _openFileNames.size();
+}
+
+const char * vtkGraniteCollectionReader::getPerformanceReport() {
+	_performanceReport.clear();
+
+	// One section per file
+	for (int fileIdx = 0 ; fileIdx < _files.size() ; fileIdx++) {
+		if (_files[fileIdx] == NULL) continue;
+
+		_performanceReport += _openFileNames[fileIdx] + ":\n";
+		_performanceReport += _files[fileIdx]->_interop.getCounters()->getReport("  ");
+	}
+
+	// Files share the one JVM
+	for (int fileIdx = 0 ; fileIdx < _files.size() ; fileIdx++) {
+		if (_files[fileIdx] == NULL) continue;
+
+		_performanceReport += _files[fileIdx]->_interop.getJVMReport();
+		break;
+	}
+
+	return _performanceReport.c_str();
+}
+
+void vtkGraniteCollectionReader::resetPerformanceCounters() {
+	for (int fileIdx = 0 ; fileIdx < _files.size() ; fileIdx++) {
+		if (_files[fileIdx]) _files[fileIdx]->_interop.getCounters()->reset();
+	}
+}
+
+vtkGraniteCollectionReader::vtkGraniteCollectionReader() {
+	// Reader requires no input, provides 1 output
+	this->SetNumberOfInputPorts(0);
+	this->SetNumberOfOutputPorts(1);
+}
+
+vtkGraniteCollectionReader::~vtkGraniteCollectionReader() {
+	clearFiles();
+}
+
+int vtkGraniteCollectionReader::RequestInformation(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput) {
+	vtkDebugMacro("*** RequestInformation ***");
+
+	openFiles();
+
+	return 1;
+}
+
+int vtkGraniteCollectionReader::RequestData(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput) {
+	vtkMultiBlockDataSet * outputData;
+	std::vector< vtkDataSet * > fileData;
+	std::string blockName;
+
+	vtkDebugMacro("*** RequestData ***");
+
+	GraniteTrace::Span dataSpan("RequestData", "read", "collection");
+	dataSpan.addArg("files", _files.size());
+
+	outputData = vtkMultiBlockDataSet::GetData(retOutput->GetInformationObject(0));
+
+	// Files are independent, so read them concurrently
+	fileData.assign(_files.size(), NULL);
+	runParallel(_files.size(), [this, &fileData](int passFileIdx) {
+		fileData[passFileIdx] = readFile(passFileIdx);
+	});
+
+	// One block per file, named after the file (empty if it could not be opened)
+	outputData->SetNumberOfBlocks(fileData.size());
+	for (int fileIdx = 0 ; fileIdx < fileData.size() ; fileIdx++) {
+		blockName = _openFileNames[fileIdx].substr(_openFileNames[fileIdx].find_last_of("/\\") + 1);
+
+		outputData->SetBlock(fileIdx, fileData[fileIdx]);
+		outputData->GetMetaData(fileIdx)->Set(vtkCompositeDataSet::NAME(), blockName.c_str());
+		if (fileData[fileIdx]) fileData[fileIdx]->Delete();
+	}
+
+	GraniteTrace::flush();
+
+	return 1;
+}
+
+void vtkGraniteCollectionReader::expandFileNames(std::vector< std::string > * retFileNames) {
+	vtkSmartPointer< vtkDirectory > currentDirectory;
+	vtkSmartPointer< vtkGlobFileNames > currentGlob;
+	std::vector< std::string > matchedNames;
+	std::string currentName, directoryFile;
+
+	retFileNames->clear();
+
+	for (int nameIdx = 0 ; nameIdx < _fileNames.size() ; nameIdx++) {
+		currentName = _fileNames[nameIdx];
+		matchedNames.clear();
+
+		if (vtkDirectory::FileIsDirectory(currentName.c_str())) {
+			// Every XFDL file within directory
+			currentDirectory = vtkSmartPointer< vtkDirectory >::New();
+			if (currentDirectory->Open(currentName.c_str()) == 0) continue;
+			if (currentName.find_last_of("/\\") != currentName.length() - 1) currentName += "/";
+
+			for (vtkIdType fileIdx = 0 ; fileIdx < currentDirectory->GetNumberOfFiles() ; fileIdx++) {
+				directoryFile = currentDirectory->GetFile(fileIdx);
+
+				if (directoryFile.length() > 5 && directoryFile.substr(directoryFile.length() - 5) == ".xfdl") {
+					matchedNames.push_back(currentName + directoryFile);
+				}
+			}
+		}
+		else if (currentName.find_first_of("*?[") != std::string::npos) {
+			// Glob pattern
+			currentGlob = vtkSmartPointer< vtkGlobFileNames >::New();
+			currentGlob->AddFileNames(currentName.c_str());
+
+			for (int fileIdx = 0 ; fileIdx < currentGlob->GetNumberOfFileNames() ; fileIdx++) {
+				matchedNames.push_back(currentGlob->GetNthFileName(fileIdx));
+			}
+		}
+		else {
+			matchedNames.push_back(currentName);
+		}
+
+		// Stable block order regardless of directory listing order
+		std::sort(matchedNames.begin(), matchedNames.end());
+		retFileNames->insert(retFileNames->end(), matchedNames.begin(), matchedNames.end());
+	}
+}
+
+void vtkGraniteCollectionReader::openFiles() {
+	std::vector< std::string > fileNames;
+	std::vector< char > fileOpened;
+
+	expandFileNames(&fileNames);
+
+	// Same files as last update remain open (each reopens itself only if its XFDL changed)
+	if (fileNames != _openFileNames) {
+		clearFiles();
+		_openFileNames = fileNames;
+		_files.assign(_openFileNames.size(), NULL);
+	}
+
+	// Data sources are created here so the JVM is always created on the pipeline thread (files that failed are retried)
+	for (int fileIdx = 0 ; fileIdx < _files.size() ; fileIdx++) {
+		if (_files[fileIdx]) continue;
+
+		_files[fileIdx] = new GraniteShared;
+		_files[fileIdx]->_fileName = _openFileNames[fileIdx];
+	}
+
+	GraniteTrace::Span openSpan("openFiles", "read", "collection");
+	openSpan.addArg("files", _files.size());
+
+	// Metadata discovery of each file runs on its own worker
+	fileOpened.assign(_files.size(), 0);
+	runParallel(_files.size(), [this, &fileOpened](int passFileIdx) {
+		fileOpened[passFileIdx] = _files[passFileIdx]->initialize();
+	});
+
+	for (int fileIdx = 0 ; fileIdx < _files.size() ; fileIdx++) {
+		if (fileOpened[fileIdx]) continue;
+
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to open Granite file " + _openFileNames[fileIdx]).c_str());
+		delete _files[fileIdx];
+		_files[fileIdx] = NULL;
+	}
+}
+
+void vtkGraniteCollectionReader::clearFiles() {
+	for (int fileIdx = 0 ; fileIdx < _files.size() ; fileIdx++) {
+		delete _files[fileIdx];
+	}
+
+	_files.clear();
+	_openFileNames.clear();
+}
+
+vtkDataSet * vtkGraniteCollectionReader::readFile(int passFileIdx) {
+	GraniteShared * currentFile;
+	vtkDataSet * outputData;
+	int dataExtent[6];
+
+	currentFile = _files[passFileIdx];
+	if (currentFile == NULL) return NULL;
+
+	GraniteTrace::Span fileSpan("readFile", "read", currentFile->_fileName.c_str());
+
+	currentFile->_interop.getCounters()->beginOperation();
+
+	// Multiresolution files are read at full resolution
+	currentFile->_interop.setLevel(currentFile->_interop.getLevelCount() - 1);
+	memcpy(dataExtent, currentFile->_interop.getBounds(), sizeof(dataExtent));
+
+	if (currentFile->_dataType == "vtkRectilinearGrid") {
+		outputData = vtkRectilinearGrid::New();
+		((vtkRectilinearGrid *) outputData)->SetExtent(dataExtent);
+		((vtkRectilinearGrid *) outputData)->SetXCoordinates(currentFile->_grid[0]);
+		((vtkRectilinearGrid *) outputData)->SetYCoordinates(currentFile->_grid[1]);
+		((vtkRectilinearGrid *) outputData)->SetZCoordinates(currentFile->_grid[2]);
+	}
+	else {
+		outputData = vtkImageData::New();
+		((vtkImageData *) outputData)->SetExtent(dataExtent);
+		((vtkImageData *) outputData)->SetOrigin(currentFile->_origin);
+		((vtkImageData *) outputData)->SetSpacing(&currentFile->_spacing.back()[0]);
+	}
+
+	// Arrays and components, then data through the shared extent cache
+	currentFile->readFieldData(outputData->GetPointData(), false);
+	// Failed (or cancelled) reads output no arrays rather than partially filled ones, as vtkGraniteReader does
+	if (currentFile->readExtent(dataExtent, outputData->GetPointData()) == false) {
+		outputData->GetPointData()->Initialize();
+	}
+
+	return outputData;
+}
+
+void vtkGraniteCollectionReader::runParallel(int passCount, std::function< void(int) > passTask) {
+	std::vector< std::thread > taskWorkers;
+	std::atomic< int > nextTask;
+	int workerCount;
+
+	// Calling thread takes tasks too
+	nextTask = 0;
+	workerCount = std::min< int >(passCount, std::max< int >(1, std::thread::hardware_concurrency())) - 1;
+
+	for (int workerIdx = 0 ; workerIdx < workerCount ; workerIdx++) {
+		taskWorkers.push_back(std::thread([passCount, &passTask, &nextTask] {
+			for (int taskIdx = nextTask++ ; taskIdx < passCount ; taskIdx = nextTask++) {
+				passTask(taskIdx);
+			}
+
+			// Workers attached to the JVM by their JNI calls must detach before exiting
+			GraniteInterop::detachThread();
+		}));
+	}
+
+	for (int taskIdx = nextTask++ ; taskIdx < passCount ; taskIdx = nextTask++) {
+		passTask(taskIdx);
+	}
+
+	for (int workerIdx = 0 ; workerIdx < taskWorkers.size() ; workerIdx++) {
+		taskWorkers[workerIdx].join();
+	}
+}
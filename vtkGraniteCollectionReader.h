@@ -0,0 +1,62 @@
+/*=========================================================================
+
+ Program: Granite Plugin for Paraview
+ Module: vtkGraniteCollectionReader.h
+ Author: Toni Westbrook
+
+ Please see the included README file for full description,
+ build/installation instructions, and known issues.
+
+ =========================================================================*/
+
+#ifndef __vtkGraniteCollectionReader_h
+#define __vtkGraniteCollectionReader_h
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "GraniteShared.h"
+#include "vtkMultiBlockDataSetAlgorithm.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+
+class vtkGraniteCollectionReader : public vtkMultiBlockDataSetAlgorithm {
+	public:
+		// VTK Setup
+		static vtkGraniteCollectionReader * New(); // VTK NEW with reference count tracking
+		vtkTypeMacro(vtkGraniteCollectionReader, vtkMultiBlockDataSetAlgorithm); // Type conversion to VTK datatype
+		void PrintSelf(ostream& retStream, vtkIndent passIndent); // Debug print
+
+		// GUI methods (See Granite.xml)
+		void addFileName(const char * passName); // XFDL file, directory (all XFDL files within) or glob pattern
+		void clearFileNames();
+		int getNumberOfFiles(); // Files opened by last update
+		const char * getPerformanceReport(); // Hot path counters, phase timers and memory peaks of each file, then the shared JVM
+		void resetPerformanceCounters();
+
+	protected:
+		vtkGraniteCollectionReader();
+		~vtkGraniteCollectionReader();
+
+		// VTK Pipeline methods
+		int RequestInformation(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput);
+		int RequestData(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput);
+
+	private:
+		vtkGraniteCollectionReader(const vtkGraniteCollectionReader&);  // Not implemented per VTK standard
+		void operator=(const vtkGraniteCollectionReader&);  // Not implemented per VTK standard
+
+		void expandFileNames(std::vector< std::string > * retFileNames); // Resolve directories and globs to XFDL files
+		void openFiles(); // Open (or reuse) a data source per file, concurrently
+		void clearFiles();
+		vtkDataSet * readFile(int passFileIdx); // Full extent of one file at full resolution
+		void runParallel(int passCount, std::function< void(int) > passTask); // Run task for each index across worker threads
+
+		std::vector< std::string > _fileNames; // Names, directories and patterns as given
+		std::vector< std::string > _openFileNames; // Resolved XFDL files (one block each)
+		std::vector< GraniteShared * > _files; // Open data source per resolved file (NULL if it failed to open)
+		std::string _performanceReport; // Storage for last report returned
+};
+
+#endif // __vtkGraniteCollectionReader_h
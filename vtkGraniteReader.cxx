@@ -10,13 +10,19 @@
  =========================================================================*/
 
 #include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <string>
+#include <sstream>
 #include <memory>
 
 #include "vtkGraniteReader.h"
+#include "GraniteTrace.h"
 #include "vtkDataObject.h"
 #include "vtkImageData.h"
 #include "vtkRectilinearGrid.h"
+#include "vtkSmartPointer.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
@@ -25,9 +31,14 @@
 vtkStandardNewMacro(vtkGraniteReader);
 
 void vtkGraniteReader::PrintSelf(ostream& retStream, vtkIndent passIndent) {
+  std::ostringstream indentStream;
+
   Superclass::PrintSelf(retStream, passIndent);
 
   retStream << passIndent << "File Name: " << (_graniteInfo._fileName != "" ? _graniteInfo._fileName : "(none)") << "\n";
+  retStream << passIndent << "Performance Counters:\n";
+  indentStream << passIndent.GetNextIndent();
+  retStream << _graniteInfo._interop.getCounters()->getReport(indentStream.str().c_str());
 }
 
 int vtkGraniteReader::CanReadFile(const char * passName) {
@@ -36,9 +47,7 @@ int vtkGraniteReader::CanReadFile(const char * passName) {
 	// Check validity of file
 	if (_graniteInfo.initialize(passName) == false) return 0;
 
-	// Only activate standard reader for single resolution data
-	if (_graniteInfo._interop.isMultiresolution()) return 0;
-
+	// Multiresolution data is read one level at a time (see ResolutionLevel)
 	return 1;
 }
 
@@ -68,10 +77,142 @@ void vtkGraniteReader::setVOIBounds(int passXLow, int passXHigh, int passYLow, i
 	this->Modified();
 }
 
+void vtkGraniteReader::setResolutionLevel(int passLevel) {
+	if (passLevel == _resolutionLevel) return;
+
+	// Extents differ per level, so any VOI no longer applies
+	_resolutionLevel = passLevel;
+	_graniteInfo._voiOverride = false;
+
+	this->Modified();
+}
+
+int vtkGraniteReader::getResolutionLevel() {
+	return _resolutionLevel;
+}
+
+int vtkGraniteReader::getResolutionLevelCount() {
+	return _graniteInfo._interop.getLevelCount();
+}
+
+void vtkGraniteReader::setKeepQuantized(bool passKeep) {
+	if (passKeep == _graniteInfo._keepQuantized) return;
+
+	_graniteInfo._keepQuantized = passKeep;
+
+	this->Modified();
+}
+
+bool vtkGraniteReader::getKeepQuantized() {
+	return _graniteInfo._keepQuantized;
+}
+
+void vtkGraniteReader::setSliceMode(bool passEnabled) {
+	if (passEnabled == _sliceMode) return;
+
+	// Prefetched slices are released when leaving slice mode
+	_sliceMode = passEnabled;
+	if (_sliceMode == false) _slicePrefetch.clear();
+
+	this->Modified();
+}
+
+bool vtkGraniteReader::getSliceMode() {
+	return _sliceMode;
+}
+
+void vtkGraniteReader::setSliceAxis(int passAxis) {
+	passAxis = std::max(0, std::min(passAxis, 2));
+	if (passAxis == _sliceAxis) return;
+
+	_sliceAxis = passAxis;
+
+	this->Modified();
+}
+
+int vtkGraniteReader::getSliceAxis() {
+	return _sliceAxis;
+}
+
+void vtkGraniteReader::setSliceIndex(int passIndex) {
+	if (passIndex == _sliceIndex) return;
+
+	// Only the reported extent changes - the data source stays open
+	_sliceIndex = passIndex;
+
+	this->Modified();
+}
+
+int vtkGraniteReader::getSliceIndex() {
+	return _sliceIndex;
+}
+
+void vtkGraniteReader::setSlicePrefetch(int passRadius) {
+	if (passRadius == _slicePrefetchRadius) return;
+
+	_slicePrefetchRadius = std::max(0, passRadius);
+	if (_slicePrefetchRadius == 0) _slicePrefetch.clear();
+
+	this->Modified();
+}
+
+int vtkGraniteReader::getSlicePrefetch() {
+	return _slicePrefetchRadius;
+}
+
+int vtkGraniteReader::GetNumberOfPointArrays() {
+	return _graniteInfo._arraySelection->GetNumberOfArrays();
+}
+
+const char * vtkGraniteReader::GetPointArrayName(int passIndex) {
+	return _graniteInfo._arraySelection->GetArrayName(passIndex);
+}
+
+int vtkGraniteReader::GetPointArrayStatus(const char * passName) {
+	return _graniteInfo._arraySelection->ArrayIsEnabled(passName);
+}
+
+void vtkGraniteReader::SetPointArrayStatus(const char * passName, int passStatus) {
+	if (passStatus == GetPointArrayStatus(passName)) return;
+
+	if (passStatus) _graniteInfo._arraySelection->EnableArray(passName);
+	else _graniteInfo._arraySelection->DisableArray(passName);
+
+	this->Modified();
+}
+
+const char * vtkGraniteReader::getPerformanceReport() {
+	_performanceReport = _graniteInfo._interop.getCounters()->getReport();
+	_performanceReport += _graniteInfo._interop.getJVMReport();
+
+	return _performanceReport.c_str();
+}
+
+void vtkGraniteReader::resetPerformanceCounters() {
+	_graniteInfo._interop.getCounters()->reset();
+}
+
+const char * vtkGraniteReader::getMemoryEstimate() {
+	return _memoryEstimate.c_str();
+}
+
 vtkGraniteReader::vtkGraniteReader() {
 	// Reader requires no input, provides 1 output
 	this->SetNumberOfInputPorts(0);
 	this->SetNumberOfOutputPorts(1);
+
+	_resolutionLevel = 0;
+	_informationLevel = 0;
+	_sliceMode = false;
+	_sliceAxis = 2;
+	_sliceIndex = 0;
+	_slicePrefetchRadius = 4;
+
+	// Reads report progress per slice, and stop at the next slice once the pipeline aborts
+	_graniteInfo._progress = [this](double passFraction) {
+		this->UpdateProgress(passFraction);
+		return !this->GetAbortExecute();
+	};
 }
 
 int vtkGraniteReader::ProcessRequest(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput) {
@@ -95,12 +236,17 @@ int vtkGraniteReader::RequestInformation(vtkInformation * passRequest, vtkInform
 	vtkInformation * outputInfo;
 	vtkDataSet * outputData;
 	int * dataExtent;
+	int sliceExtent[6];
 
 	vtkDebugMacro("*** RequestInformation ***");
 
 	// Obtain output information and data
 	outputInfo = retOutput->GetInformationObject(0);
 	outputData = vtkDataSet::SafeDownCast(outputInfo->Get(vtkDataObject::DATA_OBJECT()));
+
+	// Report extents for requested resolution level
+	_informationLevel = convertResolutionLevel(_resolutionLevel);
+	_graniteInfo._interop.setLevel(_informationLevel);
 	
 	// Set to VOI if specified, else full data extents
 	if (_graniteInfo._voiOverride) {
@@ -111,10 +257,24 @@ int vtkGraniteReader::RequestInformation(vtkInformation * passRequest, vtkInform
 		outputInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), dataExtent, 6);
 		setVOIBounds(dataExtent[0], dataExtent[1], dataExtent[2], dataExtent[3], dataExtent[4], dataExtent[5]);
 	}
+
+	// Slice mode reports a single slice of the VOI along the axis (a 2D image)
+	if (_sliceMode) {
+		memcpy(sliceExtent, _graniteInfo._voiBounds, sizeof(sliceExtent));
+		sliceExtent[2 * _sliceAxis] = std::max(sliceExtent[2 * _sliceAxis], std::min(_sliceIndex, sliceExtent[2 * _sliceAxis + 1]));
+		sliceExtent[2 * _sliceAxis + 1] = sliceExtent[2 * _sliceAxis];
+		outputInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), sliceExtent, 6);
+	}
 	
 	// Set common attributes
 	outputInfo->Set(vtkDataObject::ORIGIN(), _graniteInfo._origin, 3);
-	outputInfo->Set(vtkDataObject::SPACING(), &_graniteInfo._spacing.back()[0], 3);
+	outputInfo->Set(vtkDataObject::SPACING(), &_graniteInfo._spacing.at(_informationLevel)[0], 3);
+
+	// Array ranges from write-time statistics, so no data needs to be read to obtain them
+	_graniteInfo.writeFieldRanges(outputInfo, vtkDataObject::FIELD_ASSOCIATION_POINTS);
+
+	// Memory a read would need, so VOI or level can be chosen before any data is read
+	estimateMemory();
 
 	return 1;	
 }
@@ -124,10 +284,17 @@ int vtkGraniteReader::RequestData(vtkInformation * passRequest, vtkInformationVe
 	vtkDataSet * outputData;
 	vtkPointData * pointData;
 	vtkDataArray * dataArray;
+	vtkSmartPointer< vtkDoubleArray > levelCoordinates[3];
+	vtkDoubleArray * coordinateArrays[3];
 	int dataExtent[6];
+	int currentLevel;
+	bool mapData;
 	
 	vtkDebugMacro("*** RequestData ***");
 
+	GraniteTrace::Span dataSpan("RequestData", "read", _graniteInfo._fileName.c_str());
+	_graniteInfo._interop.getCounters()->beginOperation();
+
 	// Obtain output information and data
 	outputInfo = retOutput->GetInformationObject(0);
 	outputData = vtkDataSet::SafeDownCast(outputInfo->Get(vtkDataObject::DATA_OBJECT()));
@@ -136,25 +303,122 @@ int vtkGraniteReader::RequestData(vtkInformation * passRequest, vtkInformationVe
 
 	// Set extents and spacing
 	outputInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(), dataExtent);	
-	if (outputData->IsA("vtkImageData")) ((vtkImageData *) outputData)->SetExtent(dataExtent);
-	if (outputData->IsA("vtkRectilinearGrid")) ((vtkRectilinearGrid *) outputData)->SetExtent(dataExtent);
 
-	// Allocate arrays and components
-	_graniteInfo.readFieldData(pointData);
+	// Streaming may request a coarser level than reported (never finer)
+	currentLevel = _informationLevel;
+	if (outputInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_RESOLUTION())) {
+		currentLevel = std::min(currentLevel, convertUpdateResolution(outputInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_RESOLUTION())));
+	}
+
+	if (currentLevel != _informationLevel) scaleExtent(dataExtent, _informationLevel, currentLevel);
+	if (_sliceMode) dataExtent[2 * _sliceAxis + 1] = dataExtent[2 * _sliceAxis];
+	_graniteInfo._interop.setLevel(currentLevel);
+	dataSpan.addArg("level", currentLevel);
 
-	// Set grid spacing for vtkRectilinearGrid
+	if (outputData->IsA("vtkImageData")) {
+		((vtkImageData *) outputData)->SetExtent(dataExtent);
+		((vtkImageData *) outputData)->SetSpacing(&_graniteInfo._spacing.at(currentLevel)[0]);
+	}
+	if (outputData->IsA("vtkRectilinearGrid")) ((vtkRectilinearGrid *) outputData)->SetExtent(dataExtent);
+
+	// Set grid spacing for vtkRectilinearGrid (coordinates of the extent at the level read, not the full resolution grid)
 	if (outputData->IsA("vtkRectilinearGrid")) {
-		((vtkRectilinearGrid *) outputData)->SetXCoordinates(_graniteInfo._grid[0]);
-		((vtkRectilinearGrid *) outputData)->SetYCoordinates(_graniteInfo._grid[1]);
-		((vtkRectilinearGrid *) outputData)->SetZCoordinates(_graniteInfo._grid[2]);
+		for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+			levelCoordinates[dimIdx] = vtkSmartPointer< vtkDoubleArray >::New();
+			coordinateArrays[dimIdx] = levelCoordinates[dimIdx];
+		}
+
+		_graniteInfo.getCoordinates(currentLevel, dataExtent, coordinateArrays);
+		((vtkRectilinearGrid *) outputData)->SetXCoordinates(coordinateArrays[0]);
+		((vtkRectilinearGrid *) outputData)->SetYCoordinates(coordinateArrays[1]);
+		((vtkRectilinearGrid *) outputData)->SetZCoordinates(coordinateArrays[2]);
+	}
+
+	// Slices read ahead are output as they are
+	if (_sliceMode && _slicePrefetch.take(&_graniteInfo, _sliceAxis, dataExtent[2 * _sliceAxis], pointData)) {
+		_graniteInfo._interop.getCounters()->increment(GraniteCounters::SlicePrefetchHits);
+		dataSpan.addArg("prefetched", 1);
+	}
+	else {
+		// Full extent of host ordered planar float storage can be mapped rather than copied
+		mapData = _graniteInfo.isMappable(dataExtent, _graniteInfo._interop.getBounds());
+
+		// Create arrays and components (sized by the mapping or extent cache)
+		_graniteInfo.readFieldData(pointData, false);
+
+		// Copy data from Granite (or native storage) for specified extents, cropping previously read extents where possible
+		if (mapData) _graniteInfo.selectStorageLevel();
+		if (mapData == false || _graniteInfo._storage.mapFloatData(dataExtent, pointData, _graniteInfo._interop.getCounters()) == false) {
+			// Cancelled (or failed) reads output no arrays rather than partially filled ones (nor prefetch around them)
+			if (_graniteInfo.readExtent(dataExtent, pointData) == false) {
+				pointData->Initialize();
+				GraniteTrace::flush();
+
+				return 1;
+			}
+		}
 	}
 
-	// Copy data from Granite for specified extents
-	_graniteInfo._interop.copyFloatData(dataExtent, pointData);
+	// Neighbouring slices are read in the background while this one is shown
+	if (_sliceMode) _slicePrefetch.prefetch(&_graniteInfo, dataExtent, _sliceAxis, _slicePrefetchRadius);
+	GraniteTrace::flush();
 
 	return 1;
 }
 
+int vtkGraniteReader::convertResolutionLevel(int passLevel) {
+	// Granite level 0 (full resolution) is the highest VTK level
+	passLevel = std::max(0, std::min(passLevel, _graniteInfo._interop.getLevelCount() - 1));
+
+	return _graniteInfo._interop.getLevelCount() - 1 - passLevel;
+}
+
+int vtkGraniteReader::convertUpdateResolution(double passResolution) {
+	passResolution = std::max(0.0, std::min(passResolution, 1.0));
+
+	return (int) (passResolution * (_graniteInfo._interop.getLevelCount() - 1) + 0.5);
+}
+
+void vtkGraniteReader::scaleExtent(int * retExtent, int passFromLevel, int passToLevel) {
+	int * fromBounds, * toBounds;
+	double scale;
+
+	// Cached bounds of each level (no level switch needed)
+	fromBounds = _graniteInfo._interop.getBounds(passFromLevel);
+	toBounds = _graniteInfo._interop.getBounds(passToLevel);
+
+	// Keep the same spatial region, widening to whole points of the target level
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		scale = (double) (toBounds[2 * dimIdx + 1] - toBounds[2 * dimIdx] + 1) / (fromBounds[2 * dimIdx + 1] - fromBounds[2 * dimIdx] + 1);
+		retExtent[2 * dimIdx] = toBounds[2 * dimIdx] + (int) floor((retExtent[2 * dimIdx] - fromBounds[2 * dimIdx]) * scale);
+		retExtent[2 * dimIdx + 1] = toBounds[2 * dimIdx] + (int) ceil((retExtent[2 * dimIdx + 1] - fromBounds[2 * dimIdx]) * scale);
+		retExtent[2 * dimIdx + 1] = std::min(retExtent[2 * dimIdx + 1], toBounds[2 * dimIdx + 1]);
+	}
+}
+
+void vtkGraniteReader::estimateMemory() {
+	int levelBounds[6];
+	int vtkLevel;
+	long long arrayBytes, peakBytes;
+
+	_memoryEstimate.clear();
+
+	// Reported VOI carried to each level as streaming would request it
+	for (int levelIdx = 0 ; levelIdx < _graniteInfo._interop.getLevelCount() ; levelIdx++) {
+		vtkLevel = convertResolutionLevel(levelIdx);
+		memcpy(levelBounds, _graniteInfo._voiBounds, sizeof(levelBounds));
+		if (vtkLevel != _informationLevel) scaleExtent(levelBounds, _informationLevel, vtkLevel);
+
+		peakBytes = _graniteInfo.estimateReadBytes(levelBounds, _graniteInfo._interop.getBounds(vtkLevel), 0, &arrayBytes);
+
+		_memoryEstimate += "Level " + std::to_string(levelIdx) + ": ";
+		for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+			_memoryEstimate += std::to_string(levelBounds[2 * dimIdx + 1] - levelBounds[2 * dimIdx] + 1) + (dimIdx < 2 ? " x " : " points, ");
+		}
+		_memoryEstimate += std::to_string(arrayBytes) + " array bytes, " + std::to_string(peakBytes) + " peak bytes" + (vtkLevel == _informationLevel ? " (selected)\n" : "\n");
+	}
+}
+
 int vtkGraniteReader::FillOutputPortInformation(int passPort, vtkInformation * passInfo) {
 	// Open data source and read ParaView specific metadata
 	if (_graniteInfo.initialize() == false) return 0;
@@ -13,6 +13,7 @@
 #define __vtkGraniteReader_h
 
 #include "GraniteShared.h"
+#include "GraniteSlicePrefetch.h"
 #include "vtkAlgorithm.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
@@ -29,6 +30,26 @@ class vtkGraniteReader : public vtkAlgorithm {
 		const char * getFileName();
 		void setFileName(const char * passName);
 		void setVOIBounds(int passXLow, int passXHigh, int passYLow, int passYHigh, int passZLow, int passZHigh);
+		void setResolutionLevel(int passLevel); // Multiresolution level to read (0 is full resolution, increasing is coarser)
+		int getResolutionLevel();
+		int getResolutionLevelCount();
+		void setKeepQuantized(bool passKeep); // Read quantized fields as their 8/16 bit codes rather than floats
+		bool getKeepQuantized();
+		void setSliceMode(bool passEnabled); // Output a single slice (SliceAxis/SliceIndex) rather than the VOI
+		bool getSliceMode();
+		void setSliceAxis(int passAxis); // 0 for x, 1 for y, 2 for z
+		int getSliceAxis();
+		void setSliceIndex(int passIndex); // Point index along the axis, at the reported resolution level (clamped to the VOI)
+		int getSliceIndex();
+		void setSlicePrefetch(int passRadius); // Neighbouring slices read ahead either side of the current one (0 disables)
+		int getSlicePrefetch();
+		int GetNumberOfPointArrays(); // Point array selection (named as ParaView's array selection helpers expect)
+		const char * GetPointArrayName(int passIndex);
+		int GetPointArrayStatus(const char * passName);
+		void SetPointArrayStatus(const char * passName, int passStatus); // Disabled arrays are not read (nor their planes, from planar native storage)
+		const char * getPerformanceReport(); // Hot path counters, phase timers and memory peaks
+		void resetPerformanceCounters();
+		const char * getMemoryEstimate(); // Bytes a read would hold at each resolution level for the current VOI (from metadata, updated by RequestInformation)
 
 	protected:
 		vtkGraniteReader();
@@ -42,8 +63,22 @@ class vtkGraniteReader : public vtkAlgorithm {
 	private:
 		vtkGraniteReader(const vtkGraniteReader&);  // Not implemented per VTK standard
 		void operator=(const vtkGraniteReader&);  // Not implemented per VTK standard
+
+		int convertResolutionLevel(int passLevel); // Convert ResolutionLevel property (0 full, Granite ordering) to VTK level ordering (clamped)
+		int convertUpdateResolution(double passResolution); // Convert streaming UPDATE_RESOLUTION (0 coarsest, 1 full) to VTK level ordering
+		void scaleExtent(int * retExtent, int passFromLevel, int passToLevel); // Scale extent between VTK levels
+		void estimateMemory(); // Build memory estimate for every level
 		
 		GraniteShared _graniteInfo;
+		int _resolutionLevel; // Requested resolution level (0 is full resolution)
+		int _informationLevel; // VTK level whole extent and spacing were reported for
+		std::string _performanceReport; // Storage for last report returned
+		std::string _memoryEstimate; // One line per resolution level
+		bool _sliceMode; // Output one slice along _sliceAxis
+		int _sliceAxis;
+		int _sliceIndex; // Requested slice (clamped when reported)
+		int _slicePrefetchRadius; // Slices read ahead either side
+		GraniteSlicePrefetch _slicePrefetch; // Slices around the last one output
 };
 
 #endif // __vtkGraniteReader_h
\ No newline at end of file
@@ -9,22 +9,35 @@
  
  =========================================================================*/
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <sstream>
 
 #include "vtkGraniteReaderAMR.h"
+#include "GraniteTrace.h"
 #include "vtkObjectFactory.h"
 #include "vtkUniformGrid.h"
 #include "vtkOverlappingAMR.h"
 #include "vtkAMRBox.h"
+#include "vtkAMRInformation.h"
 #include "vtkDataArraySelection.h"
 #include "vtkDoubleArray.h"
 #include "vtkCellData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkSMPTools.h"
 
 // VTK Instantiation Macro (Provides NEW definition)
 vtkStandardNewMacro(vtkGraniteReaderAMR);
 
 void vtkGraniteReaderAMR::PrintSelf(ostream& retStream, vtkIndent passIndent) {
+  std::ostringstream indentStream;
+
   retStream << passIndent << "File Name: " << (_graniteInfo._fileName != "" ? _graniteInfo._fileName : "(none)") << "\n";
+  retStream << passIndent << "Performance Counters:\n";
+  indentStream << passIndent.GetNextIndent();
+  retStream << _graniteInfo._interop.getCounters()->getReport(indentStream.str().c_str());
 }
 
 int vtkGraniteReaderAMR::CanReadFile(const char * passName) {
@@ -59,12 +72,78 @@ void vtkGraniteReaderAMR::SetFileName(const char * passName) {
 	setFileName(passName);
 }
 
+void vtkGraniteReaderAMR::setValueRangeCulling(bool passEnabled) {
+	_cullingEnabled = passEnabled;
+
+	this->Modified();
+}
+
+void vtkGraniteReaderAMR::setValueRange(double passMinimum, double passMaximum) {
+	_cullingRange[0] = passMinimum;
+	_cullingRange[1] = passMaximum;
+
+	this->Modified();
+}
+
+const char * vtkGraniteReaderAMR::getPerformanceReport() {
+	_performanceReport = _graniteInfo._interop.getCounters()->getReport();
+	_performanceReport += _graniteInfo._interop.getJVMReport();
+
+	return _performanceReport.c_str();
+}
+
+void vtkGraniteReaderAMR::resetPerformanceCounters() {
+	_graniteInfo._interop.getCounters()->reset();
+}
+
+const char * vtkGraniteReaderAMR::getMemoryEstimate() {
+	return _memoryEstimate.c_str();
+}
+
 vtkGraniteReaderAMR::vtkGraniteReaderAMR() {
+  _cullingEnabled = false;
+  _cullingRange[0] = 0;
+  _cullingRange[1] = 0;
+  _blocksRequested = 0;
+  _blocksLoaded = 0;
+  _progressBase = 0;
+  _progressSpan = 0;
+
+  // Fetches report progress across the request's blocks (never moving backwards), and stop at the next slice once aborted
+  _graniteInfo._progress = [this](double passFraction) {
+    this->UpdateProgress(std::max(this->GetProgress(), std::min(1.0, _progressBase + passFraction * _progressSpan)));
+    return !this->GetAbortExecute();
+  };
+
   this->Initialize();
 }
 
 vtkGraniteReaderAMR::~vtkGraniteReaderAMR() { }
 
+int vtkGraniteReaderAMR::RequestInformation(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput) {
+	if (Superclass::RequestInformation(passRequest, passInput, retOutput) == 0) return 0;
+
+	// Array range from write-time statistics (AMR reader exposes the single attribute as cell data)
+	_graniteInfo.writeFieldRanges(retOutput->GetInformationObject(0), vtkDataObject::FIELD_ASSOCIATION_CELLS, "Granite Values");
+	estimateMemory();
+
+	return 1;
+}
+
+int vtkGraniteReaderAMR::RequestData(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput) {
+	int retValue;
+
+	// Level fetches, progress and memory accounting cover the blocks of one request only
+	clearStaged();
+	_graniteInfo._interop.getCounters()->beginOperation();
+	_blocksRequested = 0;
+	_blocksLoaded = 0;
+	retValue = Superclass::RequestData(passRequest, passInput, retOutput);
+	clearStaged();
+
+	return retValue;
+}
+
 int vtkGraniteReaderAMR::FillMetaData() {
 	int levelCount, blockLevelCount;
 	std::vector< int > blocksLevel;
@@ -85,6 +164,10 @@ int vtkGraniteReaderAMR::FillMetaData() {
 	this->Metadata->SetGridDescription(VTK_XYZ_GRID);
 	this->Metadata->SetOrigin(_graniteInfo._origin);
 
+	// Block ranges are learned again for the (possibly different) data set
+	_blockRanges.assign(2 * levelCount * blockLevelCount, NAN);
+	clearStaged();
+
 	// Set bounds and resolution per block
 	for (int blockIdx = 0 ; blockIdx < levelCount * blockLevelCount  ; blockIdx++) {
 		// Calculate level and bounds from block ID
@@ -159,13 +242,41 @@ int vtkGraniteReaderAMR::GetBlockLevel( const int blockIdx ) {
 }
 
 void vtkGraniteReaderAMR::GetAMRGridData(const int blockIdx, vtkUniformGrid *block, const char *field) {
+	std::map< int, vtkSmartPointer< vtkDoubleArray > >::iterator stagedIter;
 	int currentLevel, currentBounds[6];
+	double fillValue;
 	vtkDoubleArray * dataArray;
 
 	vtkDebugMacro("*** GetAMRGridData ***");
 
+	GraniteCounters::ScopedTimer blockTimer(_graniteInfo._interop.getCounters(), GraniteCounters::TimeBlockRead);
+	GraniteTrace::Span blockSpan("GetAMRGridData", "amr");
+
 	// Calculate level and bounds from block ID
 	_graniteInfo.getAMRBlock(blockIdx, &currentLevel, currentBounds);
+	blockSpan.addArg("block", blockIdx);
+	blockSpan.addArg("level", currentLevel);
+
+	// Aborted requests leave remaining blocks without data
+	if (this->GetAbortExecute()) return;
+
+	if (_blocksRequested == 0) countRequested();
+	_progressBase = (double) _blocksLoaded++ / _blocksRequested;
+	_progressSpan = 1.0 / _blocksRequested;
+
+	// Requested blocks of a level are fetched together when the first of them is loaded
+	if (_stagedLevels.find(currentLevel) == _stagedLevels.end()) stageLevel(currentLevel);
+
+	if ((stagedIter = _stagedBlocks.find(blockIdx)) != _stagedBlocks.end()) {
+		dataArray = stagedIter->second;
+		dataArray->SetName(field);
+		block->GetCellData()->AddArray(dataArray);
+		if (blockIdx < _blockRanges.size() / 2) dataArray->GetRange(&_blockRanges[2 * blockIdx], 0);
+
+		_stagedBlocks.erase(stagedIter);
+
+		return;
+	}
 	
 	// Select level
 	_graniteInfo._interop.setLevel(currentLevel);
@@ -175,11 +286,242 @@ void vtkGraniteReaderAMR::GetAMRGridData(const int blockIdx, vtkUniformGrid *blo
 	dataArray->SetName(field);
 	dataArray->SetNumberOfComponents(1);
 	dataArray->SetNumberOfTuples(_graniteInfo.getVolumeSize(blockIdx));
+	_graniteInfo._interop.getCounters()->allocate(GraniteCounters::MemoryArrays, (long long) _graniteInfo.getVolumeSize(blockIdx) * sizeof(double));
 
 	block->GetCellData()->AddArray(dataArray);
+	dataArray->Delete();
+
+	// Blocks that cannot intersect the value range are filled with a constant outside of it rather than fetched
+	if (isBlockCulled(blockIdx, &fillValue)) {
+		dataArray->FillComponent(0, fillValue);
+		_graniteInfo._interop.getCounters()->increment(GraniteCounters::BlocksCulled);
+
+		return;
+	}
+
+	// Copy float data (a cancelled block keeps no partially filled array)
+	_graniteInfo._interop.getCounters()->increment(GraniteCounters::BlocksFetched);
+	if (_graniteInfo.fetchData(currentBounds, block->GetCellData()) == false) {
+		block->GetCellData()->RemoveArray(field);
+		_graniteInfo._interop.getCounters()->release(GraniteCounters::MemoryArrays, (long long) _graniteInfo.getVolumeSize(blockIdx) * sizeof(double));
+		return;
+	}
+	GraniteTrace::flush();
+
+	// Cache actual range of block
+	if (blockIdx < _blockRanges.size() / 2) {
+		dataArray->GetRange(&_blockRanges[2 * blockIdx], 0);
+	}
+}
+
+bool vtkGraniteReaderAMR::isBlockCulled(int passBlockID, double * retFill) {
+	double blockRange[2];
+
+	if (!_cullingEnabled || !getBlockRange(passBlockID, blockRange)) return false;
+	if (blockRange[1] >= _cullingRange[0] && blockRange[0] <= _cullingRange[1]) return false;
+
+	*retFill = (blockRange[1] < _cullingRange[0] ? blockRange[1] : blockRange[0]);
+
+	return true;
+}
+
+void vtkGraniteReaderAMR::stageLevel(int passLevel) {
+	std::vector< int > levelBlocks;
+	std::vector< std::vector< int > > blockBounds;
+	std::vector< vtkDoubleArray * > blockArrays;
+	vtkSmartPointer< vtkCellData > levelData;
+	vtkSmartPointer< vtkDoubleArray > levelArray;
+	int currentLevel, currentBounds[6], coverBounds[6], fetchBounds[6];
+	int blockID;
+	long long blockPoints, coverPoints;
+	double fillValue;
+
+	_stagedLevels.insert(passLevel);
+
+	// Requested blocks of this level loaded by this process, less those culled (which are never read)
+	blockPoints = 0;
+	for (int mapIdx = 0 ; mapIdx < this->BlockMap.size() ; mapIdx++) {
+		if (!this->IsBlockMine(mapIdx)) continue;
+
+		blockID = this->Metadata->GetAMRInfo()->GetAMRBlockSourceIndex(this->BlockMap[mapIdx]);
+		_graniteInfo.getAMRBlock(blockID, &currentLevel, currentBounds);
+		if (currentLevel != passLevel || isBlockCulled(blockID, &fillValue)) continue;
+
+		if (levelBlocks.empty()) memcpy(coverBounds, currentBounds, sizeof(coverBounds));
+
+		for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+			coverBounds[2 * dimIdx] = std::min(coverBounds[2 * dimIdx], currentBounds[2 * dimIdx]);
+			coverBounds[2 * dimIdx + 1] = std::max(coverBounds[2 * dimIdx + 1], currentBounds[2 * dimIdx + 1]);
+		}
+
+		levelBlocks.push_back(blockID);
+		blockBounds.push_back(std::vector< int >(currentBounds, currentBounds + 6));
+		blockPoints += _graniteInfo.getVolumeSize(blockID);
+	}
+
+	if (levelBlocks.size() < 2) return;
+
+	coverPoints = 1;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		coverPoints *= coverBounds[2 * dimIdx + 1] - coverBounds[2 * dimIdx] + 1;
+	}
+
+	// Coalescing only pays when the blocks fill most of the extent covering them (scattered blocks are fetched alone)
+	if (blockPoints < coverPoints / 2) return;
+
+	GraniteTrace::Span stageSpan("stageLevel", "amr");
+	stageSpan.addArg("level", passLevel);
+	stageSpan.addArg("blocks", (int) levelBlocks.size());
+
+	// One fetch of the covering extent (slices and bounds objects shared by every block)
+	levelData = vtkSmartPointer< vtkCellData >::New();
+	levelArray = vtkSmartPointer< vtkDoubleArray >::New();
+	levelArray->SetNumberOfComponents(1);
+	levelArray->SetNumberOfTuples(coverPoints);
+	levelData->AddArray(levelArray);
+	GraniteCounters::ScopedMemory levelMemory(_graniteInfo._interop.getCounters(), GraniteCounters::MemoryScratch, coverPoints * sizeof(double));
+
+	_graniteInfo._interop.setLevel(passLevel);
+	memcpy(fetchBounds, coverBounds, sizeof(fetchBounds));
+	_progressSpan = (double) levelBlocks.size() / _blocksRequested;
+
+	// Cancelled level fetches stage nothing (remaining blocks see the abort themselves)
+	if (_graniteInfo.fetchData(fetchBounds, levelData) == false) return;
+
+	_graniteInfo._interop.getCounters()->increment(GraniteCounters::BlocksFetched, levelBlocks.size());
+	_graniteInfo._interop.getCounters()->increment(GraniteCounters::BlocksCoalesced, levelBlocks.size());
+	_graniteInfo._interop.getCounters()->increment(GraniteCounters::LevelFetches);
+
+	for (int blockIdx = 0 ; blockIdx < levelBlocks.size() ; blockIdx++) {
+		_stagedBlocks[levelBlocks[blockIdx]] = vtkSmartPointer< vtkDoubleArray >::New();
+		_stagedBlocks[levelBlocks[blockIdx]]->SetNumberOfComponents(1);
+		_stagedBlocks[levelBlocks[blockIdx]]->SetNumberOfTuples(_graniteInfo.getVolumeSize(levelBlocks[blockIdx]));
+		_graniteInfo._interop.getCounters()->allocate(GraniteCounters::MemoryArrays, (long long) _graniteInfo.getVolumeSize(levelBlocks[blockIdx]) * sizeof(double));
+		blockArrays.push_back(_stagedBlocks[levelBlocks[blockIdx]]);
+	}
+
+	// Split into block arrays in parallel, one row (x fastest, contiguous in both) at a time
+	GraniteCounters::ScopedTimer splitTimer(_graniteInfo._interop.getCounters(), GraniteCounters::TimeArrayCopy);
+
+	vtkSMPTools::For(0, levelBlocks.size(), [&](vtkIdType passBegin, vtkIdType passEnd) {
+		double * sourceData, * targetData;
+		long long rowLength, sourceIdx;
+		int * bounds;
+
+		sourceData = levelArray->GetPointer(0);
+
+		for (vtkIdType blockIdx = passBegin ; blockIdx < passEnd ; blockIdx++) {
+			bounds = &blockBounds[blockIdx][0];
+			targetData = blockArrays[blockIdx]->GetPointer(0);
+			rowLength = bounds[1] - bounds[0] + 1;
+
+			for (int zIdx = bounds[4] ; zIdx <= bounds[5] ; zIdx++) {
+				for (int yIdx = bounds[2] ; yIdx <= bounds[3] ; yIdx++) {
+					sourceIdx = ((long long) (zIdx - coverBounds[4]) * (coverBounds[3] - coverBounds[2] + 1) + (yIdx - coverBounds[2])) * (coverBounds[1] - coverBounds[0] + 1) + (bounds[0] - coverBounds[0]);
+					memcpy(targetData, sourceData + sourceIdx, rowLength * sizeof(double));
+					targetData += rowLength;
+				}
+			}
+		}
+	});
+
+	GraniteTrace::flush();
+}
+
+void vtkGraniteReaderAMR::clearStaged() {
+	// Staged blocks never loaded (e.g. after an abort) are freed here rather than kept by the output
+	for (std::map< int, vtkSmartPointer< vtkDoubleArray > >::iterator stagedIter = _stagedBlocks.begin() ; stagedIter != _stagedBlocks.end() ; stagedIter++) {
+		_graniteInfo._interop.getCounters()->release(GraniteCounters::MemoryArrays, stagedIter->second->GetNumberOfTuples() * sizeof(double));
+	}
+
+	_stagedLevels.clear();
+	_stagedBlocks.clear();
+}
+
+void vtkGraniteReaderAMR::countRequested() {
+	_blocksRequested = 0;
+	for (int mapIdx = 0 ; mapIdx < this->BlockMap.size() ; mapIdx++) {
+		if (this->IsBlockMine(mapIdx)) _blocksRequested++;
+	}
+
+	_blocksRequested = std::max(1, _blocksRequested);
+}
+
+void vtkGraniteReaderAMR::estimateMemory() {
+	int * levelBounds;
+	long long arrayBytes, peakBytes, totalArrays, totalHeld;
+
+	_memoryEstimate.clear();
+	totalArrays = 0;
+	totalHeld = 0;
+
+	// Whole levels as double arrays (blocks of a level may be fetched together), loaded levels accumulate - numbered as AMR levels (0 coarsest)
+	for (int levelIdx = 0 ; levelIdx < _graniteInfo._interop.getLevelCount() ; levelIdx++) {
+		levelBounds = _graniteInfo._interop.getBounds(levelIdx);
+		peakBytes = _graniteInfo.estimateReadBytes(levelBounds, levelBounds, sizeof(double), &arrayBytes);
+		totalArrays += arrayBytes;
+		totalHeld = std::max(totalHeld, peakBytes - arrayBytes);
+
+		_memoryEstimate += "Level " + std::to_string(levelIdx) + ": " + std::to_string((int) pow(_graniteInfo.getAMRDivisions(), 3)) + " blocks, ";
+		_memoryEstimate += std::to_string(arrayBytes) + " array bytes, " + std::to_string(peakBytes) + " peak bytes\n";
+	}
+
+	_memoryEstimate += "All levels: " + std::to_string(totalArrays) + " array bytes, " + std::to_string(totalArrays + totalHeld) + " peak bytes\n";
+}
+
+bool vtkGraniteReaderAMR::getBlockRange(int passBlockID, double * retRange) {
+	int currentLevel, currentBounds[6], levelBounds[6];
+	int regionLower[3], regionUpper[3], levelPoints[3], * statsDimensions;
+	int blockLevelCount, levelBlock, stride;
+	GraniteStatistics::Summary * blockSummary;
+	bool sameGrid;
+
+	if (passBlockID < 0 || passBlockID >= _blockRanges.size() / 2) return false;
+
+	// Block already fetched
+	if (!std::isnan(_blockRanges[2 * passBlockID])) {
+		retRange[0] = _blockRanges[2 * passBlockID];
+		retRange[1] = _blockRanges[2 * passBlockID + 1];
+
+		return true;
+	}
+
+	// Without exact or conservative ranges the block is never culled
+	if (_graniteInfo._statistics.isEmpty()) return false;
+
+	_graniteInfo.getAMRBlock(passBlockID, &currentLevel, currentBounds);
+	_graniteInfo._interop.setLevel(currentLevel);
+	memcpy(levelBounds, _graniteInfo._interop.getBounds(), sizeof(levelBounds));
+	statsDimensions = _graniteInfo._statistics.getDimensions();
+
+	sameGrid = true;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		levelPoints[dimIdx] = levelBounds[2 * dimIdx + 1] - levelBounds[2 * dimIdx] + 1;
+		if (levelPoints[dimIdx] != statsDimensions[dimIdx]) sameGrid = false;
+	}
+
+	// Level the statistics were written from - its blocks are split as the statistics' blocks, so their range is exact
+	blockLevelCount = pow(_graniteInfo.getAMRDivisions(), 3);
+	levelBlock = passBlockID - currentLevel * blockLevelCount;
+
+	if (sameGrid && _graniteInfo._statistics.getDivisions() == _graniteInfo.getAMRDivisions()) {
+		blockSummary = _graniteInfo._statistics.getBlockField(levelBlock, 0);
+		if (blockSummary == NULL || blockSummary->count == 0) return false;
+
+		retRange[0] = blockSummary->minimum;
+		retRange[1] = blockSummary->maximum;
+
+		return true;
+	}
+
+	// Other levels are resampled from the statistics' level, so stay within the range of the points around the block (widened by a level point either side, covering interpolation)
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		stride = (statsDimensions[dimIdx] + levelPoints[dimIdx] - 1) / levelPoints[dimIdx];
+		regionLower[dimIdx] = (int) ((long long) (currentBounds[2 * dimIdx] - levelBounds[2 * dimIdx]) * statsDimensions[dimIdx] / levelPoints[dimIdx]) - stride;
+		regionUpper[dimIdx] = (int) ((long long) (currentBounds[2 * dimIdx + 1] - levelBounds[2 * dimIdx] + 1) * statsDimensions[dimIdx] / levelPoints[dimIdx]) + stride;
+	}
 
-	// Copy float data
-	_graniteInfo._interop.copyFloatData(currentBounds, block->GetCellData());
+	return _graniteInfo._statistics.getRegionRange(0, regionLower, regionUpper, retRange);
 }
 
 void vtkGraniteReaderAMR::SetUpDataArraySelections() {
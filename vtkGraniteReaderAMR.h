@@ -12,10 +12,20 @@
 #ifndef __vtkGraniteReaderAMR_h
 #define __vtkGraniteReaderAMR_h
 
+#include <map>
+#include <set>
+
 #include "GraniteShared.h"
 #include "vtkAMRBaseReader.h"
+#include "vtkDoubleArray.h"
+#include "vtkSmartPointer.h"
+
+class GraniteBenchmark;
 
 class vtkGraniteReaderAMR : public vtkAMRBaseReader {
+	// Allow benchmark suite to drive the block path without a pipeline
+	friend class GraniteBenchmark;
+
 	public:
 		static vtkGraniteReaderAMR * New();
 		vtkTypeMacro( vtkGraniteReaderAMR, vtkAMRBaseReader );
@@ -26,12 +36,19 @@ class vtkGraniteReaderAMR : public vtkAMRBaseReader {
 		const char * getFileName();
 		void setFileName(const char * passName); 
 		void SetFileName(const char * passName); // Irregular caps defined by parent class
+		void setValueRangeCulling(bool passEnabled);
+		void setValueRange(double passMinimum, double passMaximum); // Interval of interest (e.g. threshold or contour values)
+		const char * getPerformanceReport(); // Hot path counters, phase timers and memory peaks
+		void resetPerformanceCounters();
+		const char * getMemoryEstimate(); // Bytes a read would hold for each level's blocks (from metadata, updated by RequestInformation)
 
 	protected:
 		vtkGraniteReaderAMR();
 		~vtkGraniteReaderAMR();
 
 		// VTK Pipeline methods
+		int RequestInformation(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput);
+		int RequestData(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput);
 		int FillMetaData();
 		int GetNumberOfBlocks();
 		int GetNumberOfLevels();
@@ -44,8 +61,24 @@ class vtkGraniteReaderAMR : public vtkAMRBaseReader {
 	private:
 		vtkGraniteReaderAMR(const vtkGraniteReaderAMR&);  // Not implemented per VTK standard
 		void operator=(const vtkGraniteReaderAMR&);  // Not implemented per VTK standard
+
+		bool getBlockRange(int passBlockID, double * retRange); // Exact or conservatively widened value range of a block (false if unknown, never culled)
+		bool isBlockCulled(int passBlockID, double * retFill); // Block cannot intersect the value range (and constant to fill it with)
+		void stageLevel(int passLevel); // Fetch requested blocks of a level as one extent, split into block arrays
+		void clearStaged();
+		void countRequested(); // Blocks this process loads in the current request (for progress)
+		void estimateMemory(); // Build memory estimate for every level, and all of them together
 		
 		GraniteShared _graniteInfo;
+		bool _cullingEnabled; // Skip blocks whose range cannot intersect the value range
+		double _cullingRange[2]; // Value range of interest
+		std::vector< double > _blockRanges; // Cached min/max per fetched block (NaN until fetched)
+		std::set< int > _stagedLevels; // Levels whose requested blocks were fetched together in this request
+		std::map< int, vtkSmartPointer< vtkDoubleArray > > _stagedBlocks; // Block arrays split from the level fetch, until loaded
+		int _blocksRequested, _blocksLoaded; // Blocks this process loads in the current request, and those started so far
+		double _progressBase, _progressSpan; // Progress before the current fetch, and the share of the request it covers
+		std::string _performanceReport; // Storage for last report returned
+		std::string _memoryEstimate; // One line per level, then the total
 };
 
 #endif // __vtkGraniteReaderAMR_h
\ No newline at end of file
@@ -13,6 +13,9 @@
 
 #include "vtkObjectFactory.h"
 #include "vtkGraniteSettings.h"
+#include "GraniteExtentCache.h"
+#include "GraniteNodeCache.h"
+#include "GraniteTrace.h"
 
 // VTK Instantiation Macro (Provides NEW definition)
 vtkInstantiatorNewMacro(vtkGraniteSettings);
@@ -68,10 +71,81 @@ void vtkGraniteSettings::setAMRDivisions(const int passDivisions) {
 	_amrDivisions = passDivisions;
 }
 
+int vtkGraniteSettings::getTraceEnabled() {
+	return _traceEnabled;
+}
+
+void vtkGraniteSettings::setTraceEnabled(const int passEnabled) {
+	_traceEnabled = passEnabled;
+	GraniteTrace::configure(_traceEnabled, _traceFileName.c_str());
+}
+
+const char * vtkGraniteSettings::getTraceFileName() {
+	return _traceFileName.c_str();
+}
+
+void vtkGraniteSettings::setTraceFileName(const char * passName) {
+	_traceFileName = passName;
+	GraniteTrace::configure(_traceEnabled, _traceFileName.c_str());
+}
+
+int vtkGraniteSettings::getIOQueueDepth() {
+	return _ioQueueDepth;
+}
+
+void vtkGraniteSettings::setIOQueueDepth(const int passDepth) {
+	_ioQueueDepth = passDepth;
+}
+
+int vtkGraniteSettings::getExtentCacheSize() {
+	return _extentCacheSize;
+}
+
+void vtkGraniteSettings::setExtentCacheSize(const int passMegabytes) {
+	_extentCacheSize = passMegabytes;
+
+	// Shrinking (or disabling) takes effect immediately
+	GraniteExtentCache::getInstance()->clear();
+}
+
+int vtkGraniteSettings::getWorkerProcesses() {
+	return _workerProcesses;
+}
+
+void vtkGraniteSettings::setWorkerProcesses(const int passCount) {
+	_workerProcesses = passCount;
+}
+
+const char * vtkGraniteSettings::getWorkerFileName() {
+	return _workerFileName.c_str();
+}
+
+void vtkGraniteSettings::setWorkerFileName(const char * passName) {
+	_workerFileName = passName;
+}
+
+int vtkGraniteSettings::getNodeCacheSize() {
+	return _nodeCacheSize;
+}
+
+void vtkGraniteSettings::setNodeCacheSize(const int passMegabytes) {
+	_nodeCacheSize = passMegabytes;
+
+	// Extents this process filled are withdrawn from the node immediately
+	GraniteNodeCache::getInstance()->clear();
+}
+
 vtkGraniteSettings::vtkGraniteSettings() { 
 	_graniteFileName = "";
 	_javaArguments = "";
 	_amrDivisions = 3;
+	_traceEnabled = false;
+	_traceFileName = "granite_trace.json";
+	_ioQueueDepth = 4;
+	_extentCacheSize = 512;
+	_workerProcesses = 0;
+	_nodeCacheSize = 0;
+	_workerFileName = "granite-worker";
 }
 
 vtkGraniteSettings::~vtkGraniteSettings() { }
@@ -32,6 +32,20 @@ class vtkGraniteSettings : public vtkObject {
 		void setJavaArguments(const char * passArguments);
 		int getAMRDivisions();
 		void setAMRDivisions(const int passDivisions);
+		int getTraceEnabled();
+		void setTraceEnabled(const int passEnabled);
+		const char * getTraceFileName();
+		void setTraceFileName(const char * passName);
+		int getIOQueueDepth();
+		void setIOQueueDepth(const int passDepth);
+		int getExtentCacheSize();
+		void setExtentCacheSize(const int passMegabytes);
+		int getWorkerProcesses();
+		void setWorkerProcesses(const int passCount);
+		const char * getWorkerFileName();
+		void setWorkerFileName(const char * passName);
+		int getNodeCacheSize();
+		void setNodeCacheSize(const int passMegabytes);
 
 	protected:
 		vtkGraniteSettings();
@@ -45,6 +59,13 @@ class vtkGraniteSettings : public vtkObject {
 		std::string _graniteFileName; // Granite library pathname
 		std::string _javaArguments; // Additional arguments for Java VM
 		int _amrDivisions; // How many times to divide AMR data into subblocks
+		bool _traceEnabled; // Record Chrome trace timeline of reads and writes
+		std::string _traceFileName; // Chrome trace JSON output pathname
+		int _ioQueueDepth; // Outstanding slab reads for native storage
+		int _extentCacheSize; // Megabytes of recently read extents kept across readers (0 disables)
+		int _workerProcesses; // Granite helper processes serving reads (0 reads through the in-process JVM)
+		std::string _workerFileName; // Helper process executable pathname (searched for on PATH if bare)
+		int _nodeCacheSize; // Megabytes of extents this process shares with others on the node (0 disables)
 };
 
 #endif //__vtkGraniteSettings_h
\ No newline at end of file
@@ -10,17 +10,29 @@
  =========================================================================*/
 
 #include <string>
+#include <sstream>
+#include <fstream>
 #include <stdio.h>
 #include <memory>
 #include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 	#include <direct.h>
 #endif
 
+#include "qfile.h"
 #include "qstring.h"
 #include "qxml.h"
+#include "vtkByteSwap.h"
 #include "vtkDataArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkErrorCode.h"
+#include "vtkSmartPointer.h"
 #include "vtkPointData.h"
 #include "vtkDataObject.h"
 #include "vtkImageData.h"
@@ -30,14 +42,23 @@
 #include "vtkStreamingDemandDrivenPipeline.h"
 
 #include "vtkGraniteWriter.h"
+#include "vtkGraniteSettings.h"
+#include "GraniteExtentCache.h"
+#include "GraniteStorage.h"
+#include "GraniteTrace.h"
 
 // VTK Instantiation Macro (Provides NEW definition)
 vtkStandardNewMacro(vtkGraniteWriter);
 
 void vtkGraniteWriter::PrintSelf(ostream& retStream, vtkIndent passIndent) {
+  std::ostringstream indentStream;
+
   //Superclass::PrintSelf(retStream, passIndent);
 
   retStream << passIndent << "File Base: " << (!_fileBase.empty() ? _fileBase : "(none)") << "\n";
+  retStream << passIndent << "Performance Counters:\n";
+  indentStream << passIndent.GetNextIndent();
+  retStream << _counters.getReport(indentStream.str().c_str());
 }
 
 void vtkGraniteWriter::setFileBase(const char * passName) {
@@ -79,6 +100,78 @@ void vtkGraniteWriter::setMultiresolution(int passCount, int passSteps) {
 	_mrSteps = passSteps;
 }
 
+void vtkGraniteWriter::setNativeStorage(bool passNative) {
+	_nativeStorage = passNative;
+}
+
+bool vtkGraniteWriter::getNativeStorage() {
+	return _nativeStorage;
+}
+
+void vtkGraniteWriter::setContainer(bool passContainer) {
+	_container = passContainer;
+}
+
+bool vtkGraniteWriter::getContainer() {
+	return _container;
+}
+
+void vtkGraniteWriter::setEncoding(int passEncoding) {
+	if (passEncoding < 0 || passEncoding >= GraniteStorage::EncodingCount) return;
+
+	_encoding = (GraniteStorage::EncodingDef) passEncoding;
+}
+
+int vtkGraniteWriter::getEncoding() {
+	return _encoding;
+}
+
+void vtkGraniteWriter::setArrayEncoding(const char * passName, int passEncoding) {
+	if (passName == NULL || passEncoding < 0 || passEncoding >= GraniteStorage::EncodingCount) return;
+
+	_arrayEncodings[passName] = (GraniteStorage::EncodingDef) passEncoding;
+}
+
+void vtkGraniteWriter::clearArrayEncodings() {
+	_arrayEncodings.clear();
+}
+
+void vtkGraniteWriter::setUpdateMode(int passMode) {
+	if (passMode < 0 || passMode >= UpdateModeDef::UpdateModeCount) return;
+
+	_updateMode = (UpdateModeDef) passMode;
+}
+
+int vtkGraniteWriter::getUpdateMode() {
+	return _updateMode;
+}
+
+void vtkGraniteWriter::setMemoryBudget(int passMegabytes) {
+	_memoryBudget = passMegabytes;
+}
+
+int vtkGraniteWriter::getMemoryBudget() {
+	return _memoryBudget;
+}
+
+void vtkGraniteWriter::setThreadCount(int passThreads) {
+	_threadCount = passThreads;
+}
+
+int vtkGraniteWriter::getThreadCount() {
+	return _threadCount;
+}
+
+const char * vtkGraniteWriter::getPerformanceReport() {
+	_performanceReport = _counters.getReport();
+
+	return _performanceReport.c_str();
+}
+
+void vtkGraniteWriter::resetPerformanceCounters() {
+	_counters.reset();
+}
+
 int vtkGraniteWriter::ProcessRequest(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector * retOutput) {
 	// Information request
 	if(passRequest->Has(vtkDemandDrivenPipeline::REQUEST_INFORMATION())) {
@@ -90,7 +183,10 @@ int vtkGraniteWriter::ProcessRequest(vtkInformation * passRequest, vtkInformatio
 
 int vtkGraniteWriter::RequestInformation(vtkInformation * passRequest, vtkInformationVector ** passInput, vtkInformationVector* retOutput) {
 	// Check for supported input data type, and set output accordingly
-	if (checkDataType(passInput[0]->GetInformationObject(0)) == false) return false;
+	if (checkDataType(passInput[0]->GetInformationObject(0)) == false) {
+		this->SetErrorCode(vtkErrorCode::FileFormatError);
+		return false;
+	}
 
 	// Set to initialized
 	_ready = true;
@@ -107,38 +203,70 @@ int vtkGraniteWriter::FillInputPortInformation(int passPort, vtkInformation * pa
 
 void vtkGraniteWriter::WriteData() {
 	vtkDataSet * inputData;
-	vtkImageResample * resampleData;
+	vtkSmartPointer< vtkImageData > headerData;
+	GraniteStatistics statistics;
+	double magnification[3];
 
 	// Stop if not intialized
-	if (!_ready) return;
+	if (!_ready) {
+		this->SetErrorCode(vtkErrorCode::NoFileNameError);
+		return;
+	}
+
+	// Failures are noted by every stage (and level worker), then reported through the error code once the write ends
+	_writeFailed = false;
+	this->SetErrorCode(vtkErrorCode::NoError);
+
+	GraniteTrace::Span writeSpan("WriteData", "write", (_filePath + _fileBase + ".xfdl").c_str());
+	_counters.beginOperation();
 
     inputData = vtkDataSet::SafeDownCast(this->GetInput());
 
-	// Resample image if requested or writing multiresolution
-	resampleData = NULL;
-	if (inputData->IsA("vtkImageData") && (_resample || _mrCount > 1)) {
-		resampleData = vtkImageResample::New();
-		resampleData->AddInputData(inputData);
+	// Update and append modes write in the existing dataset's index space, so never resample
+	if (_updateMode != UpdateModeDef::Replace) {
+		// Failed updates leave the XFDL describing the binary as it was
+		if (updateData(inputData) == false) {
+			vtkOutputWindowDisplayErrorText(("ERROR: Granite dataset " + _filePath + _fileBase + ".xfdl was not updated.").c_str());
+			this->SetErrorCode(vtkErrorCode::FileFormatError);
+		}
 
-		resampleData->SetAxisMagnificationFactor(0, ((vtkImageData *) inputData)->GetSpacing()[0]);
-		resampleData->SetAxisMagnificationFactor(1, ((vtkImageData *) inputData)->GetSpacing()[1]);
-		resampleData->SetAxisMagnificationFactor(2, ((vtkImageData *) inputData)->GetSpacing()[2]);
-		resampleData->Update();
+		// Extents readers in this process cached may no longer match the binary (even if its time and size are unchanged)
+		GraniteExtentCache::getInstance()->clear();
+		GraniteTrace::flush();
 
-		inputData = resampleData->GetOutput(0);
+		return;
 	}
 
+	// Fields keep full precision unless stored natively
+	prepareEncodings(inputData, _nativeStorage && (_mrCount == 1 || isContainer()));
+
 	if (_mrCount == 1) {
-		// Single resolution - simply write XFDL header and data
-		writeXFDL(inputData, _filePath + _fileBase + ".xfdl", _fileBase + ".bin");
-		writeBinary(inputData, _filePath + _fileBase + ".bin");
+		// Single resolution - write data, then XFDL header (which carries the data's statistics)
+		if (inputData->IsA("vtkImageData") && _resample && getMagnification((vtkImageData *) inputData, 0, magnification)) {
+			// Resampled slab by slab, so the resampled volume is never held whole
+			headerData = vtkSmartPointer< vtkImageData >::New();
+			writeStreamedBinary((vtkImageData *) inputData, magnification, _filePath + _fileBase + ".bin", &statistics, _nativeStorage, headerData);
+			writeXFDL(headerData, _filePath + _fileBase + ".xfdl", _fileBase + ".bin", &statistics);
+		}
+		else {
+			if (inputData->IsA("vtkImageData") && _resample) _counters.increment(GraniteCounters::ResamplesSkipped);
+
+			writeBinary(inputData, _filePath + _fileBase + ".bin", &statistics, _nativeStorage);
+			writeXFDL(inputData, _filePath + _fileBase + ".xfdl", _fileBase + ".bin", &statistics);
+		}
+	}
+	else if (isContainer()) {
+		// Multiresolution container (levels are read by the plugin, so native storage applies)
+		writeContainerData((vtkImageData *) inputData);
 	}
 	else {
-		// Multiresolution
+		// Multiresolution (levels are read through Granite, so always use Granite storage)
+		if (_nativeStorage) vtkOutputWindowDisplayWarningText("WARNING: Native storage is only supported for single resolution data and multiresolution containers, writing Granite storage.");
 		writeMRData(inputData);
 	}
 
-	if (resampleData) resampleData->Delete();
+	if (_writeFailed) this->SetErrorCode(vtkErrorCode::FileFormatError);
+	GraniteTrace::flush();
 }
 vtkGraniteWriter::vtkGraniteWriter()
 {
@@ -146,6 +274,14 @@ vtkGraniteWriter::vtkGraniteWriter()
 	_filePath = "";
 	_fileBase = "";
 	_resample = true;
+	_nativeStorage = false;
+	_container = false;
+	_encoding = GraniteStorage::Float32;
+	_updateMode = UpdateModeDef::Replace;
+	_memoryBudget = 1024;
+	_budgetUsed = 0;
+	_threadCount = 0;
+	_writeFailed = false;
 }
 
 vtkGraniteWriter::~vtkGraniteWriter() { }
@@ -156,6 +292,11 @@ bool vtkGraniteWriter::checkDataType(vtkInformation * passInput) {
 	inputData = vtkDataSet::SafeDownCast(passInput->Get(vtkDataObject::DATA_OBJECT()));
 
 	if (inputData != NULL) {
+		if (_updateMode != UpdateModeDef::Replace && _mrCount > 1) {
+			vtkOutputWindowDisplayErrorText("ERROR: Update and append modes only support single resolution data.");
+			return false;
+		}
+
 		// Uniform Rectilinear Data
 		if (inputData->IsA("vtkImageData")) return true;
 
@@ -166,6 +307,12 @@ bool vtkGraniteWriter::checkDataType(vtkInformation * passInput) {
 				return false;
 			}
 
+			// Appending would also need the coordinate sidecar extended
+			if (_updateMode == UpdateModeDef::Append) {
+				vtkOutputWindowDisplayErrorText("ERROR: Can only append slices from vtkImageData type.");
+				return false;
+			}
+
 			return true;
 		}
 	}
@@ -176,147 +323,388 @@ bool vtkGraniteWriter::checkDataType(vtkInformation * passInput) {
 }
 
 void vtkGraniteWriter::writeMRData(vtkDataSet * passData) {
-	vtkImageResample * resampleData;
+	std::vector< std::thread > levelWorkers;
+	std::vector< std::string > levelDirectories;
+	std::atomic< int > nextLevel;
 	std::string currentDirectory;
-	std::string mrPostfix;
+	int workerCount;
 
-	// Write starting XFDL
-	writeXFDL(passData, _filePath + _fileBase + ".xfdl", "@" + _fileBase + "/" + _fileBase + ".bin");
+	// Create directory for each resolution (each nested within the previous)
 	currentDirectory = _fileBase + "/";
-
-	// Iterate through each resolution level
 	for (int levelIdx = 0 ; levelIdx < _mrCount ; levelIdx++) {
-		// Create directory for current resolution
 		#ifdef _WIN32
 			mkdir((_filePath + currentDirectory).c_str());
 		#else
 			mkdir((_filePath + currentDirectory).c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
 		#endif
 
-		if (levelIdx == 0) {
-			// For root level, create header and footer with name of datasource
-			writeXFDL(passData, _filePath + currentDirectory + _fileBase + ".xfdl", _fileBase + ".bin");
-			writeBinary(passData, _filePath + currentDirectory + _fileBase + ".bin");
+		levelDirectories.push_back(currentDirectory);
+		currentDirectory += "level" + std::to_string(levelIdx + 1) + "/";
+	}
+
+	// Coarser levels are resampled and written on workers while the root level is flushed here
+	nextLevel = 1;
+	workerCount = std::min< int >(_mrCount - 1, std::max< int >(1, getThreadLimit() - 1));
+	for (int workerIdx = 0 ; workerIdx < workerCount ; workerIdx++) {
+		levelWorkers.push_back(std::thread([this, passData, &levelDirectories, &nextLevel] {
+			for (int levelIdx = nextLevel++ ; levelIdx < _mrCount ; levelIdx = nextLevel++) {
+				writeMRLevel((vtkImageData *) passData, levelIdx, levelDirectories[levelIdx]);
+			}
+		}));
+	}
+
+	writeMRLevel((vtkImageData *) passData, 0, levelDirectories[0]);
+
+	for (int workerIdx = 0 ; workerIdx < levelWorkers.size() ; workerIdx++) {
+		levelWorkers[workerIdx].join();
+	}
+}
+
+void vtkGraniteWriter::writeMRLevel(vtkImageData * passData, int passLevel, std::string passDirectory) {
+	vtkSmartPointer< vtkImageData > inputData, headerData;
+	vtkSmartPointer< vtkImageResample > resampleData;
+	vtkImageData * levelData;
+	GraniteStatistics statistics;
+	std::string mrPostfix;
+	std::chrono::steady_clock::time_point phaseStart;
+	double magnification[3];
+	long long levelBytes;
+	bool resample;
+
+	GraniteTrace::Span levelSpan("writeLevel", "write");
+	levelSpan.addArg("level", passLevel);
+
+	// Every level is resampled straight from the input (to unit spacing at the root), never from another resampled copy
+	resample = getMagnification(passData, passLevel, magnification);
+	if (!resample) _counters.increment(GraniteCounters::ResamplesSkipped);
+
+	if (passLevel == 0) {
+		// For root level, write data (resampled slab by slab), then starting XFDL and header with name of datasource
+		if (resample) {
+			headerData = vtkSmartPointer< vtkImageData >::New();
+			writeStreamedBinary(passData, magnification, _filePath + passDirectory + _fileBase + ".bin", &statistics, false, headerData);
+			levelData = headerData;
 		}
 		else {
-			// For child resolutions, resample
-			resampleData = vtkImageResample::New();
-			resampleData->AddInputData(passData);
-			resampleData->SetAxisMagnificationFactor(0, 1.0 / (double) pow(_mrSteps, levelIdx));
-			resampleData->SetAxisMagnificationFactor(1, 1.0 / (double) pow(_mrSteps, levelIdx));
-			resampleData->SetAxisMagnificationFactor(2, 1.0 / (double) pow(_mrSteps, levelIdx));
-			resampleData->Update();
-			
-			// Write two headers and binary
-			mrPostfix = ".d" + std::to_string(levelIdx);
-			writeXFDL(resampleData->GetOutput(0), _filePath + currentDirectory + _fileBase + ".bin" + mrPostfix + ".fdl", _fileBase + ".bin" + mrPostfix);
-			writeXFDL(resampleData->GetOutput(0), _filePath + currentDirectory + "data.fdl", _fileBase + ".bin" + mrPostfix);
-			writeBinary(resampleData->GetOutput(0), _filePath + currentDirectory + _fileBase + ".bin" + mrPostfix);
-
-			resampleData->Delete();
-		}
-
-		// Add (potential) next iteration to path
-		currentDirectory += "level" + std::to_string(levelIdx + 1) + "/";
+			writeBinary(passData, _filePath + passDirectory + _fileBase + ".bin", &statistics);
+			levelData = passData;
+		}
+
+		writeXFDL(levelData, _filePath + _fileBase + ".xfdl", "@" + _fileBase + "/" + _fileBase + ".bin", &statistics);
+		writeXFDL(levelData, _filePath + passDirectory + _fileBase + ".xfdl", _fileBase + ".bin", &statistics);
+
+		return;
+	}
+
+	levelData = passData;
+	levelBytes = 0;
+
+	if (resample) {
+		// Hold level's share of the memory budget until its binary is written
+		levelBytes = estimateLevelBytes(passData, magnification);
+		reserveBudget(levelBytes);
+
+		// For child resolutions, resample (from a shallow copy, so pipelines on other threads never share an input)
+		inputData = vtkSmartPointer< vtkImageData >::New();
+		{
+			std::lock_guard< std::mutex > guard(_budgetLock);
+			inputData->ShallowCopy(passData);
+		}
+
+		resampleData = vtkSmartPointer< vtkImageResample >::New();
+		resampleData->SetNumberOfThreads(getThreadLimit());
+		resampleData->SetInputData(inputData);
+		resampleData->SetAxisMagnificationFactor(0, magnification[0]);
+		resampleData->SetAxisMagnificationFactor(1, magnification[1]);
+		resampleData->SetAxisMagnificationFactor(2, magnification[2]);
+		phaseStart = std::chrono::steady_clock::now();
+		resampleData->Update();
+		_counters.addTime(GraniteCounters::TimeResample, std::chrono::steady_clock::now() - phaseStart);
+
+		levelData = resampleData->GetOutput(0);
+	}
+
+	// Write binary and two headers
+	mrPostfix = ".d" + std::to_string(passLevel);
+	writeBinary(levelData, _filePath + passDirectory + _fileBase + ".bin" + mrPostfix, &statistics);
+	writeXFDL(levelData, _filePath + passDirectory + _fileBase + ".bin" + mrPostfix + ".fdl", _fileBase + ".bin" + mrPostfix, &statistics);
+	writeXFDL(levelData, _filePath + passDirectory + "data.fdl", _fileBase + ".bin" + mrPostfix, &statistics);
+
+	if (resample) {
+		resampleData = NULL;
+		releaseBudget(levelBytes);
 	}
 }
 
-void vtkGraniteWriter::writeXFDL(vtkDataSet * passData, std::string passXFDLName, std::string passBinaryName) {
-	vtkDataArray * currentArray;
-	std::string arrayName, compName;
-	QString xmlString;	
-	QXmlStreamWriter xmlStream(&xmlString);
+void vtkGraniteWriter::writeContainerData(vtkImageData * passData) {
+	std::vector< std::thread > levelWorkers;
+	vtkSmartPointer< vtkImageData > headerData;
+	GraniteStatistics statistics;
+	std::atomic< int > nextLevel;
 	std::auto_ptr<ofstream> fileStream;
+	long long levelBytes, nextOffset;
+	int levelExtent[6];
+	int workerCount;
 
-	xmlStream.setAutoFormatting(true);
-	
-	// Header information
-	xmlStream.writeStartDocument();
-	xmlStream.writeDTD("<!DOCTYPE FileDescriptor PUBLIC \"-//SDB//DTD//EN\"  \"fdl.dtd\">");
-	xmlStream.writeStartElement("FileDescriptor");
-	xmlStream.writeAttribute("fileName", passBinaryName.c_str());
-	xmlStream.writeAttribute("fileType", "binary");
+	GraniteTrace::Span containerSpan("writeContainer", "write", (_filePath + _fileBase + ".bin").c_str());
 
-	// Fields
-	for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
-		currentArray = passData->GetPointData()->GetArray(arrayIdx);
+	// Every level's extent is known before any is resampled, so offsets are fixed up front and levels written concurrently
+	_levelExtents.clear();
+	_levelOffsets.clear();
+	nextOffset = 0;
 
-		for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
-			// Compose field name (array.componenet)
-			arrayName = (currentArray->GetName() != NULL ? currentArray->GetName() : std::string("array") + std::to_string(arrayIdx));
-			compName = (currentArray->GetComponentName(compIdx) != NULL ? currentArray->GetComponentName(compIdx) : std::string("comp") + std::to_string(compIdx));
+	for (int levelIdx = 0 ; levelIdx < _mrCount ; levelIdx++) {
+		getLevelExtent(passData, levelIdx, levelExtent);
 
-			// Write field
-			xmlStream.writeStartElement("Field");
-			xmlStream.writeAttribute("fieldName", (arrayName + "." + compName).c_str());
-			//xmlStream.writeAttribute("fieldType", currentArray->GetDataTypeAsString());
-			xmlStream.writeAttribute("fieldType", "float");
-			xmlStream.writeEndElement();
+		levelBytes = (_nativeStorage ? getStoredBytes(_fieldEncodings.size()) : _fieldEncodings.size() * sizeof(float));
+		for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+			levelBytes *= levelExtent[2 * dimIdx + 1] - levelExtent[2 * dimIdx] + 1;
 		}
+
+		_levelExtents.push_back(std::vector< int >(levelExtent, levelExtent + 6));
+		_levelOffsets.push_back(nextOffset);
+		nextOffset = (nextOffset + levelBytes + ContainerAlignment - 1) / ContainerAlignment * ContainerAlignment;
+	}
+
+	// Create (empty) container for the level writers to open
+	#ifdef _WIN32
+		fileStream.reset(new ofstream((_filePath + _fileBase + ".bin").c_str(), ios::out | ios::binary));
+	#else
+		fileStream.reset(new ofstream((_filePath + _fileBase + ".bin").c_str(), ios::out));
+	#endif
+	closeStream(fileStream.get(), _filePath + _fileBase + ".bin");
+
+	// Coarser levels are written on workers while the root level is written here (all streamed slab by slab, so no budget is held)
+	nextLevel = 1;
+	workerCount = std::min< int >(_mrCount - 1, std::max< int >(1, getThreadLimit() - 1));
+	for (int workerIdx = 0 ; workerIdx < workerCount ; workerIdx++) {
+		levelWorkers.push_back(std::thread([this, passData, &nextLevel] {
+			GraniteStatistics levelStatistics;
+			vtkSmartPointer< vtkImageData > levelHeader;
+
+			for (int levelIdx = nextLevel++ ; levelIdx < _mrCount ; levelIdx = nextLevel++) {
+				levelHeader = vtkSmartPointer< vtkImageData >::New();
+				writeContainerLevel(passData, levelIdx, &levelStatistics, levelHeader);
+			}
+		}));
+	}
+
+	headerData = vtkSmartPointer< vtkImageData >::New();
+	writeContainerLevel(passData, 0, &statistics, headerData);
+
+	for (int workerIdx = 0 ; workerIdx < levelWorkers.size() ; workerIdx++) {
+		levelWorkers[workerIdx].join();
 	}
-	
+
+	// One header describing the root level (as a Granite dataset) and listing every level
+	writeXFDL(headerData, _filePath + _fileBase + ".xfdl", _fileBase + ".bin", &statistics);
+}
+
+void vtkGraniteWriter::writeContainerLevel(vtkImageData * passData, int passLevel, GraniteStatistics * retStatistics, vtkImageData * retHeaderData) {
+	double magnification[3];
+
+	GraniteTrace::Span levelSpan("writeLevel", "write");
+	levelSpan.addArg("level", passLevel);
+
+	// Every level is resampled straight from the input, slab by slab into its place in the container
+	if (getMagnification(passData, passLevel, magnification)) {
+		writeStreamedBinary(passData, magnification, _filePath + _fileBase + ".bin", retStatistics, _nativeStorage, retHeaderData, _levelOffsets[passLevel]);
+	}
+	else {
+		_counters.increment(GraniteCounters::ResamplesSkipped);
+		writeBinary(passData, _filePath + _fileBase + ".bin", retStatistics, _nativeStorage, _levelOffsets[passLevel]);
+
+		// Header takes the input's structure only
+		retHeaderData->CopyStructure(passData);
+		retHeaderData->GetPointData()->CopyStructure(passData->GetPointData());
+	}
+}
+
+void vtkGraniteWriter::getLevelExtent(vtkImageData * passData, int passLevel, int * retExtent) {
+	vtkSmartPointer< vtkImageData > inputData;
+	vtkSmartPointer< vtkImageResample > resampleData;
+	double magnification[3];
+
+	if (!getMagnification(passData, passLevel, magnification)) {
+		passData->GetExtent(retExtent);
+		return;
+	}
+
+	// Pipeline information only, nothing is resampled
+	inputData = vtkSmartPointer< vtkImageData >::New();
+	inputData->ShallowCopy(passData);
+
+	resampleData = vtkSmartPointer< vtkImageResample >::New();
+	resampleData->SetInputData(inputData);
+	resampleData->SetAxisMagnificationFactor(0, magnification[0]);
+	resampleData->SetAxisMagnificationFactor(1, magnification[1]);
+	resampleData->SetAxisMagnificationFactor(2, magnification[2]);
+	resampleData->UpdateInformation();
+	resampleData->GetOutputInformation(0)->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), retExtent);
+}
+
+bool vtkGraniteWriter::isContainer() {
+	return (_container && _mrCount > 1);
+}
+
+bool vtkGraniteWriter::getMagnification(vtkImageData * passData, int passLevel, double * retFactors) {
+	bool identity;
+
+	// Unit spacing at the root, steps^level spacing below it
+	identity = true;
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		retFactors[dimIdx] = passData->GetSpacing()[dimIdx] / pow(_mrSteps, passLevel);
+		if (fabs(retFactors[dimIdx] - 1.0) > 1e-9) identity = false;
+	}
+
+	return !identity;
+}
+
+long long vtkGraniteWriter::estimateLevelBytes(vtkImageData * passData, double * passFactors) {
+	long long levelBytes;
+	int dimensions[3];
+
+	passData->GetDimensions(dimensions);
+
+	// Resampled output keeps input types, so size is the root point size over the level's point count
+	levelBytes = 0;
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+		levelBytes += passData->GetPointData()->GetArray(arrayIdx)->GetDataTypeSize() * passData->GetPointData()->GetArray(arrayIdx)->GetNumberOfComponents();
+	}
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		levelBytes *= (long long) ceil(dimensions[dimIdx] * passFactors[dimIdx]);
+	}
+
+	return levelBytes;
+}
+
+void vtkGraniteWriter::reserveBudget(long long passBytes) {
+	long long budgetBytes;
+
+	GraniteTrace::Span budgetSpan("reserveBudget", "write");
+	budgetBytes = (long long) _memoryBudget * 1024 * 1024;
+
+	// A level larger than the whole budget still proceeds once nothing else is held
+	std::unique_lock< std::mutex > guard(_budgetLock);
+	_budgetCondition.wait(guard, [this, passBytes, budgetBytes] { return _memoryBudget <= 0 || _budgetUsed == 0 || _budgetUsed + passBytes <= budgetBytes; });
+	_budgetUsed += passBytes;
+	_counters.allocate(GraniteCounters::MemoryResample, passBytes);
+}
+
+void vtkGraniteWriter::releaseBudget(long long passBytes) {
+	std::lock_guard< std::mutex > guard(_budgetLock);
+
+	_budgetUsed -= passBytes;
+	_counters.release(GraniteCounters::MemoryResample, passBytes);
+	_budgetCondition.notify_all();
+}
+
+void vtkGraniteWriter::writeXFDL(vtkDataSet * passData, std::string passXFDLName, std::string passBinaryName, GraniteStatistics * passStatistics) {
+	GraniteStorage::Encoding currentEncoding;
+	GraniteFormat::Header xfdlHeader;
+	GraniteFormat::FieldEncoding fieldEncoding;
+	GraniteFormat::Level containerLevel;
+
+	GraniteCounters::ScopedTimer xfdlTimer(&_counters, GraniteCounters::TimeWriteXFDL);
+	GraniteTrace::Span xfdlSpan("writeXFDL", "write", passXFDLName.c_str());
+
+	// Header information and fields
+	xfdlHeader.binaryName = passBinaryName;
+	getFieldNames(passData, &xfdlHeader.fieldNames);
+
 	// Custom - ParaView type
-	xmlStream.writeTextElement("CustomParaViewType", passData->GetClassName());
+	xfdlHeader.dataType = passData->GetClassName();
 
 	// Fields specific to Uniform Rectilinear Data
 	if (passData->IsA("vtkImageData")) {
-		writeXFDLTypeData((vtkImageData *) passData, &xmlStream);
+		writeXFDLTypeData((vtkImageData *) passData, &xfdlHeader);
 	}
 
 	// Fields specific to Non-Uniform Rectilinear Data
 	if (passData->IsA("vtkRectilinearGrid")) {
-		writeXFDLTypeData((vtkRectilinearGrid *) passData, &xmlStream);
+		writeXFDLTypeData((vtkRectilinearGrid *) passData, &xfdlHeader, passXFDLName);
+	}
+
+	// Custom - ParaView statistics (gathered while the binary for this data set was written)
+	if (passStatistics) {
+		passStatistics->writeHeader(&xfdlHeader);
+	}
+
+	// Custom - ParaView storage (binary read directly by the plugin, which includes every container since Granite only reads its root level)
+	if ((_nativeStorage && _mrCount == 1) || isContainer()) {
+		xfdlHeader.storage = true;
+		xfdlHeader.byteOrder = GraniteStorage::getByteOrderName(_nativeStorage ? GraniteStorage::getHostByteOrder() : GraniteStorage::BigEndian);
+		xfdlHeader.layout = GraniteStorage::getLayoutName(_nativeStorage ? GraniteStorage::Planar : GraniteStorage::Interleaved);
+
+		// Fields not stored as floats (value = code * scale + offset)
+		for (int fieldIdx = 0 ; fieldIdx < (int) xfdlHeader.fieldNames.size() ; fieldIdx++) {
+			currentEncoding = getFieldEncoding(fieldIdx);
+			if (currentEncoding.type == GraniteStorage::Float32) continue;
+
+			fieldEncoding.fieldName = xfdlHeader.fieldNames[fieldIdx];
+			fieldEncoding.type = GraniteStorage::getEncodingName(currentEncoding.type);
+			fieldEncoding.scale = currentEncoding.scale;
+			fieldEncoding.offset = currentEncoding.offset;
+			xfdlHeader.fieldEncodings.push_back(fieldEncoding);
+		}
+
+		// Planes of single resolution storage (containers list them per level)
+		if (_nativeStorage && !isContainer()) getXFDLFieldOffsets(passData, passData->GetNumberOfPoints(), &xfdlHeader.fieldOffsets);
 	}
-	
-	xmlStream.writeEndElement();
-	xmlStream.writeEndDocument();
-	
+
+	// Custom - ParaView container (extent, as {xLow xHigh yLow ...}, and byte offset of each level within the binary, full resolution first)
+	if (isContainer()) {
+		xfdlHeader.containerAlignment = ContainerAlignment;
+
+		for (int levelIdx = 0 ; levelIdx < _levelOffsets.size() ; levelIdx++) {
+			memcpy(containerLevel.extent, &_levelExtents[levelIdx][0], sizeof(containerLevel.extent));
+			containerLevel.offset = _levelOffsets[levelIdx];
+			containerLevel.fieldOffsets.clear();
+			if (_nativeStorage) getXFDLFieldOffsets(passData, (long long) (_levelExtents[levelIdx][1] - _levelExtents[levelIdx][0] + 1) * (_levelExtents[levelIdx][3] - _levelExtents[levelIdx][2] + 1) * (_levelExtents[levelIdx][5] - _levelExtents[levelIdx][4] + 1), &containerLevel.fieldOffsets);
+			xfdlHeader.levels.push_back(containerLevel);
+		}
+	}
+
 	// Create XFDL file
-	#ifdef _WIN32
-		fileStream.reset(new ofstream(passXFDLName.c_str(), ios::out | ios::binary));
-	#else
-		fileStream.reset(new ofstream(passXFDLName.c_str(), ios::out));
-	#endif
+	if (GraniteFormat::writeXFDL(xfdlHeader, passXFDLName) == false) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to write " + passXFDLName + ".").c_str());
+		_writeFailed = true;
+	}
+}
 
-	// Write header info
-	*fileStream << xmlString.toStdString();
-	fileStream->close();
+void vtkGraniteWriter::getXFDLFieldOffsets(vtkDataSet * passData, long long passPointCount, std::vector< GraniteFormat::FieldOffset > * retOffsets) {
+	GraniteFormat::FieldOffset fieldOffset;
+	std::vector< std::string > fieldNames;
+
+	// Offset relative to the start of the storage (or level), planes in field order
+	getFieldNames(passData, &fieldNames);
+	for (int fieldIdx = 0 ; fieldIdx < (int) fieldNames.size() ; fieldIdx++) {
+		fieldOffset.fieldName = fieldNames[fieldIdx];
+		fieldOffset.offset = getStoredBytes(fieldIdx) * passPointCount;
+		retOffsets->push_back(fieldOffset);
+	}
 }
 
-void vtkGraniteWriter::writeXFDLTypeData(vtkImageData * passData, QXmlStreamWriter * passStream) {
-	// Bounds
+void vtkGraniteWriter::writeXFDLTypeData(vtkImageData * passData, GraniteFormat::Header * retHeader) {
+	// Bounds, then custom - ParaView origin and spacing
 	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
-		passStream->writeStartElement("Bounds");
-		passStream->writeAttribute("lower", std::to_string((int) passData->GetExtent()[4 - 2 * dimIdx]).c_str());
-		passStream->writeAttribute("upper", std::to_string((int) passData->GetExtent()[4 - 2 * dimIdx + 1]).c_str());
-		passStream->writeEndElement();
+		retHeader->extent[2 * dimIdx] = passData->GetExtent()[2 * dimIdx];
+		retHeader->extent[2 * dimIdx + 1] = passData->GetExtent()[2 * dimIdx + 1];
+		retHeader->origin[dimIdx] = passData->GetOrigin()[dimIdx];
+		retHeader->spacing[dimIdx] = passData->GetSpacing()[dimIdx];
 	}
-
-	// Custom - ParaView origin
-	passStream->writeStartElement("CustomParaViewOrigin");
-	passStream->writeAttribute("x", std::to_string((float) passData->GetOrigin()[0]).c_str());
-	passStream->writeAttribute("y", std::to_string((float) passData->GetOrigin()[1]).c_str());
-	passStream->writeAttribute("z", std::to_string((float) passData->GetOrigin()[2]).c_str());
-	passStream->writeEndElement();
-
-	// Custom - ParaView spacing
-	passStream->writeStartElement("CustomParaViewSpacing");
-	passStream->writeAttribute("x", std::to_string((float) passData->GetSpacing()[0]).c_str());
-	passStream->writeAttribute("y", std::to_string((float) passData->GetSpacing()[1]).c_str());
-	passStream->writeAttribute("z", std::to_string((float) passData->GetSpacing()[2]).c_str());
-	passStream->writeEndElement();
 }
 
-void vtkGraniteWriter::writeXFDLTypeData(vtkRectilinearGrid * passData, QXmlStreamWriter * passStream) {
+void vtkGraniteWriter::writeXFDLTypeData(vtkRectilinearGrid * passData, GraniteFormat::Header * retHeader, std::string passXFDLName) {
 	vtkDataArray * gridArrays[3];
-	std::string gridString[3];
+	vtkSmartPointer< vtkDoubleArray > gridCoordinates;
+	std::string gridName;
+	std::ofstream gridStream;
 
 	// Bounds
-	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
-		passStream->writeStartElement("Bounds");
-		passStream->writeAttribute("lower", std::to_string((int) passData->GetExtent()[4 - 2 * dimIdx]).c_str());
-		passStream->writeAttribute("upper", std::to_string((int) passData->GetExtent()[4 - 2 * dimIdx + 1]).c_str());
-		passStream->writeEndElement();
+	for (int dimIdx = 0 ; dimIdx < 6 ; dimIdx++) {
+		retHeader->extent[dimIdx] = passData->GetExtent()[dimIdx];
 	}
 
 	// Custom - ParaView grid spacing
@@ -324,43 +712,658 @@ void vtkGraniteWriter::writeXFDLTypeData(vtkRectilinearGrid * passData, QXmlStre
 	gridArrays[1] = passData->GetYCoordinates();
 	gridArrays[2] = passData->GetZCoordinates();
 
-	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
-		gridString[dimIdx] = "";
+	// Coordinates are stored at full precision as big-endian doubles in a sidecar next to the XFDL
+	gridName = passXFDLName.substr(0, passXFDLName.find_last_of('.')) + ".grid";
+	gridStream.open(gridName.c_str(), std::ios::out | std::ios::binary);
+	gridCoordinates = vtkSmartPointer< vtkDoubleArray >::New();
 
-		for (int coordIdx = 0 ; coordIdx < gridArrays[dimIdx]->GetSize() ; coordIdx++) {
-			gridString[dimIdx] += std::to_string(gridArrays[dimIdx]->GetTuple1(coordIdx)) + " ";
-		}
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		gridCoordinates->DeepCopy(gridArrays[dimIdx]);
+		vtkByteSwap::SwapWrite8BERange(gridCoordinates->GetPointer(0), gridCoordinates->GetNumberOfTuples(), &gridStream);
+		retHeader->gridCounts[dimIdx] = gridArrays[dimIdx]->GetNumberOfTuples();
 	}
 
-	passStream->writeStartElement("CustomParaViewGrid");
-	passStream->writeAttribute("x", gridString[0].substr(0, gridString[0].length() - 1).c_str());
-	passStream->writeAttribute("y", gridString[1].substr(0, gridString[1].length() - 1).c_str());
-	passStream->writeAttribute("z", gridString[2].substr(0, gridString[2].length() - 1).c_str());
-	passStream->writeEndElement();
+	closeStream(&gridStream, gridName);
+
+	retHeader->gridFileName = gridName.substr(gridName.find_last_of("/\\") + 1);
 }
 
+void vtkGraniteWriter::writeBinary(vtkDataSet * passData, std::string passBinaryName, GraniteStatistics * retStatistics, bool passNative, long long passOffset) {
+	std::auto_ptr<ofstream> fileStream;
+	std::vector< std::string > fieldNames;
+	GraniteStatistics scratchStatistics;
+	vtkDataArray * currentArray;
+	int dimensions[3];
+	int fieldIdx;
+
+	GraniteCounters::ScopedTimer binaryTimer(&_counters, GraniteCounters::TimeWriteBinary);
+	GraniteTrace::Span binarySpan("writeBinary", "write", passBinaryName.c_str());
+
+	// Create Binary file
+	fileStream.reset(openBinary(passBinaryName, passOffset));
 
-void vtkGraniteWriter::writeBinary(vtkDataSet * passData, std::string passBinaryName) {
+	if (passData->IsA("vtkImageData")) ((vtkImageData *) passData)->GetDimensions(dimensions);
+	else ((vtkRectilinearGrid *) passData)->GetDimensions(dimensions);
+
+	// Ready statistics (blocks follow the AMR divisions setting), without statistics requested gather into a scratch object
+	if (retStatistics == NULL) retStatistics = &scratchStatistics;
+	getFieldNames(passData, &fieldNames);
+	retStatistics->initialize(fieldNames, dimensions, vtkGraniteSettings::GetInstance()->getAMRDivisions(), 32);
+
+	// Whole data set is a single slab
+	writeBinarySlab(passData, fileStream.get(), dimensions, 0, retStatistics, passNative, passOffset);
+
+	_counters.increment(GraniteCounters::BytesWritten, (unsigned long long) passData->GetNumberOfPoints() * (passNative ? getStoredBytes(fieldNames.size()) : fieldNames.size() * sizeof(float)));
+	closeStream(fileStream.get(), passBinaryName);
+
+	// Histograms need the final range, so take a second pass over the values (as they will be read back)
+	fieldIdx = 0;
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+		currentArray = passData->GetPointData()->GetArray(arrayIdx);
+		for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+			for (vtkIdType dataIdx = 0 ; dataIdx < passData->GetNumberOfPoints() ; dataIdx++) {
+				retStatistics->addHistogramValue(fieldIdx, passNative ? getStoredValue(fieldIdx, (float) currentArray->GetComponent(dataIdx, compIdx)) : (float) currentArray->GetComponent(dataIdx, compIdx));
+			}
+			fieldIdx++;
+		}
+	}
+}
+
+void vtkGraniteWriter::writeStreamedBinary(vtkImageData * passData, double * passFactors, std::string passBinaryName, GraniteStatistics * retStatistics, bool passNative, vtkImageData * retHeaderData, long long passOffset) {
 	std::auto_ptr<ofstream> fileStream;
-	char currentVal[sizeof(float)];
+	std::vector< std::string > fieldNames;
+	std::chrono::steady_clock::time_point phaseStart;
+	vtkSmartPointer< vtkImageData > inputData;
+	vtkSmartPointer< vtkImageResample > resampleData;
+	vtkInformation * outputInfo;
+	long long sliceBytes;
+	int wholeExtent[6], slabExtent[6], dimensions[3];
+	int slabSlices;
+
+	GraniteCounters::ScopedTimer binaryTimer(&_counters, GraniteCounters::TimeWriteBinary);
+	GraniteTrace::Span binarySpan("writeStreamedBinary", "write", passBinaryName.c_str());
+
+	// Resample from a shallow copy (so pipelines on other threads never share an input)
+	inputData = vtkSmartPointer< vtkImageData >::New();
+	{
+		std::lock_guard< std::mutex > guard(_budgetLock);
+		inputData->ShallowCopy(passData);
+	}
+
+	resampleData = vtkSmartPointer< vtkImageResample >::New();
+	resampleData->SetNumberOfThreads(getThreadLimit());
+	resampleData->SetInputData(inputData);
+	resampleData->SetAxisMagnificationFactor(0, passFactors[0]);
+	resampleData->SetAxisMagnificationFactor(1, passFactors[1]);
+	resampleData->SetAxisMagnificationFactor(2, passFactors[2]);
+	resampleData->UpdateInformation();
+
+	// Header describes the whole resampled extent (its arrays only supply field names)
+	outputInfo = resampleData->GetOutputInformation(0);
+	outputInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), wholeExtent);
+	retHeaderData->SetExtent(wholeExtent);
+	retHeaderData->SetOrigin(outputInfo->Get(vtkDataObject::ORIGIN()));
+	retHeaderData->SetSpacing(outputInfo->Get(vtkDataObject::SPACING()));
+	retHeaderData->GetPointData()->CopyStructure(inputData->GetPointData());
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		dimensions[dimIdx] = wholeExtent[2 * dimIdx + 1] - wholeExtent[2 * dimIdx] + 1;
+	}
+
+	getFieldNames(inputData, &fieldNames);
+	retStatistics->initialize(fieldNames, dimensions, vtkGraniteSettings::GetInstance()->getAMRDivisions(), 32);
+
+	// Slabs of whole slices, bounded in size (resampled output keeps input types)
+	sliceBytes = 0;
+	for (int arrayIdx = 0 ; arrayIdx < inputData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+		sliceBytes += (long long) dimensions[0] * dimensions[1] * inputData->GetPointData()->GetArray(arrayIdx)->GetDataTypeSize() * inputData->GetPointData()->GetArray(arrayIdx)->GetNumberOfComponents();
+	}
+
+	slabSlices = (int) std::max< long long >(1, std::min< long long >(dimensions[2], SlabBytes / std::max< long long >(1, sliceBytes)));
 
 	// Create Binary file
+	fileStream.reset(openBinary(passBinaryName, passOffset));
+
+	// Resampled slab held until the next replaces it
+	_counters.allocate(GraniteCounters::MemoryResample, sliceBytes * slabSlices);
+
+	for (int sliceIdx = 0 ; sliceIdx < dimensions[2] ; sliceIdx += slabSlices) {
+		memcpy(slabExtent, wholeExtent, sizeof(slabExtent));
+		slabExtent[4] = wholeExtent[4] + sliceIdx;
+		slabExtent[5] = std::min(slabExtent[4] + slabSlices - 1, wholeExtent[5]);
+
+		// Only the slab is resampled (the filter requests whichever input slices it interpolates from)
+		phaseStart = std::chrono::steady_clock::now();
+		vtkStreamingDemandDrivenPipeline::SetUpdateExtent(outputInfo, slabExtent);
+		resampleData->Update();
+		_counters.addTime(GraniteCounters::TimeResample, std::chrono::steady_clock::now() - phaseStart);
+		_counters.increment(GraniteCounters::ResampleSlabs);
+
+		writeBinarySlab(resampleData->GetOutput(0), fileStream.get(), dimensions, sliceIdx, retStatistics, passNative, passOffset);
+	}
+
+	_counters.increment(GraniteCounters::BytesWritten, (unsigned long long) dimensions[0] * dimensions[1] * dimensions[2] * (passNative ? getStoredBytes(fieldNames.size()) : fieldNames.size() * sizeof(float)));
+	closeStream(fileStream.get(), passBinaryName);
+
+	// Release last slab before the histogram pass
+	resampleData = NULL;
+	_counters.release(GraniteCounters::MemoryResample, sliceBytes * slabSlices);
+	addBinaryHistograms(passBinaryName, fieldNames.size(), (vtkIdType) dimensions[0] * dimensions[1] * dimensions[2], retStatistics, passNative, passOffset);
+}
+
+void vtkGraniteWriter::writeBinarySlab(vtkDataSet * passData, ofstream * passStream, int * passDimensions, int passSliceOffset, GraniteStatistics * retStatistics, bool passNative, long long passOffset) {
+	std::vector< char > planeBuffer, recordBuffer;
+	std::vector< float > recordValues;
+	vtkDataArray * currentArray;
+	GraniteStorage::Encoding currentEncoding;
+	vtkIdType slicePoints, totalPoints;
+	int fieldIdx, fieldSize, recordCount, pointLocation[3];
+
+	slicePoints = (vtkIdType) passDimensions[0] * passDimensions[1];
+	totalPoints = slicePoints * passDimensions[2];
+
+	if (passNative) {
+		// Native storage - one host ordered plane per field in its stored encoding, the slab's part of each written whole
+		planeBuffer.resize(passData->GetNumberOfPoints() * sizeof(float));
+		GraniteCounters::ScopedMemory planeMemory(&_counters, GraniteCounters::MemoryBuffers, planeBuffer.size());
+		fieldIdx = 0;
+
+		for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+			currentArray = passData->GetPointData()->GetArray(arrayIdx);
+			for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+				currentEncoding = getFieldEncoding(fieldIdx);
+				fieldSize = GraniteStorage::getEncodingSize(currentEncoding.type);
+
+				// Statistics describe values as they will be read back
+				for (vtkIdType dataIdx = 0 ; dataIdx < passData->GetNumberOfPoints() ; dataIdx++) {
+					GraniteStorage::encodeValue((float) currentArray->GetComponent(dataIdx, compIdx), currentEncoding, &planeBuffer[dataIdx * fieldSize]);
+					retStatistics->addValue(fieldIdx, dataIdx % passDimensions[0], (dataIdx / passDimensions[0]) % passDimensions[1], dataIdx / slicePoints + passSliceOffset, GraniteStorage::decodeValue(&planeBuffer[dataIdx * fieldSize], currentEncoding));
+				}
+
+				passStream->seekp(passOffset + getStoredBytes(fieldIdx) * totalPoints + (long long) passSliceOffset * slicePoints * fieldSize);
+				passStream->write(&planeBuffer[0], passData->GetNumberOfPoints() * fieldSize);
+				fieldIdx++;
+			}
+		}
+	}
+	else {
+		// Granite storage - big-endian records (slabs arrive in order), gathering range statistics along the way
+		recordCount = 0;
+		for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+			recordCount += passData->GetPointData()->GetArray(arrayIdx)->GetNumberOfComponents();
+		}
+
+		recordValues.resize(recordCount);
+		recordBuffer.resize(recordCount * sizeof(float));
+
+		for (vtkIdType dataIdx = 0 ; dataIdx < passData->GetNumberOfPoints() && recordCount > 0 ; dataIdx++) {
+			pointLocation[0] = dataIdx % passDimensions[0];
+			pointLocation[1] = (dataIdx / passDimensions[0]) % passDimensions[1];
+			pointLocation[2] = dataIdx / slicePoints + passSliceOffset;
+			fieldIdx = 0;
+
+			for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+				currentArray = passData->GetPointData()->GetArray(arrayIdx);
+				for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+					recordValues[fieldIdx] = currentArray->GetComponent(dataIdx, compIdx);
+					retStatistics->addValue(fieldIdx, pointLocation[0], pointLocation[1], pointLocation[2], recordValues[fieldIdx]);
+					fieldIdx++;
+				}
+			}
+
+			// Record encoding shared with GraniteFileWriter
+			GraniteFormat::encodeFloats(&recordValues[0], recordCount, true, &recordBuffer[0]);
+			passStream->write(&recordBuffer[0], recordBuffer.size());
+		}
+	}
+}
+
+void vtkGraniteWriter::addBinaryHistograms(std::string passBinaryName, int passFieldCount, vtkIdType passPointCount, GraniteStatistics * retStatistics, bool passNative, long long passOffset) {
+	std::ifstream fileStream;
+	std::vector< char > chunkBuffer;
+	GraniteStorage::Encoding currentEncoding;
+	vtkIdType valueCount, chunkValues;
+	int fieldSize;
+
+	GraniteTrace::Span histogramSpan("addBinaryHistograms", "write", passBinaryName.c_str());
+
+	// Values were not kept, so read them back in chunks (recently written, so normally still cached)
+	fileStream.open(passBinaryName.c_str(), std::ios::in | std::ios::binary);
+	chunkBuffer.resize(std::min< vtkIdType >(passPointCount * passFieldCount, SlabBytes / sizeof(float)) * sizeof(float));
+	GraniteCounters::ScopedMemory chunkMemory(&_counters, GraniteCounters::MemoryBuffers, chunkBuffer.size());
+
+	if (passNative) {
+		// Planar binaries hold one field per plane, each in its stored encoding
+		for (int fieldIdx = 0 ; fieldIdx < passFieldCount && fileStream ; fieldIdx++) {
+			currentEncoding = getFieldEncoding(fieldIdx);
+			fieldSize = GraniteStorage::getEncodingSize(currentEncoding.type);
+			fileStream.seekg(passOffset + getStoredBytes(fieldIdx) * passPointCount);
+
+			for (vtkIdType startIdx = 0 ; startIdx < passPointCount && fileStream ; startIdx += chunkValues) {
+				chunkValues = std::min< vtkIdType >(chunkBuffer.size() / fieldSize, passPointCount - startIdx);
+				fileStream.read(&chunkBuffer[0], chunkValues * fieldSize);
+
+				for (vtkIdType valueIdx = 0 ; valueIdx < chunkValues ; valueIdx++) {
+					retStatistics->addHistogramValue(fieldIdx, GraniteStorage::decodeValue(&chunkBuffer[valueIdx * fieldSize], currentEncoding));
+				}
+			}
+		}
+	}
+	else {
+		// Granite binaries hold one big-endian float record per point
+		valueCount = passPointCount * passFieldCount;
+		fileStream.seekg(passOffset);
+
+		for (vtkIdType startIdx = 0 ; startIdx < valueCount && fileStream ; startIdx += chunkValues) {
+			chunkValues = std::min< vtkIdType >(chunkBuffer.size() / sizeof(float), valueCount - startIdx);
+			fileStream.read(&chunkBuffer[0], chunkValues * sizeof(float));
+			vtkByteSwap::Swap4BERange((float *) &chunkBuffer[0], chunkValues);
+
+			for (vtkIdType valueIdx = 0 ; valueIdx < chunkValues ; valueIdx++) {
+				retStatistics->addHistogramValue((startIdx + valueIdx) % passFieldCount, ((float *) &chunkBuffer[0])[valueIdx]);
+			}
+		}
+	}
+
+	fileStream.close();
+}
+
+ofstream * vtkGraniteWriter::openBinary(std::string passBinaryName, long long passOffset) {
+	ofstream * fileStream;
+
+	// Container levels are written concurrently into a binary created beforehand, so it is never truncated
+	if (isContainer()) {
+		fileStream = new ofstream(passBinaryName.c_str(), ios::in | ios::out | ios::binary);
+		fileStream->seekp(passOffset);
+
+		return fileStream;
+	}
+
 	#ifdef _WIN32
-		fileStream.reset(new ofstream(passBinaryName.c_str(), ios::out | ios::binary));
+		fileStream = new ofstream(passBinaryName.c_str(), ios::out | ios::binary);
 	#else
-		fileStream.reset(new ofstream(passBinaryName.c_str(), ios::out));
+		fileStream = new ofstream(passBinaryName.c_str(), ios::out);
 	#endif
-		
-	for (int dataIdx = 0 ; dataIdx < passData->GetPointData()->GetArray(0)->GetSize() ; dataIdx++) {
-		for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
-			for (int compIdx = 0 ; compIdx < passData->GetPointData()->GetArray(arrayIdx)->GetNumberOfComponents() ; compIdx++) {
-				*((float *) currentVal) = passData->GetPointData()->GetArray(arrayIdx)->GetComponent(dataIdx, compIdx);
-				for (int valueIdx = sizeof(float) - 1 ; valueIdx >= 0 ; valueIdx--) {
-					fileStream->put(currentVal[valueIdx]);
+
+	return fileStream;
+}
+
+void vtkGraniteWriter::closeStream(ofstream * passStream, std::string passFileName) {
+	passStream->close();
+
+	// Streams that failed to open, write or flush are all left failed
+	if (passStream->fail()) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to write " + passFileName + ".").c_str());
+		_writeFailed = true;
+	}
+}
+
+int vtkGraniteWriter::getThreadLimit() {
+	if (_threadCount > 0) return _threadCount;
+
+	return std::max< int >(1, std::thread::hardware_concurrency());
+}
+
+bool vtkGraniteWriter::updateData(vtkDataSet * passData) {
+	std::vector< std::string > inputFieldNames, existingFieldNames;
+	std::string binaryName;
+	GraniteStorage::ByteOrderDef byteOrder;
+	GraniteStorage::LayoutDef layout;
+	vtkDataArray * currentArray;
+	int existingBounds[6], inputExtent[6], offset[3];
+
+	GraniteTrace::Span updateSpan("updateData", "write", (_filePath + _fileBase + ".xfdl").c_str());
+
+	if (!readExistingXFDL(_filePath + _fileBase + ".xfdl", &binaryName, &existingFieldNames, existingBounds, &byteOrder, &layout)) return false;
+
+	// Fields must match existing records exactly
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+		currentArray = passData->GetPointData()->GetArray(arrayIdx);
+		for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+			inputFieldNames.push_back(getFieldName(currentArray, arrayIdx, compIdx));
+		}
+	}
+
+	if (inputFieldNames != existingFieldNames) {
+		vtkOutputWindowDisplayErrorText("ERROR: Input fields do not match the fields of the existing Granite dataset.");
+		return false;
+	}
+
+	if (passData->IsA("vtkImageData")) ((vtkImageData *) passData)->GetExtent(inputExtent);
+	else ((vtkRectilinearGrid *) passData)->GetExtent(inputExtent);
+
+	if (_updateMode == UpdateModeDef::Update) {
+		// Sub-extent must lie within existing bounds
+		for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+			if (inputExtent[2 * dimIdx] < existingBounds[2 * dimIdx] || inputExtent[2 * dimIdx + 1] > existingBounds[2 * dimIdx + 1]) {
+				vtkOutputWindowDisplayErrorText("ERROR: Update extent lies outside the bounds of the existing Granite dataset.");
+				return false;
+			}
+
+			offset[dimIdx] = inputExtent[2 * dimIdx] - existingBounds[2 * dimIdx];
+		}
+
+		if (writeBinaryRegion(passData, _filePath + binaryName, offset, existingBounds, byteOrder, layout) == false) return false;
+	}
+	else {
+		// Planes of planar storage are sized by the slice count, so growing would move every field
+		if (layout == GraniteStorage::Planar) {
+			vtkOutputWindowDisplayErrorText("ERROR: Cannot append slices to a dataset written with native storage.");
+			return false;
+		}
+
+		// Appended slices must span the existing x/y bounds, and always follow the last existing slice
+		for (int dimIdx = 0 ; dimIdx < 2 ; dimIdx++) {
+			if (inputExtent[2 * dimIdx + 1] - inputExtent[2 * dimIdx] != existingBounds[2 * dimIdx + 1] - existingBounds[2 * dimIdx]) {
+				vtkOutputWindowDisplayErrorText("ERROR: Appended slices do not match the x/y bounds of the existing Granite dataset.");
+				return false;
+			}
+
+			offset[dimIdx] = 0;
+		}
+
+		offset[2] = existingBounds[5] - existingBounds[4] + 1;
+		existingBounds[5] += inputExtent[5] - inputExtent[4] + 1;
+
+		if (writeBinaryRegion(passData, _filePath + binaryName, offset, existingBounds, byteOrder, layout) == false) return false;
+	}
+
+	// Statistics no longer describe the data, and appending changes the bounds
+	return updateXFDLBounds(_filePath + _fileBase + ".xfdl", existingBounds);
+}
+
+bool vtkGraniteWriter::readExistingXFDL(std::string passXFDLName, std::string * retBinaryName, std::vector< std::string > * retFieldNames, int * retBounds, GraniteStorage::ByteOrderDef * retByteOrder, GraniteStorage::LayoutDef * retLayout) {
+	QXmlStreamReader::TokenType xmlToken;
+	QFile xmlFile(QString::fromStdString(passXFDLName));
+	int boundsIdx;
+
+	if (xmlFile.open(QIODevice::ReadOnly) == false) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Cannot open existing Granite dataset " + passXFDLName + " for update.").c_str());
+		return false;
+	}
+
+	QXmlStreamReader xmlStream(&xmlFile);
+
+	// Granite storage unless the XFDL says otherwise
+	retBinaryName->clear();
+	retFieldNames->clear();
+	*retByteOrder = GraniteStorage::BigEndian;
+	*retLayout = GraniteStorage::Interleaved;
+	boundsIdx = 0;
+
+	while (!xmlStream.atEnd()) {
+		xmlToken = xmlStream.readNext();
+		if (xmlToken != QXmlStreamReader::StartElement) continue;
+
+		if (xmlStream.name() == "FileDescriptor") {
+			*retBinaryName = xmlStream.attributes().value("fileName").toString().toStdString();
+		}
+
+		if (xmlStream.name() == "Field") {
+			retFieldNames->push_back(xmlStream.attributes().value("fieldName").toString().toStdString());
+		}
+
+		// Bounds are listed outermost (z) first
+		if (xmlStream.name() == "Bounds" && boundsIdx < 3) {
+			retBounds[4 - 2 * boundsIdx] = xmlStream.attributes().value("lower").toString().toInt();
+			retBounds[4 - 2 * boundsIdx + 1] = xmlStream.attributes().value("upper").toString().toInt();
+			boundsIdx++;
+		}
+
+		if (xmlStream.name() == "CustomParaViewStorage") {
+			*retByteOrder = GraniteStorage::parseByteOrder(xmlStream.attributes().value("byteOrder").toString().toStdString());
+			*retLayout = GraniteStorage::parseLayout(xmlStream.attributes().value("layout").toString().toStdString());
+		}
+
+		// Coarser levels would all need rewriting
+		if (xmlStream.name() == "CustomParaViewContainer") {
+			xmlFile.close();
+			vtkOutputWindowDisplayErrorText("ERROR: Update and append modes only support single resolution data.");
+			return false;
+		}
+
+		// Regions are written as floats, and new values could fall outside the quantized range
+		if (xmlStream.name() == "FieldEncoding" && GraniteStorage::parseEncoding(xmlStream.attributes().value("type").toString().toStdString()) != GraniteStorage::Float32) {
+			xmlFile.close();
+			vtkOutputWindowDisplayErrorText("ERROR: Cannot update a dataset written with quantized or half precision storage.");
+			return false;
+		}
+	}
+
+	xmlFile.close();
+
+	if (retBinaryName->empty() || boundsIdx < 3) {
+		vtkOutputWindowDisplayErrorText(("ERROR: " + passXFDLName + " is not a Granite dataset that can be updated.").c_str());
+		return false;
+	}
+
+	// Multiresolution levels would all need rewriting
+	if ((*retBinaryName)[0] == '@') {
+		vtkOutputWindowDisplayErrorText("ERROR: Update and append modes only support single resolution data.");
+		return false;
+	}
+
+	return true;
+}
+
+bool vtkGraniteWriter::writeBinaryRegion(vtkDataSet * passData, std::string passBinaryName, int * passOffset, int * passFullBounds, GraniteStorage::ByteOrderDef passByteOrder, GraniteStorage::LayoutDef passLayout) {
+	std::fstream fileStream;
+	std::vector< float > rowBuffer;
+	vtkDataArray * currentArray;
+	int dimensions[3], fullDimensions[3];
+	long long fieldCount, rowOffset, fullPointCount, bytesWritten;
+	int fieldIdx;
+	vtkIdType dataIdx;
+	bool swap;
+	char * currentVal;
+
+	GraniteCounters::ScopedTimer binaryTimer(&_counters, GraniteCounters::TimeWriteBinary);
+	GraniteTrace::Span binarySpan("writeBinaryRegion", "write", passBinaryName.c_str());
+
+	if (passData->IsA("vtkImageData")) ((vtkImageData *) passData)->GetDimensions(dimensions);
+	else ((vtkRectilinearGrid *) passData)->GetDimensions(dimensions);
+
+	for (int dimIdx = 0 ; dimIdx < 3 ; dimIdx++) {
+		fullDimensions[dimIdx] = passFullBounds[2 * dimIdx + 1] - passFullBounds[2 * dimIdx] + 1;
+	}
+
+	fieldCount = 0;
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+		fieldCount += passData->GetPointData()->GetArray(arrayIdx)->GetNumberOfComponents();
+	}
+
+	fullPointCount = (long long) fullDimensions[0] * fullDimensions[1] * fullDimensions[2];
+	swap = (passByteOrder != GraniteStorage::getHostByteOrder());
+
+	// Existing contents are kept, only rows of the region are replaced (or added past the end)
+	fileStream.open(passBinaryName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	if (!fileStream.is_open()) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Cannot open existing binary " + passBinaryName + " for update.").c_str());
+		return false;
+	}
+
+	// One x row at a time, each landing contiguously (interleaved) or once per field plane (planar)
+	rowBuffer.resize(passLayout == GraniteStorage::Planar ? dimensions[0] : dimensions[0] * fieldCount);
+	bytesWritten = 0;
+
+	for (int zIdx = 0 ; zIdx < dimensions[2] ; zIdx++) {
+		for (int yIdx = 0 ; yIdx < dimensions[1] ; yIdx++) {
+			rowOffset = ((long long) (passOffset[2] + zIdx) * fullDimensions[1] + passOffset[1] + yIdx) * fullDimensions[0] + passOffset[0];
+			dataIdx = ((vtkIdType) zIdx * dimensions[1] + yIdx) * dimensions[0];
+
+			for (int planeIdx = 0 ; planeIdx < (passLayout == GraniteStorage::Planar ? fieldCount : 1) ; planeIdx++) {
+				fieldIdx = 0;
+
+				for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+					currentArray = passData->GetPointData()->GetArray(arrayIdx);
+					for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++, fieldIdx++) {
+						if (passLayout == GraniteStorage::Planar && fieldIdx != planeIdx) continue;
+
+						for (int xIdx = 0 ; xIdx < dimensions[0] ; xIdx++) {
+							if (passLayout == GraniteStorage::Planar) rowBuffer[xIdx] = currentArray->GetComponent(dataIdx + xIdx, compIdx);
+							else rowBuffer[xIdx * fieldCount + fieldIdx] = currentArray->GetComponent(dataIdx + xIdx, compIdx);
+						}
+					}
+				}
+
+				// Stored byte order
+				if (swap) {
+					for (int valueIdx = 0 ; valueIdx < rowBuffer.size() ; valueIdx++) {
+						currentVal = (char *) &rowBuffer[valueIdx];
+						std::reverse(currentVal, currentVal + sizeof(float));
+					}
 				}
+
+				if (passLayout == GraniteStorage::Planar) fileStream.seekp((planeIdx * fullPointCount + rowOffset) * sizeof(float));
+				else fileStream.seekp(rowOffset * fieldCount * sizeof(float));
+
+				fileStream.write((char *) &rowBuffer[0], rowBuffer.size() * sizeof(float));
+				bytesWritten += rowBuffer.size() * sizeof(float);
 			}
 		}
 	}
 
-	fileStream->close();
+	_counters.increment(GraniteCounters::BytesWritten, bytesWritten);
+	fileStream.close();
+
+	if (fileStream.fail()) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to write binary " + passBinaryName + " during update.").c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool vtkGraniteWriter::updateXFDLBounds(std::string passXFDLName, int * passBounds) {
+	QXmlStreamReader::TokenType xmlToken;
+	QFile xmlFile(QString::fromStdString(passXFDLName));
+	QString xmlString;
+	QXmlStreamWriter xmlOutput(&xmlString);
+	int boundsIdx;
+
+	GraniteCounters::ScopedTimer xfdlTimer(&_counters, GraniteCounters::TimeWriteXFDL);
+	GraniteTrace::Span xfdlSpan("updateXFDLBounds", "write", passXFDLName.c_str());
+
+	if (xmlFile.open(QIODevice::ReadOnly) == false) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Cannot open " + passXFDLName + " to update its bounds.").c_str());
+		return false;
+	}
+
+	QXmlStreamReader xmlStream(&xmlFile);
+
+	// Copy every token (formatting included), replacing bounds and dropping statistics
+	boundsIdx = 0;
+	while (!xmlStream.atEnd()) {
+		xmlToken = xmlStream.readNext();
+		if (xmlStream.hasError()) break;
+
+		if (xmlToken == QXmlStreamReader::StartElement && xmlStream.name() == "CustomParaViewStatistics") {
+			xmlStream.skipCurrentElement();
+			continue;
+		}
+
+		if (xmlToken == QXmlStreamReader::StartElement && xmlStream.name() == "Bounds" && boundsIdx < 3) {
+			xmlOutput.writeStartElement("Bounds");
+			xmlOutput.writeAttribute("lower", std::to_string(passBounds[4 - 2 * boundsIdx]).c_str());
+			xmlOutput.writeAttribute("upper", std::to_string(passBounds[4 - 2 * boundsIdx + 1]).c_str());
+			boundsIdx++;
+			continue;
+		}
+
+		xmlOutput.writeCurrentToken(xmlStream);
+	}
+
+	xmlFile.close();
+
+	// A partly parsed XFDL is left as it was rather than truncated
+	if (xmlStream.hasError()) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to parse " + passXFDLName + " to update its bounds.").c_str());
+		return false;
+	}
+
+	// Replace XFDL file
+	if (xmlFile.open(QIODevice::WriteOnly | QIODevice::Truncate) == false || xmlFile.write(xmlString.toUtf8()) < 0) {
+		vtkOutputWindowDisplayErrorText(("ERROR: Unable to rewrite " + passXFDLName + " with updated bounds.").c_str());
+		return false;
+	}
+	xmlFile.close();
+
+	return true;
+}
+
+void vtkGraniteWriter::prepareEncodings(vtkDataSet * passData, bool passNative) {
+	std::map< std::string, GraniteStorage::EncodingDef >::iterator encodingIter;
+	GraniteStorage::EncodingDef arrayEncoding;
+	vtkDataArray * currentArray;
+	double currentRange[2];
+	bool requested;
+
+	_fieldEncodings.clear();
+	requested = false;
+
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+		currentArray = passData->GetPointData()->GetArray(arrayIdx);
+
+		arrayEncoding = _encoding;
+		if (currentArray->GetName() != NULL && (encodingIter = _arrayEncodings.find(currentArray->GetName())) != _arrayEncodings.end()) arrayEncoding = encodingIter->second;
+		if (arrayEncoding != GraniteStorage::Float32) requested = true;
+		if (!passNative) arrayEncoding = GraniteStorage::Float32;
+
+		// Codes span each component's input range (linear resampling never leaves it)
+		for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+			currentRange[0] = currentRange[1] = 0;
+			if (arrayEncoding == GraniteStorage::UInt8 || arrayEncoding == GraniteStorage::UInt16) currentArray->GetRange(currentRange, compIdx);
+
+			_fieldEncodings.push_back(GraniteStorage::makeEncoding(arrayEncoding, currentRange[0], currentRange[1]));
+		}
+	}
+
+	// Granite reads floats, so other encodings are only written by the plugin's own native storage
+	if (requested && !passNative) vtkOutputWindowDisplayWarningText("WARNING: Quantized and half precision encodings require native storage (single resolution or multiresolution container), writing float values.");
+}
+
+GraniteStorage::Encoding vtkGraniteWriter::getFieldEncoding(int passField) {
+	if (passField < 0 || passField >= _fieldEncodings.size()) return GraniteStorage::makeEncoding(GraniteStorage::Float32, 0, 0);
+
+	return _fieldEncodings[passField];
+}
+
+long long vtkGraniteWriter::getStoredBytes(int passFieldCount) {
+	long long storedBytes;
+
+	storedBytes = 0;
+	for (int fieldIdx = 0 ; fieldIdx < passFieldCount ; fieldIdx++) {
+		storedBytes += GraniteStorage::getEncodingSize(getFieldEncoding(fieldIdx).type);
+	}
+
+	return storedBytes;
+}
+
+float vtkGraniteWriter::getStoredValue(int passField, float passValue) {
+	char storedValue[sizeof(float)];
+
+	GraniteStorage::encodeValue(passValue, getFieldEncoding(passField), storedValue);
+
+	return GraniteStorage::decodeValue(storedValue, getFieldEncoding(passField));
+}
+
+void vtkGraniteWriter::getFieldNames(vtkDataSet * passData, std::vector< std::string > * retFieldNames) {
+	vtkDataArray * currentArray;
+
+	retFieldNames->clear();
+	for (int arrayIdx = 0 ; arrayIdx < passData->GetPointData()->GetNumberOfArrays() ; arrayIdx++) {
+		currentArray = passData->GetPointData()->GetArray(arrayIdx);
+		for (int compIdx = 0 ; compIdx < currentArray->GetNumberOfComponents() ; compIdx++) {
+			retFieldNames->push_back(getFieldName(currentArray, arrayIdx, compIdx));
+		}
+	}
+}
+
+std::string vtkGraniteWriter::getFieldName(vtkDataArray * passArray, int passArrayIdx, int passCompIdx) {
+	std::string arrayName, compName;
+
+	arrayName = (passArray->GetName() != NULL ? passArray->GetName() : std::string("array") + std::to_string(passArrayIdx));
+	compName = (passArray->GetComponentName(passCompIdx) != NULL ? passArray->GetComponentName(passCompIdx) : std::string("comp") + std::to_string(passCompIdx));
+
+	return arrayName + "." + compName;
 }
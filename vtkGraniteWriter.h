@@ -12,15 +12,36 @@
 #ifndef __vtkGraniteWriter_h
 #define __vtkGraniteWriter_h
 
-#include "qxmlstream.h"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "GraniteCounters.h"
+#include "GraniteFormat.h"
+#include "GraniteStatistics.h"
+#include "GraniteStorage.h"
 #include "vtkImageData.h"
 #include "vtkRectilinearGrid.h"
 #include "vtkWriter.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 
+class GraniteBenchmark;
+
 class vtkGraniteWriter : public vtkWriter {
+	// Allow benchmark suite to drive individual write stages
+	friend class GraniteBenchmark;
+
 	public:
+		// How output relates to an existing dataset
+		enum UpdateModeDef { Replace, // Write whole dataset
+							 Update, // Overwrite input's sub-extent of existing dataset
+							 Append, // Add input's slices after existing outermost (z) slices
+							 UpdateModeCount };
+
 		// VTK Setup
 		static vtkGraniteWriter * New(); // VTK new with reference count tracking
 		vtkTypeMacro(vtkGraniteWriter, vtkWriter); // Type conversion to VTK datatype
@@ -32,6 +53,22 @@ class vtkGraniteWriter : public vtkWriter {
 		void setResample(bool passResample);
 		bool getResample();
 		void setMultiresolution(int passCount, int passSteps);
+		void setNativeStorage(bool passNative); // Host byte order, planar binaries (single resolution only)
+		bool getNativeStorage();
+		void setContainer(bool passContainer); // Multiresolution levels in one binary with an offset table (rather than nested directories)
+		bool getContainer();
+		void setEncoding(int passEncoding); // Stored encoding of every array (see GraniteStorage::EncodingDef, native storage only)
+		int getEncoding();
+		void setArrayEncoding(const char * passName, int passEncoding); // Stored encoding of one array, overriding the default
+		void clearArrayEncodings();
+		void setUpdateMode(int passMode); // Replace, update in place or append (see UpdateModeDef)
+		int getUpdateMode();
+		void setMemoryBudget(int passMegabytes); // Cap on resampled levels held at once during multiresolution writes
+		int getMemoryBudget();
+		void setThreadCount(int passThreads); // Threads one write may use for levels and resampling (0 is one per core)
+		int getThreadCount();
+		const char * getPerformanceReport(); // Hot path counters, phase timers and memory peaks (of the last write)
+		void resetPerformanceCounters();
 
 	protected:
 		vtkGraniteWriter();
@@ -46,19 +83,64 @@ class vtkGraniteWriter : public vtkWriter {
 	private:
 		bool checkDataType(vtkInformation * passInput); // Verify if writer supports input data type
 		void writeMRData(vtkDataSet * passData); // Write data for a multiresolution source
-		void writeXFDL(vtkDataSet * passData, std::string passXFDLName, std::string passBinaryName); // Write XFDL file
-		void writeXFDLTypeData(vtkImageData * passData, QXmlStreamWriter * passStream); // Write vtkImageData specific data into XFDL file
-		void writeXFDLTypeData(vtkRectilinearGrid * passData, QXmlStreamWriter * passStream); // Write vtkRectilinearGrid specific data into XFDL file
-		void writeBinary(vtkDataSet * passData, std::string passBinaryName); // Write binary file
+		void writeMRLevel(vtkImageData * passData, int passLevel, std::string passDirectory); // Resample (if needed) and write one resolution level
+		void writeContainerData(vtkImageData * passData); // Write every multiresolution level into one binary, then the XFDL listing them
+		void writeContainerLevel(vtkImageData * passData, int passLevel, GraniteStatistics * retStatistics, vtkImageData * retHeaderData); // Resample (if needed) and write one level at its container offset
+		void getLevelExtent(vtkImageData * passData, int passLevel, int * retExtent); // Extent of a level once resampled
+		bool isContainer(); // Multiresolution levels written into one binary
+		bool getMagnification(vtkImageData * passData, int passLevel, double * retFactors); // Resample factors of a level (false if resampling would be an identity)
+		long long estimateLevelBytes(vtkImageData * passData, double * passFactors); // Size of a resampled level's arrays
+		void reserveBudget(long long passBytes); // Wait until level fits within memory budget
+		void releaseBudget(long long passBytes);
+		void writeXFDL(vtkDataSet * passData, std::string passXFDLName, std::string passBinaryName, GraniteStatistics * passStatistics = NULL); // Write XFDL file
+		void writeXFDLTypeData(vtkImageData * passData, GraniteFormat::Header * retHeader); // Fill vtkImageData specific XFDL header data
+		void writeXFDLTypeData(vtkRectilinearGrid * passData, GraniteFormat::Header * retHeader, std::string passXFDLName); // Fill vtkRectilinearGrid specific XFDL header data and write coordinate sidecar
+		void getXFDLFieldOffsets(vtkDataSet * passData, long long passPointCount, std::vector< GraniteFormat::FieldOffset > * retOffsets); // Byte offset of each field's plane (native storage), so readers can skip unselected fields
+		void writeBinary(vtkDataSet * passData, std::string passBinaryName, GraniteStatistics * retStatistics = NULL, bool passNative = false, long long passOffset = 0); // Write binary file (and gather statistics)
+		void writeStreamedBinary(vtkImageData * passData, double * passFactors, std::string passBinaryName, GraniteStatistics * retStatistics, bool passNative, vtkImageData * retHeaderData, long long passOffset = 0); // Resample and write binary slab by slab (header data receives structure only)
+		void writeBinarySlab(vtkDataSet * passData, ofstream * passStream, int * passDimensions, int passSliceOffset, GraniteStatistics * retStatistics, bool passNative, long long passOffset = 0); // Write whole slices starting at slice offset (binary starting at byte offset)
+		void addBinaryHistograms(std::string passBinaryName, int passFieldCount, vtkIdType passPointCount, GraniteStatistics * retStatistics, bool passNative, long long passOffset = 0); // Histogram pass over a written binary
+		ofstream * openBinary(std::string passBinaryName, long long passOffset); // Create binary, or open container positioned at a level's offset
+		void closeStream(ofstream * passStream, std::string passFileName); // Close, reporting (and failing the write) if anything could not be written
+		int getThreadLimit(); // Threads one write may use
+		bool updateData(vtkDataSet * passData); // Write input into existing dataset (update and append modes)
+		bool readExistingXFDL(std::string passXFDLName, std::string * retBinaryName, std::vector< std::string > * retFieldNames, int * retBounds, GraniteStorage::ByteOrderDef * retByteOrder, GraniteStorage::LayoutDef * retLayout); // Binary, fields, bounds and storage of existing dataset
+		bool writeBinaryRegion(vtkDataSet * passData, std::string passBinaryName, int * passOffset, int * passFullBounds, GraniteStorage::ByteOrderDef passByteOrder, GraniteStorage::LayoutDef passLayout); // Overwrite (or extend) part of existing binary, false if it could not be written
+		bool updateXFDLBounds(std::string passXFDLName, int * passBounds); // Rewrite existing XFDL with new bounds (dropping stale statistics), false if it could not be rewritten
+		void prepareEncodings(vtkDataSet * passData, bool passNative); // Stored encoding per field (quantized over each component's range)
+		GraniteStorage::Encoding getFieldEncoding(int passField); // Float unless prepared otherwise
+		long long getStoredBytes(int passFieldCount); // Stored bytes of the first fields of a point
+		float getStoredValue(int passField, float passValue); // Value as it will be read back
+		void getFieldNames(vtkDataSet * passData, std::vector< std::string > * retFieldNames);
+		std::string getFieldName(vtkDataArray * passArray, int passArrayIdx, int passCompIdx); // Compose Granite field name (array.component)
 
 		vtkGraniteWriter(const vtkGraniteWriter&);  // Not implemented per VTK standard
 		void operator=(const vtkGraniteWriter&);  // Not implemented per VTK standard
 
+		static const long long SlabBytes = 64 * 1024 * 1024; // Resampled slab size while streaming
+		static const long long ContainerAlignment = 4096; // Level offsets within a container (page aligned, so levels map directly)
+
 		bool _ready; // Writer properly intialized
 		bool _resample; // Resample image data
+		bool _nativeStorage; // Write host byte order, planar binaries
+		bool _container; // Write multiresolution levels into one binary
+		std::vector< std::vector< int > > _levelExtents; // Extent of each level of the current container write
+		std::vector< long long > _levelOffsets; // Byte offset of each level within the current container
+		GraniteStorage::EncodingDef _encoding; // Default stored encoding of arrays
+		std::map< std::string, GraniteStorage::EncodingDef > _arrayEncodings; // Stored encoding of named arrays
+		std::vector< GraniteStorage::Encoding > _fieldEncodings; // Stored encoding per field of the current write
+		UpdateModeDef _updateMode; // Replace, update in place or append
 		int _mrCount, _mrSteps; // Number of multiresolution levels and steps between level
 		std::string _filePath; // File path
 		std::string _fileBase; // File base
+		GraniteCounters _counters; // Hot path counters and phase timers
+		std::string _performanceReport; // Storage for last report returned
+		int _memoryBudget; // Megabytes of resampled levels held at once while writing multiresolution (0 is unlimited)
+		long long _budgetUsed; // Bytes of resampled levels currently held
+		int _threadCount; // Threads one write may use (0 is one per core)
+		std::atomic< bool > _writeFailed; // A file of the current write could not be written (levels are written concurrently)
+		std::mutex _budgetLock; // Guards budget (and shallow copies of the input)
+		std::condition_variable _budgetCondition; // Signals released budget
 };
 
 #endif // __vtkGraniteWriter_h